@@ -0,0 +1,414 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <cstring>
+
+#define ENET_IMPLEMENTATION
+#include "../libs/enet.h"
+
+
+// Load generator: BOTS clients each send PLAYER_SYNC at SYNC_RATE, with their
+// bot index and a sequence number in the position, and time how long each one
+// takes to come back in the other bots' PLAYER_SNAPSHOTs (receive-to-relay).
+// With --sync-relay, bots never set a snapshot encoding, so the server relays
+// the other bots' PLAYER_SYNCs to them instead, as to older clients. With
+// --still-bots, the last N bots keep syncing the same state, as idle players do.
+// With --quantized, bots set the quantized encoding and only acknowledge their
+// snapshots, whose positions don't carry the sequence exactly enough to time.
+// With --rtt, bots also ping the server often and sample ENet's round trip time,
+// which only stays low while the server acknowledges promptly. With --flood,
+// bot 0 syncs MULTIPLIER times as fast and only the other bots' latencies to
+// each other are recorded: what a flooding client costs everyone else
+
+#define DEFAULT_HOST "127.0.0.1"
+#define DEFAULT_PORT 55555
+#define DEFAULT_BOTS 8
+#define DEFAULT_SYNC_RATE 60
+#define DEFAULT_SECONDS 5
+
+#define CONNECT_TIMEOUT_MS 2000
+#define WARMUP_MS 500 // Samples before this are dropped
+#define LINGER_MS 200 // Receiving after the last sync, before disconnecting
+
+#define SEQUENCE_SLOTS (1 << 16) // Send times kept per bot
+
+#define RTT_PING_INTERVAL_MS 20
+#define RTT_SAMPLE_INTERVAL_MS 50
+
+
+typedef uint16_t PlayerID;
+
+
+#pragma pack(1)
+typedef struct {
+	float x = 0.0;
+	float y = 0.0;
+	float z = 0.0;
+} Vec3;
+
+#pragma pack(1)
+typedef struct {
+	Vec3 position;
+	float yaw;
+	float pitch;
+	uint8_t player_state_flags; // PlayerStateFlags bitmask
+	Vec3 hook_point;
+} PlayerState;
+
+
+enum PacketType : char {
+	PLAYER_SYNC,
+	PLAYER_SET_NAME,
+	PLAYER_READY,
+	PLAYER_HIDER_CAUGHT,
+	PLAYER_STATS,
+	PLAYER_DISCONNECTED,
+
+	CONTROL_MAP_DATA,
+	CONTROL_GAME_START,
+	CONTROL_SET_PLAYER_STATE,
+	CONTROL_GAME_END,
+
+	PLAYER_SNAPSHOT,
+	PLAYER_SNAPSHOT_ACK,
+	PLAYER_SET_SNAPSHOT_ENCODING,
+	PLAYER_SNAPSHOT_QUANTIZED
+};
+
+#pragma pack(1)
+typedef struct {
+	PacketType packet_type = PacketType::PLAYER_SYNC;
+	PlayerID player_id;
+	PlayerState player_state;
+} PlayerSyncPacketData;
+
+enum SnapshotFields : uint8_t {
+	SNAPSHOT_POSITION = 1 << 0,
+	SNAPSHOT_YAW = 1 << 1,
+	SNAPSHOT_PITCH = 1 << 2,
+	SNAPSHOT_FLAGS = 1 << 3,
+	SNAPSHOT_HOOK_POINT = 1 << 4
+};
+
+#pragma pack(1)
+typedef struct {
+	PlayerID player_id;
+	uint8_t fields;
+} PlayerSnapshotEntry;
+
+#pragma pack(1)
+typedef struct {
+	PacketType packet_type = PacketType::PLAYER_SNAPSHOT;
+	uint16_t sequence;
+	uint8_t baseline_age;
+	uint8_t player_count;
+} PlayerSnapshotPacketData;
+
+#pragma pack(1)
+typedef struct {
+	PacketType packet_type = PacketType::PLAYER_SNAPSHOT_ACK;
+	uint16_t sequence;
+} PlayerSnapshotAckPacketData;
+
+enum SnapshotEncoding : uint8_t {
+	SNAPSHOT_ENCODING_FLOAT,
+	SNAPSHOT_ENCODING_QUANTIZED
+};
+
+#pragma pack(1)
+typedef struct {
+	PacketType packet_type = PacketType::PLAYER_SET_SNAPSHOT_ENCODING;
+	uint8_t encoding;
+} PlayerSetSnapshotEncodingPacketData;
+
+#pragma pack()
+
+
+std::string host_name = DEFAULT_HOST;
+int port = DEFAULT_PORT;
+int bot_count = DEFAULT_BOTS;
+double sync_rate = DEFAULT_SYNC_RATE;
+double seconds = DEFAULT_SECONDS;
+bool measure_rtt = false;
+bool sync_relay = false;
+int still_bots = 0; // The last ones; they keep syncing their first state
+bool quantized = false;
+double flood_multiplier = 0; // Of bot 0's sync rate; 0 when not flooding
+
+std::unique_ptr<std::atomic<int64_t>[]> send_times; // Per bot, per sequence slot; ns
+std::vector<std::vector<int64_t>> relay_latencies; // Per receiving bot; ns
+std::vector<std::vector<int64_t>> round_trip_times; // Per bot; ns
+std::atomic<int> connected_bots{0};
+std::atomic<int64_t> start_time{0};
+
+static inline int64_t NowNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()
+	).count();
+}
+
+static inline void SendSync(ENetPeer* peer, const int bot, const uint32_t sequence, const enet_uint32 flags) {
+	PlayerSyncPacketData psp_data{};
+	psp_data.player_state.position = {(float)bot, 10.0f, (float)sequence};
+	psp_data.player_state.player_state_flags = 1;
+	enet_peer_send(peer, 0, enet_packet_create(&psp_data, sizeof(PlayerSyncPacketData), flags));
+}
+
+// Records the relay latency of another bot's sync, by the position it sent
+static inline void RecordRelay(
+	const int bot,
+	const Vec3& position,
+	const int64_t received_time,
+	std::vector<uint32_t>& latest_sequences
+) {
+	const int sender = (int)position.x;
+	const uint32_t sequence = (uint32_t)position.z;
+	if (
+		sender < 0 || sender >= bot_count || sender == bot ||
+		sequence <= latest_sequences[sender]
+	) return;
+
+	latest_sequences[sender] = sequence;
+	const int64_t sent_time = send_times[sender * SEQUENCE_SLOTS + sequence % SEQUENCE_SLOTS].load();
+	const bool flooding = flood_multiplier > 0 && (sender == 0 || bot == 0);
+	if (!flooding && sent_time >= start_time.load() + WARMUP_MS * 1000000ll) relay_latencies[bot].push_back(received_time - sent_time);
+}
+
+// Records the relay latency of every other bot's sync this snapshot carries,
+// and acknowledges it so the next ones are deltas
+static inline void HandleSnapshot(
+	ENetPeer* peer,
+	const int bot,
+	const ENetPacket* packet,
+	const int64_t received_time,
+	std::vector<uint32_t>& latest_sequences
+) {
+	if (packet->dataLength < sizeof(PlayerSnapshotPacketData)) return;
+	PlayerSnapshotPacketData ps_data;
+	memcpy(&ps_data, packet->data, sizeof(PlayerSnapshotPacketData));
+
+	const enet_uint8* read_position = packet->data + sizeof(PlayerSnapshotPacketData);
+	const enet_uint8* packet_end = packet->data + packet->dataLength;
+	for (uint8_t i = 0; i < ps_data.player_count; i++) {
+		PlayerSnapshotEntry entry;
+		if (read_position + sizeof(PlayerSnapshotEntry) > packet_end) return;
+		memcpy(&entry, read_position, sizeof(PlayerSnapshotEntry));
+		read_position += sizeof(PlayerSnapshotEntry);
+
+		const size_t fields_size =
+			((entry.fields & SNAPSHOT_POSITION) ? sizeof(Vec3) : 0) +
+			((entry.fields & SNAPSHOT_YAW) ? sizeof(float) : 0) +
+			((entry.fields & SNAPSHOT_PITCH) ? sizeof(float) : 0) +
+			((entry.fields & SNAPSHOT_FLAGS) ? sizeof(uint8_t) : 0) +
+			((entry.fields & SNAPSHOT_HOOK_POINT) ? sizeof(Vec3) : 0);
+		if (read_position + fields_size > packet_end) return;
+
+		if (entry.fields & SNAPSHOT_POSITION) {
+			Vec3 position;
+			memcpy(&position, read_position, sizeof(Vec3));
+			RecordRelay(bot, position, received_time, latest_sequences);
+		}
+		read_position += fields_size;
+	}
+
+	PlayerSnapshotAckPacketData psa_data{};
+	psa_data.sequence = ps_data.sequence;
+	enet_peer_send(peer, 0, enet_packet_create(&psa_data, sizeof(PlayerSnapshotAckPacketData), 0));
+}
+
+static void BotMain(const int bot) {
+	ENetHost* client = enet_host_create(NULL, 1, 1, 0, 0);
+	if (!client) {
+		std::cout << "Failed to create ENet client" << std::endl;
+		exit(1);
+	}
+
+	ENetAddress address = {0};
+	enet_address_set_host(&address, host_name.c_str());
+	address.port = port;
+	ENetPeer* server_peer = enet_host_connect(client, &address, 1, 0);
+	ENetEvent event;
+	if (
+		server_peer == nullptr ||
+		!(enet_host_service(client, &event, CONNECT_TIMEOUT_MS) > 0 && event.type == ENET_EVENT_TYPE_CONNECT)
+	) {
+		std::cout << "Bot " << bot << " failed to connect to server" << std::endl;
+		exit(1);
+	}
+
+	if (measure_rtt) enet_peer_ping_interval(server_peer, RTT_PING_INTERVAL_MS);
+
+	// The first sync registers the player
+	SendSync(server_peer, bot, 0, ENET_PACKET_FLAG_RELIABLE);
+	if (!sync_relay) {
+		PlayerSetSnapshotEncodingPacketData psse_data{};
+		psse_data.encoding = quantized ? SNAPSHOT_ENCODING_QUANTIZED : SNAPSHOT_ENCODING_FLOAT;
+		enet_peer_send(server_peer, 0, enet_packet_create(&psse_data, sizeof(PlayerSetSnapshotEncodingPacketData), ENET_PACKET_FLAG_RELIABLE));
+	}
+	enet_host_flush(client);
+	connected_bots++;
+
+	while (start_time.load() == 0) {
+		if (enet_host_service(client, &event, 1) > 0 && event.type == ENET_EVENT_TYPE_RECEIVE) enet_packet_destroy(event.packet);
+	}
+
+	// Bots' syncs are spread evenly over each sync interval
+	const int64_t sync_interval = (int64_t)(1e9 / ((bot == 0 && flood_multiplier > 0) ? sync_rate * flood_multiplier : sync_rate));
+	const int64_t end_time = start_time.load() + (int64_t)(seconds * 1e9);
+	int64_t next_sync_time = start_time.load() + sync_interval * bot / bot_count;
+	uint32_t sequence = 1;
+	std::vector<uint32_t> latest_sequences(bot_count, 0);
+	int64_t next_rtt_sample_time = start_time.load() + WARMUP_MS * 1000000ll;
+
+	for (;;) {
+		int64_t now = NowNs();
+		if (now >= end_time + LINGER_MS * 1000000ll) break;
+
+		if (now >= next_sync_time && now < end_time && bot >= bot_count - still_bots) {
+			SendSync(server_peer, bot, 0, 0);
+			enet_host_flush(client);
+			next_sync_time += sync_interval;
+		}
+		else if (now >= next_sync_time && now < end_time) {
+			send_times[bot * SEQUENCE_SLOTS + sequence % SEQUENCE_SLOTS].store(NowNs());
+			SendSync(server_peer, bot, sequence++, 0);
+			enet_host_flush(client);
+			next_sync_time += sync_interval;
+		}
+
+		if (measure_rtt && now >= next_rtt_sample_time && now < end_time) {
+			round_trip_times[bot].push_back(server_peer->roundTripTime * 1000000ll);
+			next_rtt_sample_time += RTT_SAMPLE_INTERVAL_MS * 1000000ll;
+		}
+
+		const int64_t wait_ms = std::clamp<int64_t>((next_sync_time - NowNs()) / 1000000, 0, 1);
+		int service_result = enet_host_service(client, &event, (enet_uint32)wait_ms);
+		while (service_result > 0) {
+			if (event.type == ENET_EVENT_TYPE_DISCONNECT) {
+				std::cout << "Bot " << bot << " disconnected by server" << std::endl;
+				exit(1);
+			}
+			if (event.type == ENET_EVENT_TYPE_RECEIVE) {
+				if (event.packet->dataLength > 0 && event.packet->data[0] == PacketType::PLAYER_SNAPSHOT) {
+					HandleSnapshot(server_peer, bot, event.packet, NowNs(), latest_sequences);
+				}
+				else if (event.packet->dataLength >= sizeof(PlayerSnapshotPacketData) && event.packet->data[0] == PacketType::PLAYER_SNAPSHOT_QUANTIZED) {
+					PlayerSnapshotAckPacketData psa_data{};
+					memcpy(&psa_data.sequence, event.packet->data + offsetof(PlayerSnapshotPacketData, sequence), sizeof(uint16_t));
+					enet_peer_send(server_peer, 0, enet_packet_create(&psa_data, sizeof(PlayerSnapshotAckPacketData), 0));
+				}
+				else if (event.packet->dataLength >= sizeof(PlayerSyncPacketData) && event.packet->data[0] == PacketType::PLAYER_SYNC) {
+					PlayerSyncPacketData psp_data;
+					memcpy(&psp_data, event.packet->data, sizeof(PlayerSyncPacketData));
+					RecordRelay(bot, psp_data.player_state.position, NowNs(), latest_sequences);
+				}
+				enet_packet_destroy(event.packet);
+			}
+			service_result = enet_host_service(client, &event, 0);
+		}
+	}
+
+	enet_peer_disconnect_now(server_peer, 0);
+	enet_host_destroy(client);
+}
+
+static void PrintDistribution(const std::string& name, std::vector<int64_t> samples_ns) {
+	if (samples_ns.empty()) {
+		std::cout << name << ": no samples" << std::endl;
+		return;
+	}
+
+	std::sort(samples_ns.begin(), samples_ns.end());
+	auto quantile_us = [&](const double fraction) {
+		return samples_ns[std::min(samples_ns.size() - 1, (size_t)(fraction * samples_ns.size()))] / 1000.0;
+	};
+	double sum = 0;
+	for (const int64_t sample : samples_ns) sum += sample;
+
+	std::cout
+	<< name << ": n=" << samples_ns.size()
+	<< " mean=" << sum / samples_ns.size() / 1000.0 << "us"
+	<< " p50=" << quantile_us(0.5) << "us"
+	<< " p99=" << quantile_us(0.99) << "us"
+	<< " p999=" << quantile_us(0.999) << "us"
+	<< " max=" << samples_ns.back() / 1000.0 << "us"
+	<< std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	std::vector<std::string> positional_args;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "--host" && i + 1 < argc) host_name = argv[++i];
+		else if (arg == "--port" && i + 1 < argc) port = std::stoi(argv[++i]);
+		else if (arg == "--rtt") measure_rtt = true;
+		else if (arg == "--sync-relay") sync_relay = true;
+		else if (arg == "--still-bots" && i + 1 < argc) still_bots = std::stoi(argv[++i]);
+		else if (arg == "--quantized") quantized = true;
+		else if (arg == "--flood" && i + 1 < argc) flood_multiplier = std::stod(argv[++i]);
+		else if (arg.rfind("--", 0) == 0) {
+			std::cout
+			<< "USAGE: [BOTS] [SYNC_RATE] [SECONDS] [OPTIONS]\n"
+			<< "OPTIONS:\n"
+			<< "  --host HOST  Server address (default " << DEFAULT_HOST << ")\n"
+			<< "  --port PORT  Server port (default " << DEFAULT_PORT << ")\n"
+			<< "  --rtt  Also sample ENet's round trip time to the server, pinging every " << RTT_PING_INTERVAL_MS << "ms\n"
+			<< "  --sync-relay  Don't set a snapshot encoding, and time the other bots' relayed PLAYER_SYNCs instead\n"
+			<< "  --still-bots N  The last N bots keep syncing the same state, so only the others' syncs are timed\n"
+			<< "  --quantized  Set the quantized snapshot encoding; snapshots are only acknowledged, not timed\n"
+			<< "  --flood MULTIPLIER  Bot 0 syncs MULTIPLIER times as fast; only the other bots' latencies are recorded"
+			<< std::endl;
+			return 1;
+		}
+		else positional_args.push_back(arg);
+	}
+	if (positional_args.size() >= 1) bot_count = std::stoi(positional_args[0]);
+	if (positional_args.size() >= 2) sync_rate = std::stod(positional_args[1]);
+	if (positional_args.size() >= 3) seconds = std::stod(positional_args[2]);
+	if (
+		bot_count - std::max(still_bots, 0) < ((flood_multiplier > 0) ? 3 : 2) ||
+		sync_rate <= 0 || seconds <= 0
+	) {
+		std::cout << "Needs at least 2 moving bots (3 with --flood), and a positive sync rate and duration" << std::endl;
+		return 1;
+	}
+
+	if (enet_initialize() != 0) {
+		std::cout << "Failed to initialize ENet" << std::endl;
+		return 1;
+	}
+	atexit(enet_deinitialize);
+
+	send_times.reset(new std::atomic<int64_t>[bot_count * SEQUENCE_SLOTS]());
+	relay_latencies.resize(bot_count);
+	round_trip_times.resize(bot_count);
+
+	std::vector<std::thread> bots;
+	for (int bot = 0; bot < bot_count; bot++) bots.emplace_back(BotMain, bot);
+	while (connected_bots.load() < bot_count) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	// Let every registration and map transfer settle first
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	start_time.store(NowNs());
+	for (std::thread& bot : bots) bot.join();
+
+	std::vector<int64_t> all_latencies;
+	for (const std::vector<int64_t>& latencies : relay_latencies) {
+		all_latencies.insert(all_latencies.end(), latencies.begin(), latencies.end());
+	}
+	PrintDistribution((flood_multiplier > 0) ? "relay latency between non-flooding bots" : "relay latency", all_latencies);
+
+	if (measure_rtt) {
+		std::vector<int64_t> all_round_trip_times;
+		for (const std::vector<int64_t>& samples : round_trip_times) {
+			all_round_trip_times.insert(all_round_trip_times.end(), samples.begin(), samples.end());
+		}
+		PrintDistribution("round trip time", all_round_trip_times);
+	}
+
+	return 0;
+}
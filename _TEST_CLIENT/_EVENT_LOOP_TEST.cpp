@@ -0,0 +1,191 @@
+// Event loop tests: a loop that calls WaitForEvents() then RunFdCallbacks(), as
+// the server's does, must run the callback of a registered descriptor once it's
+// ready and of a timerfd once it expires, and a callback may unregister its own
+// descriptor (or another one ready in the same iteration) without the loop
+// running anything it unregistered
+
+#define _HNS_NO_MAIN
+#include "../main.cpp"
+
+
+#define WAIT_TIMEOUT_MS 1000
+#define TIMER_INTERVAL_MS 10
+
+int wait_fd = -1; // Stands in for ENet's wait socket
+
+static inline void ResetEventLoop() {
+	if (loop_epoll_fd >= 0) close(loop_epoll_fd);
+	if (wait_fd >= 0) close(wait_fd);
+	fd_callbacks.clear();
+	ready_fds_count = 0;
+
+	wait_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	InitEventLoop(wait_fd);
+}
+
+static inline void Signal(const int fd) {
+	const uint64_t value = 1;
+	if (write(fd, &value, sizeof(value)) != sizeof(value)) throw std::runtime_error("Failed to signal an eventfd");
+}
+
+// Runs loop iterations until done() or WAIT_TIMEOUT_MS pass; whether done()
+static inline bool RunLoopUntil(const std::function<bool()>& done) {
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(WAIT_TIMEOUT_MS);
+	while (!done() && std::chrono::steady_clock::now() < deadline) {
+		WaitForEvents(TIMER_INTERVAL_MS);
+		RunFdCallbacks();
+	}
+	return done();
+}
+
+static bool TestFdCallback() {
+	ResetEventLoop();
+
+	const int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	int calls = 0;
+	uint32_t ready_events = 0;
+	if (!RegisterFd(fd, EPOLLIN, [&](const uint32_t events) {
+		uint64_t value;
+		if (read(fd, &value, sizeof(value)) == sizeof(value)) calls++;
+		ready_events = events;
+	})) {
+		std::cout << "  failed to register: " << strerror(errno) << std::endl;
+		close(fd);
+		return false;
+	}
+
+	bool passed = true;
+	if (RegisterFd(fd, EPOLLIN, [](const uint32_t) {})) {
+		std::cout << "  registered the same descriptor twice" << std::endl;
+		passed = false;
+	}
+
+	WaitForEvents(0);
+	RunFdCallbacks();
+	if (calls != 0) {
+		std::cout << "  callback ran before the descriptor was ready" << std::endl;
+		passed = false;
+	}
+
+	Signal(fd);
+	if (!RunLoopUntil([&] { return calls > 0; })) {
+		std::cout << "  callback didn't run" << std::endl;
+		passed = false;
+	}
+	else if (!(ready_events & EPOLLIN)) {
+		std::cout << "  callback got events " << ready_events << " without EPOLLIN" << std::endl;
+		passed = false;
+	}
+
+	Signal(wait_fd);
+	if (!WaitForEvents(WAIT_TIMEOUT_MS)) {
+		std::cout << "  ready wait socket not reported" << std::endl;
+		passed = false;
+	}
+	RunFdCallbacks();
+
+	UnregisterFd(fd);
+	close(fd);
+	return passed && calls == 1;
+}
+
+static bool TestTimerFd() {
+	ResetEventLoop();
+
+	int once_calls = 0;
+	int repeat_calls = 0;
+	const int once_fd = RegisterTimerFd(TIMER_INTERVAL_MS, false, [&] { once_calls++; });
+	const int repeat_fd = RegisterTimerFd(TIMER_INTERVAL_MS, true, [&] { repeat_calls++; });
+	if (once_fd < 0 || repeat_fd < 0) {
+		std::cout << "  failed to register: " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	bool passed = true;
+	if (!RunLoopUntil([&] { return repeat_calls >= 3; })) {
+		std::cout << "  repeating timer ran " << repeat_calls << " of 3 times" << std::endl;
+		passed = false;
+	}
+	if (once_calls != 1) {
+		std::cout << "  one-shot timer ran " << once_calls << " times" << std::endl;
+		passed = false;
+	}
+
+	UnregisterTimerFd(once_fd);
+	UnregisterTimerFd(repeat_fd);
+	return passed;
+}
+
+static bool TestUnregisterInCallback() {
+	ResetEventLoop();
+
+	// Whichever runs first unregisters both, so the other never runs
+	const int first_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	const int second_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	int calls = 0;
+	auto unregister_both = [&](const uint32_t) {
+		calls++;
+		UnregisterFd(first_fd);
+		UnregisterFd(second_fd);
+	};
+	RegisterFd(first_fd, EPOLLIN, unregister_both);
+	RegisterFd(second_fd, EPOLLIN, unregister_both);
+
+	// A repeating timer that stops itself on its first expiry
+	int timer_calls = 0;
+	int timer_fd = -1;
+	timer_fd = RegisterTimerFd(TIMER_INTERVAL_MS, true, [&] {
+		timer_calls++;
+		UnregisterTimerFd(timer_fd);
+	});
+	if (timer_fd < 0) {
+		std::cout << "  failed to register timer: " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	bool passed = true;
+	Signal(first_fd);
+	Signal(second_fd);
+	WaitForEvents(WAIT_TIMEOUT_MS);
+	RunFdCallbacks();
+	if (calls != 1) {
+		std::cout << "  descriptors' callbacks ran " << calls << " times" << std::endl;
+		passed = false;
+	}
+
+	// Long enough for it to expire many more times, had it stayed registered
+	RunLoopUntil([] { return false; });
+	if (timer_calls != 1) {
+		std::cout << "  timer ran " << timer_calls << " times" << std::endl;
+		passed = false;
+	}
+	if (!fd_callbacks.empty()) {
+		std::cout << "  " << fd_callbacks.size() << " callbacks left registered" << std::endl;
+		passed = false;
+	}
+
+	close(first_fd);
+	close(second_fd);
+	return passed;
+}
+
+int main() {
+	const std::vector<std::pair<const char*, bool (*)()>> tests = {
+		{"fd callback", TestFdCallback},
+		{"timerfd", TestTimerFd},
+		{"unregister in callback", TestUnregisterInCallback}
+	};
+
+	int failed = 0;
+	for (auto const& [name, test] : tests) {
+		bool passed = false;
+		try {
+			passed = test();
+		} catch (const std::exception& e) {
+			std::cout << "  " << e.what() << std::endl;
+		}
+		std::cout << name << ": " << (passed ? "PASSED" : "FAILED") << std::endl;
+		if (!passed) failed++;
+	}
+	return (failed == 0) ? 0 : 1;
+}
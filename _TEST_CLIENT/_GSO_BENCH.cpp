@@ -0,0 +1,182 @@
+// Send path microbenchmark: the server's host fans bursts out to a full shard
+// of loopback clients, and the CPU time of each flush is charged to the burst
+// that filled it. Build it plain, with -DENET_BATCH_IO and with
+// -DENET_BATCH_IO -DENET_UDP_GSO to compare the three send paths; only bursts
+// with several datagrams to one peer in a flush give GSO anything to coalesce
+//
+// Bursts, to every client:
+// - tick: its PLAYER_SNAPSHOT, unreliable (one datagram)
+// - round transition: its CONTROL_SET_PLAYER_STATE, CONTROL_GAME_START and
+//   PLAYER_SNAPSHOT, as the tick a round starts in sends them (still one)
+// - map change: CONTROL_MAP_DATA of MAP, as an admin map change sends it
+//   (as many datagrams as its fragments)
+
+#define _HNS_NO_MAIN
+#include "../main.cpp"
+
+
+#define DEFAULT_ROUNDS 2000
+#define BENCH_PORT 55610
+#define CONNECT_ITERATIONS 500
+
+typedef struct {
+	const char* name;
+	void (*send)(const std::vector<ENetPeer*>& peers);
+	double cpu_seconds = 0;
+	uint64_t datagrams = 0;
+	uint64_t send_calls = 0;
+} Burst;
+
+std::vector<ENetHost*> clients;
+uint64_t received_packets = 0;
+
+static inline double ThreadCPUSeconds() {
+	timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static inline void SendSnapshot(ENetPeer* peer) {
+	std::vector<char> data(
+		sizeof(PlayerSnapshotPacketData) +
+		(MAX_PLAYERS - 1) * (sizeof(PlayerSnapshotEntry) + sizeof(PlayerState))
+	);
+	PlayerSnapshotPacketData ps_data{};
+	ps_data.player_count = MAX_PLAYERS - 1;
+	memcpy(data.data(), &ps_data, sizeof(PlayerSnapshotPacketData));
+	SendPacket(peer, enet_packet_create(data.data(), data.size(), 0));
+}
+
+static void SendTick(const std::vector<ENetPeer*>& peers) {
+	for (ENetPeer* peer : peers) SendSnapshot(peer);
+}
+
+static void SendRoundTransition(const std::vector<ENetPeer*>& peers) {
+	for (ENetPeer* peer : peers) {
+		ControlSetPlayerStatePacketData cspsp_data{};
+		cspsp_data.state.player_state_flags = PlayerStateFlags::ALIVE;
+		SendPacket(peer, enet_packet_create(
+			&cspsp_data,
+			sizeof(ControlSetPlayerStatePacketData),
+			ENET_PACKET_FLAG_RELIABLE
+		));
+	}
+	BroadcastPacket(enet_packet_create(
+		std::array<char, 1>{PacketType::CONTROL_GAME_START}.data(),
+		sizeof(PacketType),
+		ENET_PACKET_FLAG_RELIABLE
+	));
+	SendTick(peers);
+}
+
+static void SendMapChange(const std::vector<ENetPeer*>& peers) {
+	for (size_t i = 0; i < peers.size(); i++) SendMapData(peers[i], (PlayerID)i);
+}
+
+// Clients take everything in and acknowledge it, and the server takes the
+// acknowledgements, so reliable bursts don't pile up in the windows
+static inline void Drain() {
+	ENetEvent event;
+	for (ENetHost* client : clients) {
+		while (enet_host_service(client, &event, 0) > 0) {
+			if (event.type != ENET_EVENT_TYPE_RECEIVE) continue;
+			received_packets++;
+			enet_packet_destroy(event.packet);
+		}
+	}
+	while (enet_host_service(server, &event, 0) > 0) {
+		if (event.type == ENET_EVENT_TYPE_RECEIVE) enet_packet_destroy(event.packet);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		std::cout << "USAGE: MAP [ROUNDS]" << std::endl;
+		return 1;
+	}
+	const int rounds = (argc > 2) ? std::stoi(argv[2]) : DEFAULT_ROUNDS;
+
+	if (enet_initialize() != 0) {
+		std::cout << "Failed to initialize ENet" << std::endl;
+		return 1;
+	}
+	atexit(enet_deinitialize);
+
+	current_map = LoadMap(argv[1]);
+
+	ENetAddress address = {0};
+	address.host = ENET_HOST_ANY;
+	address.port = BENCH_PORT;
+	server = enet_host_create(&address, MAX_PLAYERS, 1, 0, 0);
+	if (server == nullptr) {
+		std::cout << "Failed to create ENet server" << std::endl;
+		return 1;
+	}
+
+	// Every player but the one whose syncs the snapshots relay
+	enet_address_set_host(&address, "127.0.0.1");
+	for (int i = 0; i < MAX_PLAYERS - 1; i++) {
+		ENetHost* client = enet_host_create(NULL, 1, 1, 0, 0);
+		if (client == nullptr || enet_host_connect(client, &address, 1, 0) == nullptr) {
+			std::cout << "Failed to create ENet client" << std::endl;
+			return 1;
+		}
+		clients.push_back(client);
+	}
+	std::vector<ENetPeer*> peers;
+	ENetEvent event;
+	for (int i = 0; i < CONNECT_ITERATIONS && peers.size() < clients.size(); i++) {
+		while (enet_host_service(server, &event, 1) > 0) {
+			if (event.type == ENET_EVENT_TYPE_CONNECT) peers.push_back(event.peer);
+		}
+		for (ENetHost* client : clients) while (enet_host_service(client, &event, 0) > 0) {}
+	}
+	if (peers.size() < clients.size()) {
+		std::cout << "Clients failed to connect" << std::endl;
+		return 1;
+	}
+	Drain();
+
+	std::array<Burst, 3> bursts = {{
+		{"tick", SendTick},
+		{"round transition", SendRoundTransition},
+		{"map change", SendMapChange}
+	}};
+	for (int round = 0; round < rounds; round++) {
+		for (Burst& burst : bursts) {
+			burst.send(peers);
+
+			const enet_uint32 datagrams_before = server->totalSentPackets;
+			const enet_uint32 send_calls_before = server->totalSendCalls;
+			const double cpu_before = ThreadCPUSeconds();
+			FlushPackets();
+			burst.cpu_seconds += ThreadCPUSeconds() - cpu_before;
+			burst.datagrams += server->totalSentPackets - datagrams_before;
+			burst.send_calls += server->totalSendCalls - send_calls_before;
+
+			Drain();
+		}
+	}
+
+	#if defined(ENET_USE_UDP_GSO)
+	std::cout << "send path: sendmmsg + GSO" << std::endl;
+	#elif defined(ENET_USE_MMSG)
+	std::cout << "send path: sendmmsg" << std::endl;
+	#else
+	std::cout << "send path: socket" << std::endl;
+	#endif
+	std::cout << "map data: " << current_map->data.size() + sizeof(PacketType) << " bytes" << std::endl;
+	for (const Burst& burst : bursts) {
+		std::cout
+		<< burst.name << ": "
+		<< (double)burst.datagrams / rounds / peers.size() << " datagrams per peer per flush, "
+		<< (double)burst.datagrams / burst.send_calls << " per send call, "
+		<< burst.cpu_seconds / burst.datagrams * 1e6 << "ms flush CPU per 1000 datagrams"
+		<< std::endl;
+	}
+	std::cout << "received: " << received_packets << " packets" << std::endl;
+
+	for (ENetHost* client : clients) enet_host_destroy(client);
+	enet_host_destroy(server);
+	return 0;
+}
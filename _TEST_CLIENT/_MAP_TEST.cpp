@@ -0,0 +1,94 @@
+// Map loading tests: the quantized bounds come from the objects with a
+// numeric position and scale, others are left out rather than failing the
+// load, and without any such object the spawns bound the map
+
+#define _HNS_NO_MAIN
+#include "../main.cpp"
+
+#include <cstdio>
+
+
+// Objects are appended to the two spawns
+static std::shared_ptr<const MapInfo> LoadTestMap(const std::string& objects) {
+	char map_path[] = "/tmp/hns_map_test_XXXXXX";
+	const int fd = mkstemp(map_path);
+	if (fd < 0) throw std::runtime_error("Failed to create a test map");
+	close(fd);
+
+	std::ofstream(map_path)
+	<< "[\n"
+	<< " {\"data\": {}, \"pos\": [0, 5, 0], \"rot\": [0, 0, 0], \"scale\": \"none\", \"type\": \"Spawn_Hider\"},\n"
+	<< " {\"data\": {}, \"pos\": [10, 5, 20], \"rot\": [0, 0, 0], \"scale\": \"none\", \"type\": \"Spawn_Seeker\"}"
+	<< objects
+	<< "\n]";
+	try {
+		std::shared_ptr<const MapInfo> map = LoadMap(map_path);
+		remove(map_path);
+		return map;
+	} catch (...) {
+		remove(map_path);
+		throw;
+	}
+}
+
+static inline bool CheckBounds(const MapInfo& map, const Vec3& bounds_min, const Vec3& bounds_max) {
+	auto matches = [](const Vec3& a, const Vec3& b) {
+		return std::abs(a.x - b.x) < 0.001f && std::abs(a.y - b.y) < 0.001f && std::abs(a.z - b.z) < 0.001f;
+	};
+	if (matches(map.bounds_min, bounds_min) && matches(map.bounds_max, bounds_max)) return true;
+
+	std::cout
+	<< "  bounds (" << map.bounds_min.x << ", " << map.bounds_min.y << ", " << map.bounds_min.z
+	<< ") to (" << map.bounds_max.x << ", " << map.bounds_max.y << ", " << map.bounds_max.z
+	<< "), expected (" << bounds_min.x << ", " << bounds_min.y << ", " << bounds_min.z
+	<< ") to (" << bounds_max.x << ", " << bounds_max.y << ", " << bounds_max.z << ")" << std::endl;
+	return false;
+}
+
+static bool TestObjectBounds() {
+	const std::shared_ptr<const MapInfo> map = LoadTestMap(
+		",\n {\"data\": {}, \"pos\": [1, 2, 3], \"rot\": [0, 0, 0], \"scale\": [0, 3, 4], \"type\": \"Block\"}"
+	);
+	const float m = QUANTIZED_BOUNDS_MARGIN;
+	return CheckBounds(*map, Vec3{1 - 5 - m, 2 - 5 - m, 3 - 5 - m}, Vec3{1 + 5 + m, 2 + 5 + m, 3 + 5 + m});
+}
+
+static bool TestNonNumericObjectsLeftOut() {
+	const std::shared_ptr<const MapInfo> map = LoadTestMap(
+		",\n {\"data\": {}, \"pos\": [1, 2, 3], \"rot\": [0, 0, 0], \"scale\": [0, 3, 4], \"type\": \"Block\"}"
+		",\n {\"data\": {}, \"pos\": [\"far\", 0, 0], \"rot\": [0, 0, 0], \"scale\": [1, 1, 1], \"type\": \"Block\"}"
+		",\n {\"data\": {}, \"pos\": [500, 0, 0], \"rot\": [0, 0, 0], \"scale\": [1, null, 1], \"type\": \"Block\"}"
+		",\n {\"data\": {}, \"pos\": [500, 0, 0], \"rot\": [0, 0, 0], \"scale\": {}, \"type\": \"Block\"}"
+	);
+	const float m = QUANTIZED_BOUNDS_MARGIN;
+	return CheckBounds(*map, Vec3{1 - 5 - m, 2 - 5 - m, 3 - 5 - m}, Vec3{1 + 5 + m, 2 + 5 + m, 3 + 5 + m});
+}
+
+static bool TestSpawnBoundsFallback() {
+	const std::shared_ptr<const MapInfo> map = LoadTestMap(
+		",\n {\"data\": {}, \"pos\": [500, 0, 0], \"rot\": [0, 0, 0], \"scale\": [], \"type\": \"Block\"}"
+	);
+	const float m = QUANTIZED_BOUNDS_MARGIN;
+	return CheckBounds(*map, Vec3{0 - m, 5 - m, 0 - m}, Vec3{10 + m, 5 + m, 20 + m});
+}
+
+int main() {
+	const std::vector<std::pair<const char*, bool (*)()>> tests = {
+		{"object bounds", TestObjectBounds},
+		{"non-numeric objects left out", TestNonNumericObjectsLeftOut},
+		{"spawn bounds fallback", TestSpawnBoundsFallback}
+	};
+
+	int failed = 0;
+	for (auto const& [name, test] : tests) {
+		bool passed = false;
+		try {
+			passed = test();
+		} catch (const std::exception& e) {
+			std::cout << "  " << e.what() << std::endl;
+		}
+		std::cout << name << ": " << (passed ? "PASSED" : "FAILED") << std::endl;
+		if (!passed) failed++;
+	}
+	return (failed == 0) ? 0 : 1;
+}
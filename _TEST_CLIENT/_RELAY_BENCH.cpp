@@ -0,0 +1,149 @@
+// Relay microbenchmark: every tick each of PLAYERS loopback clients' PLAYER_SYNC
+// is relayed to all the others, either as a copy per recipient (as the relay
+// used to) or as one packet shared by all of them through SendPacketToPeers.
+// ENet's allocations and the CPU time of queueing and flushing them are
+// charged to the relayed syncs
+
+#define _HNS_NO_MAIN
+#include "../main.cpp"
+
+
+#define DEFAULT_ROUNDS 500
+#define BENCH_PORT 55611
+#define CONNECT_ITERATIONS 2000
+
+typedef struct {
+	const char* name;
+	void (*relay)(const PlayerSyncPacketData& psp_data, std::vector<ENetPeer*>& peers);
+	double cpu_seconds = 0;
+	uint64_t allocations = 0;
+	uint64_t relayed_syncs = 0;
+} Relay;
+
+std::vector<ENetHost*> clients;
+uint64_t allocations = 0; // By ENet, since it was initialized
+
+static void* CountingMalloc(size_t size) {
+	allocations++;
+	return malloc(size);
+}
+
+static inline double ThreadCPUSeconds() {
+	timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void RelayCopies(const PlayerSyncPacketData& psp_data, std::vector<ENetPeer*>& peers) {
+	for (ENetPeer* peer : peers) SendPacket(peer, enet_packet_create(&psp_data, sizeof(PlayerSyncPacketData), 0));
+}
+
+static void RelayShared(const PlayerSyncPacketData& psp_data, std::vector<ENetPeer*>& peers) {
+	SendPacketToPeers(enet_packet_create(&psp_data, sizeof(PlayerSyncPacketData), 0), peers);
+}
+
+static inline void Drain() {
+	ENetEvent event;
+	for (ENetHost* client : clients) {
+		while (enet_host_service(client, &event, 0) > 0) {
+			if (event.type == ENET_EVENT_TYPE_RECEIVE) enet_packet_destroy(event.packet);
+		}
+	}
+	while (enet_host_service(server, &event, 0) > 0) {
+		if (event.type == ENET_EVENT_TYPE_RECEIVE) enet_packet_destroy(event.packet);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		std::cout << "USAGE: PLAYERS [ROUNDS]" << std::endl;
+		return 1;
+	}
+	const int players = std::stoi(argv[1]);
+	const int rounds = (argc > 2) ? std::stoi(argv[2]) : DEFAULT_ROUNDS;
+	if (players < 2) {
+		std::cout << "Needs at least 2 players" << std::endl;
+		return 1;
+	}
+
+	ENetCallbacks callbacks = {CountingMalloc, free, abort};
+	if (enet_initialize_with_callbacks(ENET_VERSION, &callbacks) != 0) {
+		std::cout << "Failed to initialize ENet" << std::endl;
+		return 1;
+	}
+	atexit(enet_deinitialize);
+
+	ENetAddress address = {0};
+	address.host = ENET_HOST_ANY;
+	address.port = BENCH_PORT;
+	server = enet_host_create(&address, players, 1, 0, 0);
+	if (server == nullptr) {
+		std::cout << "Failed to create ENet server" << std::endl;
+		return 1;
+	}
+
+	enet_address_set_host(&address, "127.0.0.1");
+	for (int i = 0; i < players; i++) {
+		ENetHost* client = enet_host_create(NULL, 1, 1, 0, 0);
+		if (client == nullptr || enet_host_connect(client, &address, 1, 0) == nullptr) {
+			std::cout << "Failed to create ENet client" << std::endl;
+			return 1;
+		}
+		clients.push_back(client);
+	}
+	std::vector<ENetPeer*> peers;
+	ENetEvent event;
+	for (int i = 0; i < CONNECT_ITERATIONS && peers.size() < clients.size(); i++) {
+		while (enet_host_service(server, &event, 1) > 0) {
+			if (event.type == ENET_EVENT_TYPE_CONNECT) peers.push_back(event.peer);
+		}
+		for (ENetHost* client : clients) while (enet_host_service(client, &event, 0) > 0) {}
+	}
+	if (peers.size() < clients.size()) {
+		std::cout << "Clients failed to connect" << std::endl;
+		return 1;
+	}
+	Drain();
+
+	std::array<Relay, 2> relays = {{
+		{"per-peer copies", RelayCopies},
+		{"shared packet", RelayShared}
+	}};
+	std::vector<ENetPeer*> relay_peers;
+	for (int round = 0; round < rounds; round++) {
+		for (Relay& relay : relays) {
+			const uint64_t allocations_before = allocations;
+			const double cpu_before = ThreadCPUSeconds();
+			for (int player = 0; player < players; player++) {
+				relay_peers.clear();
+				for (int i = 0; i < players; i++) {
+					if (i != player) relay_peers.push_back(peers[i]);
+				}
+
+				PlayerSyncPacketData psp_data{};
+				psp_data.player_id = (PlayerID)player;
+				psp_data.player_state.position = {(float)player, 10.0f, (float)round};
+				relay.relay(psp_data, relay_peers);
+			}
+			FlushPackets();
+			relay.cpu_seconds += ThreadCPUSeconds() - cpu_before;
+			relay.allocations += allocations - allocations_before;
+			relay.relayed_syncs += players;
+
+			Drain();
+		}
+	}
+
+	std::cout << "players: " << players << std::endl;
+	for (const Relay& relay : relays) {
+		std::cout
+		<< relay.name << ": "
+		<< (double)relay.allocations / relay.relayed_syncs << " allocations per relayed sync, "
+		<< relay.cpu_seconds / relay.relayed_syncs * 1e6 << "us CPU per relayed sync (queue and flush)"
+		<< std::endl;
+	}
+
+	for (ENetHost* client : clients) enet_host_destroy(client);
+	enet_host_destroy(server);
+	return 0;
+}
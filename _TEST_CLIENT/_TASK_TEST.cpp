@@ -0,0 +1,123 @@
+// Task tests: a task that throws, before or after suspending, must end there
+// with its frame freed, without the exception reaching whatever resumed it,
+// and the shard's other tasks and timers must carry on
+
+#define _HNS_NO_MAIN
+#include "../main.cpp"
+
+
+int live_frames = 0;
+int finished_tasks = 0;
+
+// Lives in a task's frame, so it's destroyed with it
+struct FrameGuard {
+	FrameGuard() { live_frames++; }
+	~FrameGuard() { live_frames--; }
+};
+
+static inline Task ThrowImmediately() {
+	FrameGuard guard;
+	throw std::runtime_error("before suspending");
+	co_return;
+}
+
+static inline Task ThrowAfterSleep() {
+	FrameGuard guard;
+	co_await Sleep(10);
+	throw std::runtime_error("after Sleep");
+}
+
+static inline Task ThrowAfterNextTick() {
+	FrameGuard guard;
+	co_await NextTick();
+	throw 42;
+}
+
+static inline Task SleepAndFinish() {
+	FrameGuard guard;
+	co_await Sleep(20);
+	finished_tasks++;
+}
+
+static inline void ResetTasks() {
+	timer_nodes.clear();
+	free_timer_nodes.clear();
+	timer_bucket_occupancy.fill(0);
+	timer_wheel_time = 0;
+	pending_timers_count = 0;
+	InitTimerWheel();
+	next_tick_tasks.clear();
+
+	live_frames = 0;
+	finished_tasks = 0;
+}
+
+static inline bool CheckTasksDone(const int expected_finished) {
+	bool passed = true;
+	if (live_frames != 0) {
+		std::cout << "  " << live_frames << " task frames left alive" << std::endl;
+		passed = false;
+	}
+	if (finished_tasks != expected_finished) {
+		std::cout << "  " << finished_tasks << " of " << expected_finished << " tasks finished" << std::endl;
+		passed = false;
+	}
+	return passed;
+}
+
+static bool TestThrowBeforeSuspending() {
+	ResetTasks();
+
+	try {
+		ThrowImmediately();
+	} catch (...) {
+		std::cout << "  exception reached the caller" << std::endl;
+		return false;
+	}
+	return CheckTasksDone(0);
+}
+
+static bool TestThrowFromTimer() {
+	ResetTasks();
+
+	ThrowAfterSleep();
+	SleepAndFinish();
+	try {
+		AdvanceTimers(30);
+	} catch (...) {
+		std::cout << "  exception reached AdvanceTimers" << std::endl;
+		return false;
+	}
+	return CheckTasksDone(1);
+}
+
+static bool TestThrowFromNextTick() {
+	ResetTasks();
+
+	ThrowAfterNextTick();
+	SleepAndFinish();
+	try {
+		ResumeNextTickTasks();
+		AdvanceTimers(30);
+	} catch (...) {
+		std::cout << "  exception reached ResumeNextTickTasks" << std::endl;
+		return false;
+	}
+	return CheckTasksDone(1);
+}
+
+int main() {
+	const std::vector<std::pair<const char*, bool (*)()>> tests = {
+		{"throw before suspending", TestThrowBeforeSuspending},
+		{"throw from timer", TestThrowFromTimer},
+		{"throw from next tick", TestThrowFromNextTick}
+	};
+
+	int failed = 0;
+	for (auto const& [name, test] : tests) {
+		const bool passed = test();
+		std::cout << name << ": " << (passed ? "PASSED" : "FAILED") << std::endl;
+		if (!passed) failed++;
+	}
+	return (failed == 0) ? 0 : 1;
+}
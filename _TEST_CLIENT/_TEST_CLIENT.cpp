@@ -1,6 +1,7 @@
 #include <iostream>
 #include <thread>
 #include <array>
+#include <unordered_map>
 
 #define ENET_IMPLEMENTATION
 #include "../libs/enet.h"
@@ -13,6 +14,8 @@
 
 #define MAX_NAME_LENGTH 64
 
+#define SNAPSHOT_HISTORY 32 // As the server's
+
 
 typedef uint16_t PlayerID;
 
@@ -69,7 +72,13 @@ enum PacketType : char {
 	CONTROL_MAP_DATA,
 	CONTROL_GAME_START,
 	CONTROL_SET_PLAYER_STATE,
-	CONTROL_GAME_END
+	CONTROL_GAME_END,
+
+	PLAYER_SNAPSHOT, // Server -> Clients; other players' states, as a delta
+	PLAYER_SNAPSHOT_ACK, // Client -> Server
+	PLAYER_SET_SNAPSHOT_ENCODING, // Client -> Server
+	PLAYER_SNAPSHOT_QUANTIZED, // Server -> Clients; PLAYER_SNAPSHOT, with SNAPSHOT_ENCODING_QUANTIZED fields
+	CONTROL_SNAPSHOT_ENCODING // Server -> Client; confirms PLAYER_SET_SNAPSHOT_ENCODING
 };
 
 #pragma region PACKETS_DATA
@@ -81,6 +90,56 @@ typedef struct {
 	PlayerState player_state;
 } PlayerSyncPacketData;
 
+enum SnapshotFields : uint8_t {
+	SNAPSHOT_POSITION = 1 << 0,
+	SNAPSHOT_YAW = 1 << 1,
+	SNAPSHOT_PITCH = 1 << 2,
+	SNAPSHOT_FLAGS = 1 << 3,
+	SNAPSHOT_HOOK_POINT = 1 << 4
+};
+
+#pragma pack(1)
+typedef struct {
+	PlayerID player_id;
+	uint8_t fields; // SnapshotFields bitmask; those fields follow, in PlayerState order
+} PlayerSnapshotEntry;
+
+#pragma pack(1)
+typedef struct {
+	PacketType packet_type = PacketType::PLAYER_SNAPSHOT;
+	uint16_t sequence;
+	// How many snapshots before this one the snapshot it's a delta against
+	// is; 0 when against none, with every field of every other player
+	uint8_t baseline_age;
+	uint8_t player_count;
+	// Followed by player_count PlayerSnapshotEntry, each with its fields
+} PlayerSnapshotPacketData;
+
+#pragma pack(1)
+typedef struct {
+	PacketType packet_type = PacketType::PLAYER_SNAPSHOT_ACK;
+	uint16_t sequence; // Of the latest PLAYER_SNAPSHOT received
+} PlayerSnapshotAckPacketData;
+
+enum SnapshotEncoding : uint8_t {
+	SNAPSHOT_ENCODING_FLOAT,
+	SNAPSHOT_ENCODING_QUANTIZED
+};
+
+#pragma pack(1)
+typedef struct {
+	PacketType packet_type = PacketType::PLAYER_SET_SNAPSHOT_ENCODING;
+	uint8_t encoding; // SnapshotEncoding
+} PlayerSetSnapshotEncodingPacketData;
+
+#pragma pack(1)
+typedef struct {
+	PacketType packet_type = PacketType::CONTROL_SNAPSHOT_ENCODING;
+	uint8_t encoding; // SnapshotEncoding
+	Vec3 bounds_min;
+	Vec3 bounds_max;
+} ControlSnapshotEncodingPacketData;
+
 #pragma pack(1)
 typedef struct {
 	PacketType packet_type = PacketType::PLAYER_SET_NAME;
@@ -126,6 +185,19 @@ PlayerState local_state = {
 	.hook_point = {0.01, 0.02, 0.03}
 };
 
+// Other players' states as of each received snapshot, to apply later deltas to
+typedef struct {
+	bool received = false;
+	uint16_t sequence;
+	std::unordered_map<PlayerID, PlayerState> players;
+} SnapshotView;
+
+std::array<SnapshotView, SNAPSHOT_HISTORY> snapshot_views;
+bool snapshot_acked = false;
+uint16_t acked_snapshot_sequence;
+Vec3 snapshot_bounds_min; // Of quantized positions
+Vec3 snapshot_bounds_max;
+
 int main() {
 	if (enet_initialize() != 0) {
 		std::cout << "Failed to initialize ENet" << std::endl;
@@ -178,6 +250,15 @@ int main() {
 	);
 	enet_peer_send(server_peer, 0, set_name_packet);
 
+	PlayerSetSnapshotEncodingPacketData psse_data{};
+	psse_data.encoding = SnapshotEncoding::SNAPSHOT_ENCODING_QUANTIZED;
+	ENetPacket* set_snapshot_encoding_packet = enet_packet_create(
+		&psse_data,
+		sizeof(PlayerSetSnapshotEncodingPacketData),
+		ENET_PACKET_FLAG_RELIABLE
+	);
+	enet_peer_send(server_peer, 0, set_snapshot_encoding_packet);
+
 	enet_host_flush(client);
 	std::this_thread::sleep_for(std::chrono::milliseconds(2000));
 
@@ -240,6 +321,116 @@ int main() {
 				}
 				break;
 
+				case PacketType::PLAYER_SNAPSHOT:
+				case PacketType::PLAYER_SNAPSHOT_QUANTIZED:
+				{
+					const bool quantized = *((PacketType*)(event.packet->data + 0)) == PacketType::PLAYER_SNAPSHOT_QUANTIZED;
+					if (event.packet->dataLength < sizeof(PlayerSnapshotPacketData)) break;
+					const PlayerSnapshotPacketData ps_data = *((PlayerSnapshotPacketData*)event.packet->data);
+
+					SnapshotView view{};
+					if (ps_data.baseline_age != 0) {
+						const uint16_t baseline_sequence = ps_data.sequence - ps_data.baseline_age;
+						const SnapshotView& baseline = snapshot_views[baseline_sequence % SNAPSHOT_HISTORY];
+						if (!baseline.received || baseline.sequence != baseline_sequence) break; // Can't be applied
+						view.players = baseline.players;
+					}
+					view.received = true;
+					view.sequence = ps_data.sequence;
+
+					const enet_uint8* read_position = event.packet->data + sizeof(PlayerSnapshotPacketData);
+					const enet_uint8* packet_end = event.packet->data + event.packet->dataLength;
+					auto read_field = [&](void* field, const size_t size) {
+						if (read_position + size > packet_end) return false;
+						memcpy(field, read_position, size);
+						read_position += size;
+						return true;
+					};
+					auto read_position_field = [&](Vec3& position) {
+						if (!quantized) return read_field(&position, sizeof(Vec3));
+
+						uint16_t quantized_position[3];
+						if (!read_field(quantized_position, sizeof(quantized_position))) return false;
+						position.x = snapshot_bounds_min.x + (snapshot_bounds_max.x - snapshot_bounds_min.x) * quantized_position[0] / 65535.0f;
+						position.y = snapshot_bounds_min.y + (snapshot_bounds_max.y - snapshot_bounds_min.y) * quantized_position[1] / 65535.0f;
+						position.z = snapshot_bounds_min.z + (snapshot_bounds_max.z - snapshot_bounds_min.z) * quantized_position[2] / 65535.0f;
+						return true;
+					};
+					auto read_angle_field = [&](float& angle) {
+						if (!quantized) return read_field(&angle, sizeof(float));
+
+						uint16_t quantized_angle;
+						if (!read_field(&quantized_angle, sizeof(uint16_t))) return false;
+						angle = (int16_t)quantized_angle * (float)(2.0 * 3.14159265358979323846 / 65536.0);
+						return true;
+					};
+					bool valid = true;
+					for (uint8_t i = 0; valid && i < ps_data.player_count; i++) {
+						PlayerSnapshotEntry entry;
+						if (!(valid = read_field(&entry, sizeof(PlayerSnapshotEntry)))) break;
+
+						PlayerState& received_state = view.players[entry.player_id];
+						if (entry.fields & SnapshotFields::SNAPSHOT_POSITION) valid = valid && read_position_field(received_state.position);
+						if (entry.fields & SnapshotFields::SNAPSHOT_YAW) valid = valid && read_angle_field(received_state.yaw);
+						if (entry.fields & SnapshotFields::SNAPSHOT_PITCH) valid = valid && read_angle_field(received_state.pitch);
+						if (entry.fields & SnapshotFields::SNAPSHOT_FLAGS) valid = valid && read_field(&received_state.player_state_flags, sizeof(uint8_t));
+						if (entry.fields & SnapshotFields::SNAPSHOT_HOOK_POINT) valid = valid && read_position_field(received_state.hook_point);
+						if (!valid) break;
+
+						std::cout
+						<< "Received player "
+						<< entry.player_id
+						<< " state:"
+						<< std::endl;
+
+						std::cout << "position x: " << received_state.position.x << std::endl;
+						std::cout << "position y: " << received_state.position.y << std::endl;
+						std::cout << "position z: " << received_state.position.z << std::endl;
+						std::cout << "yaw: " << received_state.yaw << std::endl;
+						std::cout << "pitch: " << received_state.pitch << std::endl;
+						std::cout << "state flags: " << std::endl;
+						std::cout << "\tALIVE: " << ((received_state.player_state_flags & PlayerStateFlags::ALIVE) != 0) << std::endl;
+						std::cout << "\tIS_SEEKER: " << ((received_state.player_state_flags & PlayerStateFlags::IS_SEEKER) != 0) << std::endl;
+						std::cout << "\tJUMPED: " << ((received_state.player_state_flags & PlayerStateFlags::JUMPED) != 0) << std::endl;
+						std::cout << "\tWALLJUMPED: " << ((received_state.player_state_flags & PlayerStateFlags::WALLJUMPED) != 0) << std::endl;
+						std::cout << "\tSLIDING: " << ((received_state.player_state_flags & PlayerStateFlags::SLIDING) != 0) << std::endl;
+						std::cout << "\tFLASHLIGHT: " << ((received_state.player_state_flags & PlayerStateFlags::FLASHLIGHT) != 0) << std::endl;
+						std::cout << "hook_point x: " << received_state.hook_point.x << std::endl;
+						std::cout << "hook_point y: " << received_state.hook_point.y << std::endl;
+						std::cout << "hook_point z: " << received_state.hook_point.z << std::endl;
+					}
+					if (!valid) break;
+
+					// Snapshots arrive out of order too; only newer ones are acknowledged
+					if (snapshot_acked && (int16_t)(ps_data.sequence - acked_snapshot_sequence) <= 0) break;
+					snapshot_views[ps_data.sequence % SNAPSHOT_HISTORY] = std::move(view);
+					snapshot_acked = true;
+					acked_snapshot_sequence = ps_data.sequence;
+
+					PlayerSnapshotAckPacketData psa_data{};
+					psa_data.sequence = ps_data.sequence;
+					ENetPacket* snapshot_ack_packet = enet_packet_create(
+						&psa_data,
+						sizeof(PlayerSnapshotAckPacketData),
+						0
+					);
+					enet_peer_send(server_peer, 0, snapshot_ack_packet);
+				}
+				break;
+
+				case PacketType::CONTROL_SNAPSHOT_ENCODING:
+				{
+					if (event.packet->dataLength < sizeof(ControlSnapshotEncodingPacketData)) break;
+					const ControlSnapshotEncodingPacketData cse_data = *((ControlSnapshotEncodingPacketData*)event.packet->data);
+					snapshot_bounds_min = cse_data.bounds_min;
+					snapshot_bounds_max = cse_data.bounds_max;
+
+					std::cout << "Snapshot encoding set: " << +cse_data.encoding << std::endl;
+					std::cout << "bounds min: " << cse_data.bounds_min.x << ", " << cse_data.bounds_min.y << ", " << cse_data.bounds_min.z << std::endl;
+					std::cout << "bounds max: " << cse_data.bounds_max.x << ", " << cse_data.bounds_max.y << ", " << cse_data.bounds_max.z << std::endl;
+				}
+				break;
+
 				case PacketType::PLAYER_STATS:
 				{
 					std::cout
@@ -0,0 +1,111 @@
+// Timer wheel microbenchmark: MATCHES matches each keep TIMERS_PER_MATCH
+// periodic timers going (round cooldowns, delivery timeouts, resends, reports).
+// Measured once as a busy shard, whose loop wakes every millisecond and where
+// some matches cancel and reschedule a timer each millisecond as restarted
+// timeouts do, and once as a quiet one, whose loop sleeps NextTimerDelay()
+// between wakeups; either way every timer must fire on its exact millisecond
+
+#define _HNS_NO_MAIN
+#include "../main.cpp"
+
+#include <random>
+
+
+#define DEFAULT_MATCHES 2000
+#define DEFAULT_TIMERS_PER_MATCH 4
+#define DEFAULT_SIMULATED_MS 100000
+#define RESCHEDULES_PER_MS 10
+
+// Typical delays of the server's timers, in ms; each timer picks one and
+// adds up to 10% jitter
+const std::array<uint64_t, 7> timer_delays = {
+	16, // A tick at 60 Hz
+	50, // Short Sleep()s
+	1000, // GAME_END_DELIVERY_TIMEOUT_MS
+	2000, // ROUND_TRANSITION_COOLDOWN
+	3000, // UPGRADE_SETTLE_TIMEOUT_MS
+	10000, // Stats and drain reports
+	600000 // Past level 2
+};
+
+typedef struct {
+	TimerID timer_id = 0;
+	uint64_t expiry = 0;
+} BenchTimer;
+
+std::mt19937_64 bench_random(1);
+std::vector<BenchTimer> bench_timers; // match * timers_per_match + timer
+uint64_t bench_loop_time = 0;
+uint64_t schedules = 0;
+uint64_t cancels = 0;
+uint64_t fires = 0;
+uint64_t late_fires = 0;
+
+static inline void ScheduleBenchTimer(const size_t index) {
+	const uint64_t base_delay = timer_delays[bench_random() % timer_delays.size()];
+	const uint64_t delay = base_delay + bench_random() % (base_delay / 10 + 1);
+	bench_timers[index].expiry = timer_wheel_time + delay;
+	bench_timers[index].timer_id = ScheduleTimer(delay, [index]{
+		fires++;
+		if (bench_loop_time != bench_timers[index].expiry) late_fires++;
+		ScheduleBenchTimer(index);
+	});
+	schedules++;
+}
+
+static inline void RescheduleRandomTimers() {
+	for (int i = 0; i < RESCHEDULES_PER_MS; i++) {
+		const size_t index = bench_random() % bench_timers.size();
+		CancelTimer(bench_timers[index].timer_id);
+		cancels++;
+		ScheduleBenchTimer(index);
+	}
+}
+
+static void RunBench(const char* name, const size_t timer_count, const uint64_t simulated_ms, const bool busy) {
+	timer_nodes.clear();
+	free_timer_nodes.clear();
+	timer_bucket_occupancy.fill(0);
+	timer_wheel_time = 0;
+	pending_timers_count = 0;
+	InitTimerWheel();
+	bench_timers.assign(timer_count, BenchTimer{});
+	bench_loop_time = 0;
+	for (size_t i = 0; i < timer_count; i++) ScheduleBenchTimer(i);
+	schedules = cancels = fires = late_fires = 0;
+
+	uint64_t wakeups = 0;
+	const auto start = std::chrono::steady_clock::now();
+	while (bench_loop_time < simulated_ms) {
+		// Each wakeup asks for the next one either way
+		const uint64_t timer_delay = NextTimerDelay();
+		if (busy) RescheduleRandomTimers();
+		bench_loop_time += busy ? 1 : timer_delay;
+		AdvanceTimers(bench_loop_time);
+		wakeups++;
+	}
+	const double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+	const uint64_t operations = schedules + cancels + fires;
+	std::cout
+	<< name << ": " << timer_count << " live timers, " << simulated_ms << " ms simulated in " << wakeups << " wakeups; "
+	<< schedules << " schedules, " << cancels << " cancels, " << fires << " fired (" << late_fires << " late); "
+	<< elapsed_ns / operations << " ns per operation, "
+	<< elapsed_ns / simulated_ms << " ns per simulated ms"
+	<< std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	const size_t matches = (argc > 1) ? std::stoul(argv[1]) : DEFAULT_MATCHES;
+	const size_t timers_per_match = (argc > 2) ? std::stoul(argv[2]) : DEFAULT_TIMERS_PER_MATCH;
+	const uint64_t simulated_ms = (argc > 3) ? std::stoull(argv[3]) : DEFAULT_SIMULATED_MS;
+	if (matches * timers_per_match == 0 || simulated_ms == 0) {
+		std::cout << "USAGE: [MATCHES] [TIMERS_PER_MATCH] [SIMULATED_MS]" << std::endl;
+		return 1;
+	}
+
+	RunBench("busy", matches * timers_per_match, simulated_ms, true);
+	const uint64_t busy_late_fires = late_fires;
+	RunBench("quiet", matches * timers_per_match, simulated_ms, false);
+	return (busy_late_fires == 0 && late_fires == 0) ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+// Timer wheel tests: a loop that sleeps exactly NextTimerDelay() between
+// AdvanceTimers() calls, as the server's does when nothing else wakes it, must
+// see every timer fire on its exact millisecond and in expiry order
+
+#define _HNS_NO_MAIN
+#include "../main.cpp"
+
+#include <random>
+
+
+typedef struct {
+	uint64_t expiry;
+	uint64_t fired_at = 0; // Loop time the callback ran in; 0 until it ran
+} TestTimer;
+
+std::vector<TestTimer> test_timers;
+std::vector<size_t> firing_order;
+uint64_t test_loop_time = 0;
+
+static inline void ResetTimerWheel() {
+	timer_nodes.clear();
+	free_timer_nodes.clear();
+	timer_bucket_occupancy.fill(0);
+	timer_wheel_time = 0;
+	pending_timers_count = 0;
+	InitTimerWheel();
+
+	test_timers.clear();
+	firing_order.clear();
+	test_loop_time = 0;
+}
+
+static inline TimerID ScheduleTestTimer(const uint64_t delay_ms) {
+	const size_t index = test_timers.size();
+	test_timers.push_back(TestTimer{timer_wheel_time + ((delay_ms == 0) ? 1 : delay_ms)});
+	return ScheduleTimer(delay_ms, [index]{
+		test_timers[index].fired_at = test_loop_time;
+		firing_order.push_back(index);
+	});
+}
+
+// Sleeps from one NextTimerDelay() to the next until no timer is left
+static inline void RunUntilIdle() {
+	while (pending_timers_count > 0) {
+		test_loop_time = timer_wheel_time + NextTimerDelay();
+		AdvanceTimers(test_loop_time);
+	}
+}
+
+static inline bool CheckFiredOnTime(const std::vector<bool>& cancelled) {
+	bool passed = true;
+	for (size_t i = 0; i < test_timers.size(); i++) {
+		if (i < cancelled.size() && cancelled[i]) {
+			if (test_timers[i].fired_at != 0) {
+				std::cout << "  timer " << i << " fired after being cancelled" << std::endl;
+				passed = false;
+			}
+		}
+		else if (test_timers[i].fired_at != test_timers[i].expiry) {
+			std::cout
+			<< "  timer " << i << " due at " << test_timers[i].expiry
+			<< " fired at " << test_timers[i].fired_at << std::endl;
+			passed = false;
+		}
+	}
+	for (size_t i = 1; i < firing_order.size(); i++) {
+		if (test_timers[firing_order[i]].expiry < test_timers[firing_order[i - 1]].expiry) {
+			std::cout << "  timer " << firing_order[i] << " fired after a later one" << std::endl;
+			passed = false;
+		}
+	}
+	return passed;
+}
+
+// A timer still on level 1 is due before the next occupied level 0 slot: the
+// wait has to end at the level 0 wrap that cascades it down, not at that slot
+static bool TestCascadeBeforeLevel0Slot() {
+	ResetTimerWheel();
+
+	ScheduleTestTimer(100); // Level 1, due at 100
+	test_loop_time = 50;
+	AdvanceTimers(test_loop_time);
+	ScheduleTestTimer(60); // Level 0, due at 110; its slot comes after the wrap at 64
+
+	RunUntilIdle();
+	return CheckFiredOnTime({});
+}
+
+// Same, with the level 0 timer in a slot that comes before the wrap
+static bool TestLevel0SlotBeforeCascade() {
+	ResetTimerWheel();
+
+	ScheduleTestTimer(70); // Level 1, due at 70
+	test_loop_time = 40;
+	AdvanceTimers(test_loop_time);
+	ScheduleTestTimer(10); // Level 0, due at 50
+
+	RunUntilIdle();
+	return CheckFiredOnTime({});
+}
+
+// Timers on every level and past the wheel's range, scheduled as time goes on,
+// with some cancelled
+static bool TestRandomTimers() {
+	ResetTimerWheel();
+
+	std::mt19937_64 random(20240517);
+	std::vector<TimerID> timer_ids;
+	std::vector<bool> cancelled;
+	for (int round = 0; round < 200; round++) {
+		for (int i = 0; i < 50; i++) {
+			const int level = random() % (TIMER_WHEEL_LEVELS + 1);
+			const uint64_t range = (level == TIMER_WHEEL_LEVELS)
+				? TIMER_WHEEL_MAX_DELAY * 2
+				: (1ull << (TIMER_WHEEL_SLOT_BITS * (level + 1)));
+			timer_ids.push_back(ScheduleTestTimer(random() % range));
+			cancelled.push_back(false);
+		}
+		for (int i = 0; i < 10; i++) {
+			const size_t index = random() % timer_ids.size();
+			if (!IsTimerPending(timer_ids[index])) continue;
+			CancelTimer(timer_ids[index]);
+			cancelled[index] = true;
+		}
+
+		// Let some time pass the way the loop does
+		for (int step = 0; step < 20 && pending_timers_count > 0; step++) {
+			test_loop_time = timer_wheel_time + NextTimerDelay();
+			AdvanceTimers(test_loop_time);
+		}
+	}
+
+	RunUntilIdle();
+	return CheckFiredOnTime(cancelled);
+}
+
+int main() {
+	const std::vector<std::pair<const char*, bool (*)()>> tests = {
+		{"cascade before level 0 slot", TestCascadeBeforeLevel0Slot},
+		{"level 0 slot before cascade", TestLevel0SlotBeforeCascade},
+		{"random timers", TestRandomTimers}
+	};
+
+	int failed = 0;
+	for (auto const& [name, test] : tests) {
+		const bool passed = test();
+		std::cout << name << ": " << (passed ? "PASSED" : "FAILED") << std::endl;
+		if (!passed) failed++;
+	}
+	return (failed == 0) ? 0 : 1;
+}
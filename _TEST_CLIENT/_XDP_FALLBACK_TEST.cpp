@@ -0,0 +1,138 @@
+// AF_XDP fallback tests: when enet_host_use_xdp() can't attach, it must say so
+// and leave the host exactly as it was, still sending and receiving everything
+// (unreliable included) through its socket, as --xdp then does
+
+#define _HNS_NO_MAIN
+#include "../main.cpp"
+
+
+#define TEST_PORT 55620
+#define TEST_PACKETS 100
+#define SERVICE_ITERATIONS 1000
+
+typedef struct {
+	ENetHost* host;
+	ENetHost* client;
+	ENetPeer* client_peer; // The client's peer for the host
+	ENetPeer* host_peer; // The host's peer for the client
+} Connection;
+
+// Services both ends until the client has connected; false if it doesn't
+static bool Connect(Connection& connection) {
+	ENetAddress address = {0};
+	enet_address_set_host(&address, "127.0.0.1");
+	address.port = TEST_PORT;
+	connection.client = enet_host_create(NULL, 1, 1, 0, 0);
+	if (connection.client == nullptr) return false;
+	connection.host_peer = enet_host_connect(connection.client, &address, 1, 0);
+	connection.client_peer = nullptr;
+
+	ENetEvent event;
+	bool client_connected = false;
+	for (int i = 0; i < SERVICE_ITERATIONS && !(client_connected && connection.client_peer != nullptr); i++) {
+		while (enet_host_service(connection.host, &event, 1) > 0) {
+			if (event.type == ENET_EVENT_TYPE_CONNECT) connection.client_peer = event.peer;
+		}
+		while (enet_host_service(connection.client, &event, 0) > 0) {
+			if (event.type == ENET_EVENT_TYPE_CONNECT) client_connected = true;
+		}
+	}
+	return client_connected && connection.client_peer != nullptr;
+}
+
+// Sends TEST_PACKETS with flags each way, and counts what arrives
+static bool Exchange(Connection& connection, const enet_uint32 flags) {
+	for (int i = 0; i < TEST_PACKETS; i++) {
+		enet_peer_send(connection.host_peer, 0, enet_packet_create(&i, sizeof(i), flags));
+		enet_peer_send(connection.client_peer, 0, enet_packet_create(&i, sizeof(i), flags));
+		enet_host_flush(connection.client);
+		enet_host_flush(connection.host);
+	}
+
+	ENetEvent event;
+	int host_received = 0;
+	int client_received = 0;
+	for (int i = 0; i < SERVICE_ITERATIONS && (host_received < TEST_PACKETS || client_received < TEST_PACKETS); i++) {
+		while (enet_host_service(connection.host, &event, 1) > 0) {
+			if (event.type != ENET_EVENT_TYPE_RECEIVE) continue;
+			host_received++;
+			enet_packet_destroy(event.packet);
+		}
+		while (enet_host_service(connection.client, &event, 0) > 0) {
+			if (event.type != ENET_EVENT_TYPE_RECEIVE) continue;
+			client_received++;
+			enet_packet_destroy(event.packet);
+		}
+	}
+	if (host_received < TEST_PACKETS || client_received < TEST_PACKETS) {
+		std::cout
+		<< "  host received " << host_received << ", client " << client_received
+		<< " of " << TEST_PACKETS << " packets" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static bool TestFallback(const char* interface_name, const enet_uint32 queue) {
+	ENetAddress address = {0};
+	address.host = ENET_HOST_ANY;
+	address.port = TEST_PORT;
+	Connection connection{enet_host_create(&address, MAX_PLAYERS, 1, 0, 0)};
+	if (connection.host == nullptr) {
+		std::cout << "  failed to create the host" << std::endl;
+		return false;
+	}
+
+	bool passed = true;
+	if (enet_host_use_xdp(connection.host, interface_name, queue) == 0) {
+		std::cout << "  attached to " << interface_name << " queue " << queue << std::endl;
+		passed = false;
+	}
+	else if (connection.host->xdp != nullptr) {
+		std::cout << "  left a half attached fast path on the host" << std::endl;
+		passed = false;
+	}
+	else if (!Connect(connection)) {
+		std::cout << "  client failed to connect" << std::endl;
+		passed = false;
+	}
+	else {
+		passed = Exchange(connection, 0) && Exchange(connection, ENET_PACKET_FLAG_UNSEQUENCED) && Exchange(connection, ENET_PACKET_FLAG_RELIABLE);
+	}
+
+	if (connection.client != nullptr) enet_host_destroy(connection.client);
+	enet_host_destroy(connection.host);
+	return passed;
+}
+
+// No such interface: fails before anything is set up
+static bool TestUnknownInterface() {
+	return TestFallback("hns-none0", 0);
+}
+
+// A queue loopback doesn't have: fails binding the AF_XDP socket, after its
+// rings are set up (or earlier, without the privileges for AF_XDP)
+static bool TestBindFailure() {
+	return TestFallback("lo", 4096);
+}
+
+int main() {
+	if (enet_initialize() != 0) {
+		std::cout << "Failed to initialize ENet" << std::endl;
+		return 1;
+	}
+	atexit(enet_deinitialize);
+
+	const std::vector<std::pair<const char*, bool (*)()>> tests = {
+		{"unknown interface", TestUnknownInterface},
+		{"bind failure", TestBindFailure}
+	};
+
+	int failed = 0;
+	for (auto const& [name, test] : tests) {
+		const bool passed = test();
+		std::cout << name << ": " << (passed ? "PASSED" : "FAILED") << std::endl;
+		if (!passed) failed++;
+	}
+	return (failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,254 @@
+#!/bin/bash
+# Builds the server variants a scenario compares and runs _BENCH_CLIENT against
+# each on loopback, printing its latencies and the server's CPU use (Linux)
+#
+# USAGE: ./bench.sh SCENARIO [BOTS] [SYNC_RATE] [SECONDS]
+# SCENARIOS:
+#   poll-loop  Receive-to-relay latency and idle CPU, blocking socket wait vs -D_HNS_POLL_LOOP
+#   timers  Timer wheel microbenchmark (BOTS is the number of matches, 4 timers each)
+#   slow-tick  Round trip time while ticks take 40ms, handled inline vs with --net-thread
+#   flood  Latency between well-behaved bots while bot 0 syncs 100x as fast, --peer-quota 0 (no limit) vs default, inline and with --net-thread
+#   xdp  Datagrams per server CPU-second over veth, socket vs --xdp hx0 (after ./veth.sh up; try SYNC_RATE 1000)
+#   gso  Flush CPU per 1000 datagrams of tick, round transition and map change bursts, socket vs sendmmsg vs sendmmsg + GSO (BOTS is the number of map blocks)
+#   relay  ENet allocations and CPU per relayed PLAYER_SYNC at 8, 32 and 128 players, per-peer copies vs one shared packet (BOTS is the number of ticks)
+#   flush  Datagrams per peer per second, game packets per datagram and header bytes saved by the flush phase, for snapshots and relayed PLAYER_SYNCs (bench client --sync-relay), inline and with --net-thread
+#   snapshots  Snapshot bytes per peer per tick, delta vs full states, with every bot moving and with half of them still, float vs quantized encoding
+#   batch-io  Socket syscalls per tick, datagrams per peer and latency, socket vs -DENET_BATCH_IO (recvmmsg/sendmmsg)
+#   busy-poll  Receive-to-relay p50/p99/p999, sleeping vs --busy-poll (and, with more than one CPU, pinned to the last one with --sched-fifo)
+#   io-uring  Syscalls per tick, latency and server CPU, socket vs --io-uring (falls back to the socket where unavailable)
+
+set -e
+cd "$(dirname "$0")"
+
+SCENARIO=$1
+BOTS=${2:-8}
+SYNC_RATE=${3:-60}
+SECONDS_=${4:-5}
+PORT=55600
+
+WORK=$(mktemp -d)
+
+cat > "$WORK/map.json" << 'EOF'
+[
+ {"data": {}, "pos": [0, 5, 0], "rot": [0, 0, 0], "scale": [1, 1, 1], "type": "Spawn_Hider"},
+ {"data": {}, "pos": [10, 5, 10], "rot": [0, 0, 0], "scale": [1, 1, 1], "type": "Spawn_Seeker"},
+ {"data": {}, "pos": [-50, 0, -50], "rot": [0, 0, 0], "scale": [100, 1, 100], "type": "Block"}
+]
+EOF
+
+# build_server NAME [COMPILER FLAGS]
+build_server() {
+	g++ -std=c++20 -O2 ../main.cpp -pthread "${@:2}" -o "$WORK/$1"
+}
+
+build_client() {
+	g++ -std=c++17 -O2 _BENCH_CLIENT.cpp -pthread -o "$WORK/bench_client"
+}
+
+# In clock ticks (1/100s)
+cpu_ticks() {
+	awk '{print $14 + $15}' "/proc/$1/stat"
+}
+
+# Servers built with it print their --flush-stats report every second
+STATS_FLAGS=-D_HNS_FLUSH_STATS_INTERVAL_MS=1000
+
+# start_server NAME [SERVER OPTIONS]
+start_server() {
+	SERVER_LOG="$WORK/$1.log"
+	"$WORK/$1" "$WORK/map.json" $PORT "${@:2}" > "$SERVER_LOG" 2>&1 &
+	SERVER_PID=$!
+	sleep 0.5
+}
+
+stop_server() {
+	kill $SERVER_PID 2>/dev/null || true
+	wait $SERVER_PID 2>/dev/null || true
+}
+
+trap 'stop_server; rm -rf "$WORK"' EXIT
+
+# run_load LABEL [BENCH CLIENT OPTIONS]; needs a started server
+run_load() {
+	local before=$(cpu_ticks $SERVER_PID)
+	"$WORK/bench_client" $BOTS $SYNC_RATE $SECONDS_ --port $PORT "${@:2}" | sed "s/^/$1 /"
+	echo "$1 server cpu: $(($(cpu_ticks $SERVER_PID) - before)) ticks"
+}
+
+# flush_stats LABEL; prints the last server's --flush-stats report from the
+# middle of its load (built with STATS_FLAGS)
+flush_stats() {
+	local reports=$(grep -c "sends over the last" "$SERVER_LOG" || true)
+	grep "sends over the last" "$SERVER_LOG" | sed -n "$(((reports + 1) / 2))p" | sed "s/^/$1 /"
+}
+
+# hx0 datagrams, both ways
+veth_datagrams() {
+	echo $(($(cat /sys/class/net/hx0/statistics/rx_packets) + $(cat /sys/class/net/hx0/statistics/tx_packets)))
+}
+
+# measure_idle LABEL; needs a started server
+measure_idle() {
+	local before=$(cpu_ticks $SERVER_PID)
+	sleep $SECONDS_
+	echo "$1 idle server cpu over ${SECONDS_}s: $(($(cpu_ticks $SERVER_PID) - before)) ticks"
+}
+
+case "$SCENARIO" in
+	poll-loop)
+		build_client
+		build_server blocking
+		build_server polling -D_HNS_POLL_LOOP
+		for variant in blocking polling; do
+			start_server $variant
+			measure_idle $variant
+			run_load $variant
+			stop_server
+		done
+		;;
+	timers)
+		g++ -std=c++20 -O2 _TIMER_WHEEL_BENCH.cpp -pthread -o "$WORK/timer_wheel_bench"
+		"$WORK/timer_wheel_bench" ${2:-2000}
+		;;
+	slow-tick)
+		build_client
+		build_server fast-tick
+		build_server slow-tick -D_HNS_SLOW_TICK_MS=40
+		start_server fast-tick
+		run_load fast-tick --rtt
+		stop_server
+		start_server slow-tick
+		run_load slow-tick --rtt
+		stop_server
+		start_server slow-tick --net-thread
+		run_load slow-tick-net-thread --rtt
+		stop_server
+		;;
+	flood)
+		build_client
+		build_server server
+		for variant in no-quota quota no-quota-net-thread quota-net-thread; do
+			options=""
+			case $variant in no-quota*) options="--peer-quota 0";; esac
+			case $variant in *net-thread) options="$options --net-thread";; esac
+			start_server server $options
+			run_load $variant --flood 100
+			stop_server
+		done
+		;;
+	xdp)
+		if [ ! -e /sys/class/net/hx0 ]; then
+			echo "No hx0: run ./veth.sh up first (as root)"
+			exit 1
+		fi
+		build_client
+		build_server server
+		for variant in socket xdp; do
+			if [ $variant = xdp ]; then start_server server --xdp hx0; else start_server server; fi
+			before_cpu=$(cpu_ticks $SERVER_PID)
+			before_datagrams=$(veth_datagrams)
+			ip netns exec hnsx "$WORK/bench_client" $BOTS $SYNC_RATE $SECONDS_ --host 10.77.0.1 --port $PORT | sed "s/^/$variant /"
+			cpu=$(($(cpu_ticks $SERVER_PID) - before_cpu))
+			datagrams=$(($(veth_datagrams) - before_datagrams))
+			stop_server
+			grep -i xdp "$WORK/server.log" | sed "s/^/$variant server: /" || true
+			echo "$variant: $datagrams datagrams in $cpu server cpu ticks, $((datagrams * 100 / (cpu > 0 ? cpu : 1))) per cpu-second"
+		done
+		;;
+	gso)
+		# A map whose data takes a few dozen datagrams
+		awk -v blocks=${2:-600} 'BEGIN {
+			srand(1)
+			print "["
+			print " {\"data\": {}, \"pos\": [0, 5, 0], \"rot\": [0, 0, 0], \"scale\": [1, 1, 1], \"type\": \"Spawn_Hider\"},"
+			print " {\"data\": {}, \"pos\": [10, 5, 10], \"rot\": [0, 0, 0], \"scale\": [1, 1, 1], \"type\": \"Spawn_Seeker\"},"
+			for (i = 0; i < blocks; i++) {
+				printf " {\"data\": {}, \"pos\": [%.2f, %.2f, %.2f], \"rot\": [0, %.1f, 0], \"scale\": [%.1f, %.1f, %.1f], \"type\": \"Block\"}%s\n", \
+					rand() * 400 - 200, rand() * 50, rand() * 400 - 200, rand() * 360, \
+					1 + rand() * 19, 1 + rand() * 9, 1 + rand() * 19, (i + 1 < blocks) ? "," : ""
+			}
+			print "]"
+		}' > "$WORK/big_map.json"
+		g++ -std=c++20 -O2 _GSO_BENCH.cpp -pthread -o "$WORK/gso_bench_socket"
+		g++ -std=c++20 -O2 _GSO_BENCH.cpp -pthread -DENET_BATCH_IO -o "$WORK/gso_bench_sendmmsg"
+		g++ -std=c++20 -O2 _GSO_BENCH.cpp -pthread -DENET_BATCH_IO -DENET_UDP_GSO -o "$WORK/gso_bench_gso"
+		for variant in socket sendmmsg gso; do
+			"$WORK/gso_bench_$variant" "$WORK/big_map.json"
+		done
+		;;
+	relay)
+		g++ -std=c++20 -O2 _RELAY_BENCH.cpp -pthread -o "$WORK/relay_bench"
+		for players in 8 32 128; do
+			"$WORK/relay_bench" $players ${2:-500}
+		done
+		;;
+	flush)
+		build_client
+		build_server server $STATS_FLAGS
+		for variant in snapshots sync-relay snapshots-net-thread sync-relay-net-thread; do
+			options="--flush-stats"
+			case $variant in *net-thread) options="$options --net-thread";; esac
+			load_options=""
+			case $variant in sync-relay*) load_options="--sync-relay";; esac
+			start_server server $options
+			run_load $variant $load_options
+			stop_server
+			flush_stats $variant
+		done
+		;;
+	snapshots)
+		build_client
+		build_server server $STATS_FLAGS
+		for variant in moving half-still moving-quantized half-still-quantized; do
+			load_options=""
+			case $variant in half-still*) load_options="--still-bots $((BOTS / 2))";; esac
+			case $variant in *quantized) load_options="$load_options --quantized";; esac
+			start_server server --flush-stats
+			run_load $variant $load_options
+			stop_server
+			flush_stats $variant
+		done
+		;;
+	batch-io)
+		build_client
+		build_server socket $STATS_FLAGS
+		build_server batched $STATS_FLAGS -DENET_BATCH_IO
+		for variant in socket batched; do
+			start_server $variant --flush-stats
+			run_load $variant
+			stop_server
+			flush_stats $variant
+		done
+		;;
+	busy-poll)
+		build_client
+		build_server server
+		variants="sleeping busy-poll"
+		# A real-time spinning server would starve the bots sharing its only CPU
+		if [ "$(nproc)" -gt 1 ]; then variants="$variants busy-poll-pinned"; fi
+		for variant in $variants; do
+			case $variant in
+				sleeping) start_server server;;
+				busy-poll) start_server server --busy-poll;;
+				busy-poll-pinned) start_server server --busy-poll --pin-cpus $(($(nproc) - 1)) --sched-fifo;;
+			esac
+			run_load $variant
+			stop_server
+		done
+		;;
+	io-uring)
+		build_client
+		build_server server $STATS_FLAGS
+		for variant in socket io-uring; do
+			if [ $variant = io-uring ]; then start_server server --io-uring --flush-stats; else start_server server --flush-stats; fi
+			run_load $variant
+			stop_server
+			grep -i "io_uring" "$SERVER_LOG" | sed "s/^/$variant server: /" || true
+			flush_stats $variant
+		done
+		;;
+	*)
+		sed -n '2,/^$/p' "$(basename "$0")" | sed 's/^# \{0,1\}//'
+		exit 1
+		;;
+esac
@@ -0,0 +1,20 @@
+#!/bin/bash
+# Builds and runs every _*_TEST.cpp next to this script; fails if any of them does
+#
+# USAGE: ./test.sh [COMPILER FLAGS]
+
+cd "$(dirname "$0")"
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+failed=0
+for test in _*_TEST.cpp; do
+	echo "== $test"
+	if ! g++ -std=c++20 -O2 "$test" -pthread "$@" -o "$WORK/test"; then
+		failed=1
+		continue
+	fi
+	"$WORK/test" || failed=1
+done
+exit $failed
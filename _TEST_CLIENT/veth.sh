@@ -0,0 +1,29 @@
+#!/bin/bash
+# Sets up (or tears down) the veth pair the xdp bench scenario runs over: the
+# server's end, hx0 (10.77.0.1), stays in this namespace and the clients' end,
+# hx1 (10.77.0.2), goes into the hnsx namespace. Needs root
+#
+# USAGE: ./veth.sh up|down
+
+set -e
+
+case "$1" in
+	up)
+		ip netns add hnsx
+		ip link add hx0 type veth peer name hx1
+		ip link set hx1 netns hnsx
+		ip addr add 10.77.0.1/24 dev hx0
+		ip link set hx0 up
+		ip netns exec hnsx ip addr add 10.77.0.2/24 dev hx1
+		ip netns exec hnsx ip link set hx1 up
+		ip netns exec hnsx ip link set lo up
+		;;
+	down)
+		ip link del hx0 || true
+		ip netns del hnsx || true
+		;;
+	*)
+		sed -n '2,/^$/p' "$0" | sed 's/^# \{0,1\}//'
+		exit 1
+		;;
+esac
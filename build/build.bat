@@ -1 +1 @@
-g++ -O2 ../main.cpp -lws2_32 -lwinmm %* -o HnSServer.exe
\ No newline at end of file
+g++ -std=c++20 -O2 ../main.cpp -lws2_32 -lwinmm %* -o HnSServer.exe
\ No newline at end of file
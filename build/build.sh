@@ -1 +1 @@
-g++ -O2 ../main.cpp $* -o HnSServer
\ No newline at end of file
+g++ -std=c++20 -O2 ../main.cpp -pthread $* -o HnSServer
\ No newline at end of file
@@ -50,6 +50,77 @@
 #define ENET_VERSION_GET_PATCH(version) ((version)&0xFF)
 #define ENET_VERSION ENET_VERSION_CREATE(ENET_VERSION_MAJOR, ENET_VERSION_MINOR, ENET_VERSION_PATCH)
 
+/**
+ * Define ENET_BATCH_IO to drain and flush the host socket with batched
+ * recvmmsg/sendmmsg calls (Linux only; ignored elsewhere). Datagrams are
+ * staged per host in batches of up to ENET_MMSG_BATCH_SIZE.
+ */
+#if defined(ENET_BATCH_IO) && defined(__linux__)
+    #define ENET_USE_MMSG 1
+    #ifndef ENET_MMSG_BATCH_SIZE
+    #define ENET_MMSG_BATCH_SIZE 64
+    #endif
+#endif
+
+/**
+ * Define ENET_UDP_GSO along with ENET_BATCH_IO to coalesce the staged datagrams
+ * bound for one peer into a single UDP_SEGMENT (generic segmentation offload)
+ * send the kernel splits back up. Falls back to plain batching at runtime if the
+ * route refuses segmented sends.
+ */
+#if defined(ENET_UDP_GSO) && defined(ENET_USE_MMSG)
+    #include <netinet/udp.h>
+    #ifdef UDP_SEGMENT
+        #define ENET_USE_UDP_GSO 1
+        #define ENET_UDP_GSO_MAX_SEGMENTS 64
+        #define ENET_UDP_GSO_MAX_BYTES (0xFFFF - 8 - 40) /* UDP length field minus UDP and IPv6 headers */
+    #endif
+#endif
+
+/**
+ * Define ENET_IO_URING to compile in an optional io_uring transport (Linux,
+ * needs kernel headers with multishot receive; ignored elsewhere). A host
+ * only switches to it when enet_host_use_io_uring() succeeds at runtime.
+ */
+#if defined(ENET_IO_URING) && defined(__linux__)
+    #include <linux/io_uring.h>
+    #ifdef IORING_RECV_MULTISHOT
+        #define ENET_USE_IO_URING 1
+        #ifndef ENET_URING_BUFFER_COUNT
+        #define ENET_URING_BUFFER_COUNT 256
+        #endif
+        #ifndef ENET_URING_RECEIVE_ENTRIES
+        #define ENET_URING_RECEIVE_ENTRIES 64
+        #endif
+        #ifndef ENET_URING_SEND_SLOTS
+        #define ENET_URING_SEND_SLOTS 64
+        #endif
+    #endif
+#endif
+
+/**
+ * Define ENET_AF_XDP to compile in an optional AF_XDP fast path (Linux, kernel
+ * 5.9+ for XDP links; ignored elsewhere). Once enet_host_use_xdp() attaches it to
+ * an interface queue, IPv4 datagrams for the host's port whose first ENet command
+ * is unreliable or unsequenced skip the UDP stack, and datagrams to peers heard
+ * from that way leave through it; everything else keeps using the host socket.
+ */
+#if defined(ENET_AF_XDP) && defined(__linux__)
+    #include <linux/if_xdp.h>
+    #include <linux/if_link.h>
+    #include <linux/bpf.h>
+    #ifdef XDP_USE_NEED_WAKEUP
+        #define ENET_USE_XDP 1
+        #ifndef ENET_XDP_FRAME_COUNT
+        #define ENET_XDP_FRAME_COUNT 4096 /* half receive, half transmit */
+        #endif
+        #ifndef ENET_XDP_ROUTES
+        #define ENET_XDP_ROUTES 256
+        #endif
+        #define ENET_XDP_FRAME_SIZE 2048
+    #endif
+#endif
+
 #define ENET_TIME_OVERFLOW 86400000
 #define ENET_TIME_LESS(a, b) ((a) - (b) >= ENET_TIME_OVERFLOW)
 #define ENET_TIME_GREATER(a, b) ((b) - (a) >= ENET_TIME_OVERFLOW)
@@ -166,6 +237,18 @@
     #define MSG_NOSIGNAL 0
     #endif
 
+    /* Every receive path asks for control data room for an SO_TIMESTAMPNS timestamp;
+     * the kernel only fills it in once the socket option is enabled */
+    #ifdef SO_TIMESTAMPNS
+    #define ENET_USE_TIMESTAMPNS 1
+    #define ENET_TIMESTAMP_CONTROL_SIZE CMSG_SPACE(sizeof(struct timespec))
+
+    typedef union {
+        struct cmsghdr header; /* alignment only */
+        unsigned char  data[ENET_TIMESTAMP_CONTROL_SIZE];
+    } ENetTimestampControl;
+    #endif
+
     #ifdef MSG_MAXIOVLEN
     #define ENET_BUFFER_MAXIMUM MSG_MAXIOVLEN
     #endif
@@ -517,6 +600,9 @@ extern "C" {
         ENET_SOCKOPT_NODELAY   = 9,
         ENET_SOCKOPT_IPV6_V6ONLY = 10,
         ENET_SOCKOPT_TTL       = 11,
+        ENET_SOCKOPT_REUSEPORT = 12,
+        ENET_SOCKOPT_BUSY_POLL = 13, /* microseconds to busy-poll the device queue on blocking receives/polls (Linux) */
+        ENET_SOCKOPT_TIMESTAMPNS = 14, /* kernel arrival timestamps on received datagrams, see ENetPacket::receivedTimestamp */
     } ENetSocketOption;
 
     typedef enum _ENetSocketShutdown {
@@ -586,6 +672,7 @@ extern "C" {
         size_t                 dataLength;     /**< length of data */
         ENetPacketFreeCallback freeCallback;   /**< function to be called when the packet is no longer in use */
         void *                 userData;       /**< application private data, may be freely modified */
+        enet_uint64            receivedTimestamp; /**< kernel arrival time (CLOCK_REALTIME ns) of the datagram that started a received packet; 0 if unknown, see ENET_SOCKOPT_TIMESTAMPNS */
     } ENetPacket;
 
     typedef struct _ENetAcknowledgement {
@@ -751,6 +838,46 @@ extern "C" {
         size_t            totalWaitingData;
     } ENetPeer;
 
+    /** Protocol state of a connected peer with nothing in flight, as captured by
+     *  enet_peer_snapshot and restored by enet_host_restore_peer. Plain data, so
+     *  it can be handed to another process running the same build.
+     */
+    typedef struct _ENetPeerSnapshot {
+        enet_uint16 incomingPeerID;
+        enet_uint16 outgoingPeerID;
+        enet_uint32 connectID;
+        enet_uint8  outgoingSessionID;
+        enet_uint8  incomingSessionID;
+        ENetAddress address;
+        enet_uint32 incomingBandwidth;
+        enet_uint32 outgoingBandwidth;
+        enet_uint32 packetThrottle;
+        enet_uint32 packetThrottleLimit;
+        enet_uint32 packetThrottleAcceleration;
+        enet_uint32 packetThrottleDeceleration;
+        enet_uint32 packetThrottleInterval;
+        enet_uint32 pingInterval;
+        enet_uint32 timeoutLimit;
+        enet_uint32 timeoutMinimum;
+        enet_uint32 timeoutMaximum;
+        enet_uint32 roundTripTime;
+        enet_uint32 roundTripTimeVariance;
+        enet_uint32 mtu;
+        enet_uint32 windowSize;
+        enet_uint16 outgoingReliableSequenceNumber;
+        enet_uint16 incomingUnsequencedGroup;
+        enet_uint16 outgoingUnsequencedGroup;
+        enet_uint32 unsequencedWindow[ENET_PEER_UNSEQUENCED_WINDOW_SIZE / 32];
+        enet_uint32 eventData;
+        enet_uint32 channelCount;
+        struct {
+            enet_uint16 outgoingReliableSequenceNumber;
+            enet_uint16 outgoingUnreliableSequenceNumber;
+            enet_uint16 incomingReliableSequenceNumber;
+            enet_uint16 incomingUnreliableSequenceNumber;
+        } channels[ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT];
+    } ENetPeerSnapshot;
+
     /** An ENet packet compressor for compressing UDP packets before socket sends or receives. */
     typedef struct _ENetCompressor {
         /** Context data for the compressor. Must be non-NULL. */
@@ -814,10 +941,16 @@ extern "C" {
         ENetAddress           receivedAddress;
         enet_uint8 *          receivedData;
         size_t                receivedDataLength;
+        enet_uint64           receivedTimestamp;    /**< kernel arrival time (CLOCK_REALTIME ns) of receivedData, 0 if unknown */
         enet_uint32           totalSentData;        /**< total data sent, user should reset to 0 as needed to prevent overflow */
         enet_uint32           totalSentPackets;     /**< total UDP packets sent, user should reset to 0 as needed to prevent overflow */
         enet_uint32           totalReceivedData;    /**< total data received, user should reset to 0 as needed to prevent overflow */
         enet_uint32           totalReceivedPackets; /**< total UDP packets received, user should reset to 0 as needed to prevent overflow */
+        enet_uint32           totalSendCalls;       /**< total socket send syscalls, user should reset to 0 as needed to prevent overflow */
+        enet_uint32           totalReceiveCalls;    /**< total socket receive syscalls, user should reset to 0 as needed to prevent overflow */
+        struct _ENetBatchIO * batch;                /**< staged datagrams when built with ENET_BATCH_IO, otherwise NULL */
+        struct _ENetUring *   uring;                /**< io_uring transport once enabled with enet_host_use_io_uring, otherwise NULL */
+        struct _ENetXdp *     xdp;                  /**< AF_XDP fast path once enabled with enet_host_use_xdp, otherwise NULL */
         ENetInterceptCallback intercept;            /**< callback the user can set to intercept received raw UDP packets */
         size_t                connectedPeers;
         size_t                bandwidthLimitedPeers;
@@ -1012,6 +1145,9 @@ extern "C" {
     ENET_API enet_uint32  enet_crc32(const ENetBuffer *, size_t);
 
     ENET_API ENetHost * enet_host_create(const ENetAddress *, size_t, size_t, enet_uint32, enet_uint32);
+    ENET_API ENetHost * enet_host_create_reuseport(const ENetAddress *, size_t, size_t, enet_uint32, enet_uint32);
+    ENET_API ENetHost * enet_host_create_from_socket(ENetSocket, size_t, size_t, enet_uint32, enet_uint32);
+    ENET_API ENetPeer * enet_host_restore_peer(ENetHost *, const ENetPeerSnapshot *);
     ENET_API void       enet_host_destroy(ENetHost *);
     ENET_API ENetPeer * enet_host_connect(ENetHost *, const ENetAddress *, size_t, enet_uint32);
     ENET_API int        enet_host_check_events(ENetHost *, ENetEvent *);
@@ -1020,7 +1156,12 @@ extern "C" {
     ENET_API int        enet_host_send_raw_ex(ENetHost *host, const ENetAddress* address, enet_uint8* data, size_t skipBytes, size_t bytesToSend);
     ENET_API void       enet_host_set_intercept(ENetHost *, const ENetInterceptCallback);
     ENET_API void       enet_host_flush(ENetHost *);
+    ENET_API size_t     enet_host_pending_receives(ENetHost *);
+    ENET_API int        enet_host_use_io_uring(ENetHost *);
+    ENET_API int        enet_host_use_xdp(ENetHost *, const char *, enet_uint32);
+    ENET_API ENetSocket enet_host_get_wait_socket(ENetHost *);
     ENET_API void       enet_host_broadcast(ENetHost *, enet_uint8, ENetPacket *);
+    ENET_API void       enet_host_broadcast_selective(ENetHost *, enet_uint8, ENetPacket *, ENetPeer **, size_t);
     ENET_API void       enet_host_compress(ENetHost *, const ENetCompressor *);
     ENET_API void       enet_host_channel_limit(ENetHost *, size_t);
     ENET_API void       enet_host_bandwidth_limit(ENetHost *, enet_uint32, enet_uint32);
@@ -1034,6 +1175,7 @@ extern "C" {
     ENET_API void                enet_peer_ping_interval(ENetPeer *, enet_uint32);
     ENET_API void                enet_peer_timeout(ENetPeer *, enet_uint32, enet_uint32, enet_uint32);
     ENET_API void                enet_peer_reset(ENetPeer *);
+    ENET_API int                 enet_peer_snapshot(ENetPeer *, ENetPeerSnapshot *);
     ENET_API void                enet_peer_disconnect(ENetPeer *, enet_uint32);
     ENET_API void                enet_peer_disconnect_now(ENetPeer *, enet_uint32);
     ENET_API void                enet_peer_disconnect_later(ENetPeer *, enet_uint32);
@@ -1059,6 +1201,20 @@ extern "C" {
 #if defined(ENET_IMPLEMENTATION) && !defined(ENET_IMPLEMENTATION_DONE)
 #define ENET_IMPLEMENTATION_DONE 1
 
+#if defined(ENET_USE_IO_URING) || defined(ENET_USE_XDP)
+    #include <sys/syscall.h>
+    #include <sys/mman.h>
+#endif
+
+#ifdef ENET_USE_XDP
+    #include <sys/epoll.h>
+    #include <net/if.h>
+    #include <stddef.h>
+    #ifndef SOL_XDP
+    #define SOL_XDP 283
+    #endif
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -1418,6 +1574,7 @@ extern "C" {
         packet->dataLength   = dataLength;
         packet->freeCallback = NULL;
         packet->userData     = NULL;
+        packet->receivedTimestamp = 0;
 
         return packet;
     }
@@ -1479,6 +1636,7 @@ extern "C" {
         packet->dataLength   = dataLength + dataOffset;
         packet->freeCallback = NULL;
         packet->userData     = NULL;
+        packet->receivedTimestamp = 0;
 
         return packet;
     }
@@ -2798,225 +2956,1459 @@ extern "C" {
         return 0;
     } /* enet_protocol_handle_incoming_commands */
 
-    static int enet_protocol_receive_incoming_commands(ENetHost *host, ENetEvent *event) {
-        int packets;
+#ifdef ENET_USE_TIMESTAMPNS
+    /** Returns the SO_TIMESTAMPNS arrival time (CLOCK_REALTIME ns) carried in received control data, 0 if there is none. */
+    static enet_uint64 enet_socket_read_timestamp(struct msghdr *msgHdr) {
+        struct cmsghdr *control;
 
-        for (packets = 0; packets < 256; ++packets) {
-            int receivedLength;
-            ENetBuffer buffer;
+        for (control = CMSG_FIRSTHDR(msgHdr); control != NULL; control = CMSG_NXTHDR(msgHdr, control)) {
+            if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec timestamp;
 
-            buffer.data       = host->packetData[0];
-            // buffer.dataLength = sizeof (host->packetData[0]);
-            buffer.dataLength = host->mtu;
+                memcpy(&timestamp, CMSG_DATA(control), sizeof(struct timespec));
+                return (enet_uint64) timestamp.tv_sec * 1000000000ULL + (enet_uint64) timestamp.tv_nsec;
+            }
+        }
 
-            receivedLength    = enet_socket_receive(host->socket, &host->receivedAddress, &buffer, 1);
+        return 0;
+    }
 
-            if (receivedLength == -2)
-                continue;
+    /** enet_socket_receive for a single host buffer that also records the datagram's arrival time in host->receivedTimestamp. */
+    static int enet_socket_receive_timestamped(ENetHost *host, ENetAddress *address, enet_uint8 *data) {
+        struct msghdr msgHdr;
+        struct sockaddr_in6 sin;
+        struct iovec vector;
+        ENetTimestampControl control;
+        int recvLength;
 
-            if (receivedLength < 0) {
-                return -1;
-            }
+        vector.iov_base = data;
+        vector.iov_len  = host->mtu;
 
-            if (receivedLength == 0) {
+        memset(&msgHdr, 0, sizeof(struct msghdr));
+        msgHdr.msg_name       = &sin;
+        msgHdr.msg_namelen    = sizeof(struct sockaddr_in6);
+        msgHdr.msg_iov        = &vector;
+        msgHdr.msg_iovlen     = 1;
+        msgHdr.msg_control    = control.data;
+        msgHdr.msg_controllen = sizeof(control.data);
+
+        host->totalReceiveCalls++;
+        recvLength = recvmsg(host->socket, &msgHdr, MSG_NOSIGNAL);
+
+        if (recvLength == -1) {
+            if (errno == EWOULDBLOCK) {
                 return 0;
             }
 
-            host->receivedData       = host->packetData[0];
-            host->receivedDataLength = receivedLength;
+            return -1;
+        }
 
-            host->totalReceivedData += receivedLength;
-            host->totalReceivedPackets++;
+        if (msgHdr.msg_flags & MSG_TRUNC) {
+            return -2;
+        }
 
-            if (host->intercept != NULL) {
-                switch (host->intercept(host, (void *)event)) {
-                    case 1:
-                        if (event != NULL && event->type != ENET_EVENT_TYPE_NONE) {
-                            return 1;
-                        }
+        address->host          = sin.sin6_addr;
+        address->port          = ENET_NET_TO_HOST_16(sin.sin6_port);
+        address->sin6_scope_id = sin.sin6_scope_id;
 
-                        continue;
+        host->receivedTimestamp = enet_socket_read_timestamp(&msgHdr);
+        return recvLength;
+    } /* enet_socket_receive_timestamped */
+#endif /* ENET_USE_TIMESTAMPNS */
+
+#ifdef ENET_USE_MMSG
+    typedef struct _ENetBatchIO {
+        struct mmsghdr      receiveMessages[ENET_MMSG_BATCH_SIZE];
+        struct iovec        receiveVectors[ENET_MMSG_BATCH_SIZE];
+        struct sockaddr_in6 receiveAddresses[ENET_MMSG_BATCH_SIZE];
+        enet_uint8          receiveData[ENET_MMSG_BATCH_SIZE][ENET_PROTOCOL_MAXIMUM_MTU];
+        #ifdef ENET_USE_TIMESTAMPNS
+        ENetTimestampControl receiveControl[ENET_MMSG_BATCH_SIZE];
+        #endif
+        size_t              receiveCount;
+        size_t              receiveIndex;
+        int                 receiveDrained; /* last recvmmsg returned a partial batch */
+
+        /* Staged datagrams, in the order they were sent */
+        struct sockaddr_in6 sendAddresses[ENET_MMSG_BATCH_SIZE];
+        enet_uint8          sendData[ENET_MMSG_BATCH_SIZE][ENET_PROTOCOL_MAXIMUM_MTU];
+        size_t              sendLengths[ENET_MMSG_BATCH_SIZE];
+        size_t              sendCount;
+
+        /* Messages built from them at flush time; sendVectors is in message order,
+         * each message owning sendSegments[i] consecutive vectors from sendPositions[i] */
+        struct mmsghdr      sendMessages[ENET_MMSG_BATCH_SIZE];
+        struct iovec        sendVectors[ENET_MMSG_BATCH_SIZE];
+        size_t              sendOrder[ENET_MMSG_BATCH_SIZE]; /* staged datagram behind each vector */
+        size_t              sendPositions[ENET_MMSG_BATCH_SIZE];
+        size_t              sendSegments[ENET_MMSG_BATCH_SIZE];
+        #ifdef ENET_USE_UDP_GSO
+        enet_uint8          sendControl[ENET_MMSG_BATCH_SIZE][CMSG_SPACE(sizeof(enet_uint16))];
+        int                 gsoUnavailable;
+        #endif
+    } ENetBatchIO;
 
-                    case -1:
-                        return -1;
+    /** Returns the next received datagram, refilling the batch with one recvmmsg call when it runs dry.
+     *  Same return convention as enet_socket_receive; *data points into the batch on success.
+     */
+    static int enet_batch_receive(ENetHost *host, ENetAddress *address, enet_uint8 **data) {
+        ENetBatchIO *batch = host->batch;
+        struct mmsghdr *message;
+        struct sockaddr_in6 *sin;
+        size_t index;
+
+        if (batch->receiveIndex >= batch->receiveCount) {
+            int received, i;
+
+            batch->receiveIndex = 0;
+            batch->receiveCount = 0;
+
+            /* A partial batch means the socket was empty a moment ago; report that
+             * instead of spending another syscall on EWOULDBLOCK */
+            if (batch->receiveDrained) {
+                batch->receiveDrained = 0;
+                return 0;
+            }
 
-                    default:
-                        break;
-                }
+            for (i = 0; i < ENET_MMSG_BATCH_SIZE; ++i) {
+                batch->receiveVectors[i].iov_base = batch->receiveData[i];
+                batch->receiveVectors[i].iov_len  = host->mtu;
+
+                memset(&batch->receiveMessages[i], 0, sizeof(struct mmsghdr));
+                batch->receiveMessages[i].msg_hdr.msg_name    = &batch->receiveAddresses[i];
+                batch->receiveMessages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+                batch->receiveMessages[i].msg_hdr.msg_iov     = &batch->receiveVectors[i];
+                batch->receiveMessages[i].msg_hdr.msg_iovlen  = 1;
+                #ifdef ENET_USE_TIMESTAMPNS
+                batch->receiveMessages[i].msg_hdr.msg_control    = batch->receiveControl[i].data;
+                batch->receiveMessages[i].msg_hdr.msg_controllen = ENET_TIMESTAMP_CONTROL_SIZE;
+                #endif
             }
 
-            switch (enet_protocol_handle_incoming_commands(host, event)) {
-                case 1:
-                    return 1;
+            received = recvmmsg(host->socket, batch->receiveMessages, ENET_MMSG_BATCH_SIZE, MSG_DONTWAIT, NULL);
+            host->totalReceiveCalls++;
 
-                case -1:
-                    return -1;
+            if (received == -1) {
+                if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                    return 0;
+                }
 
-                default:
-                    break;
+                if (errno == EINTR) {
+                    return -2;
+                }
+
+                return -1;
             }
-        }
 
-        return -1;
-    } /* enet_protocol_receive_incoming_commands */
+            if (received == 0) {
+                return 0;
+            }
 
-    static void enet_protocol_send_acknowledgements(ENetHost *host, ENetPeer *peer) {
-        ENetProtocol *command = &host->commands[host->commandCount];
-        ENetBuffer *buffer    = &host->buffers[host->bufferCount];
-        ENetAcknowledgement *acknowledgement;
-        ENetListIterator currentAcknowledgement;
-        enet_uint16 reliableSequenceNumber;
+            batch->receiveCount   = received;
+            batch->receiveDrained = received < ENET_MMSG_BATCH_SIZE;
+        }
 
-        currentAcknowledgement = enet_list_begin(&peer->acknowledgements);
+        index   = batch->receiveIndex++;
+        message = &batch->receiveMessages[index];
+        sin     = &batch->receiveAddresses[index];
 
-        while (currentAcknowledgement != enet_list_end(&peer->acknowledgements)) {
-            if (command >= &host->commands[sizeof(host->commands) / sizeof(ENetProtocol)] ||
-                buffer >= &host->buffers[sizeof(host->buffers) / sizeof(ENetBuffer)] ||
-                peer->mtu - host->packetSize < sizeof(ENetProtocolAcknowledge)
-            ) {
-                peer->flags |= ENET_PEER_FLAG_CONTINUE_SENDING;
-                break;
-            }
+        if ((message->msg_hdr.msg_flags & MSG_TRUNC) || message->msg_len == 0) {
+            return -2;
+        }
 
-            acknowledgement = (ENetAcknowledgement *) currentAcknowledgement;
-            currentAcknowledgement = enet_list_next(currentAcknowledgement);
+        address->host           = sin->sin6_addr;
+        address->port           = ENET_NET_TO_HOST_16(sin->sin6_port);
+        address->sin6_scope_id  = sin->sin6_scope_id;
 
-            buffer->data       = command;
-            buffer->dataLength = sizeof(ENetProtocolAcknowledge);
-            host->packetSize += buffer->dataLength;
+        #ifdef ENET_USE_TIMESTAMPNS
+        host->receivedTimestamp = enet_socket_read_timestamp(&message->msg_hdr);
+        #endif
 
-            reliableSequenceNumber = ENET_HOST_TO_NET_16(acknowledgement->command.header.reliableSequenceNumber);
+        *data = batch->receiveData[index];
+        return (int) message->msg_len;
+    } /* enet_batch_receive */
 
-            command->header.command   = ENET_PROTOCOL_COMMAND_ACKNOWLEDGE;
-            command->header.channelID = acknowledgement->command.header.channelID;
-            command->header.reliableSequenceNumber = reliableSequenceNumber;
-            command->acknowledge.receivedReliableSequenceNumber = reliableSequenceNumber;
-            command->acknowledge.receivedSentTime = ENET_HOST_TO_NET_16(acknowledgement->sentTime);
+    /** Makes message `index` out of `segments` vectors starting at `position`; more than one
+     *  segment becomes a UDP_SEGMENT send split every `segmentSize` bytes.
+     */
+    static void enet_batch_set_message(ENetBatchIO *batch, size_t index, size_t position, size_t segments, size_t segmentSize) {
+        struct mmsghdr *message = &batch->sendMessages[index];
 
-            if ((acknowledgement->command.header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_DISCONNECT) {
-                enet_protocol_dispatch_state(host, peer, ENET_PEER_STATE_ZOMBIE);
-            }
+        memset(message, 0, sizeof(struct mmsghdr));
+        message->msg_hdr.msg_name    = &batch->sendAddresses[batch->sendOrder[position]];
+        message->msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+        message->msg_hdr.msg_iov     = &batch->sendVectors[position];
+        message->msg_hdr.msg_iovlen  = segments;
 
-            enet_list_remove(&acknowledgement->acknowledgementList);
-            enet_free(acknowledgement);
+        #ifdef ENET_USE_UDP_GSO
+        if (segments > 1) {
+            struct cmsghdr *control;
 
-            ++command;
-            ++buffer;
+            message->msg_hdr.msg_control    = batch->sendControl[index];
+            message->msg_hdr.msg_controllen = sizeof(batch->sendControl[index]);
+
+            control             = CMSG_FIRSTHDR(&message->msg_hdr);
+            control->cmsg_level = SOL_UDP;
+            control->cmsg_type  = UDP_SEGMENT;
+            control->cmsg_len   = CMSG_LEN(sizeof(enet_uint16));
+            *(enet_uint16 *) CMSG_DATA(control) = (enet_uint16) segmentSize;
         }
+        #else
+        ENET_UNUSED(segmentSize)
+        #endif
 
-        host->commandCount = command - host->commands;
-        host->bufferCount  = buffer - host->buffers;
-    } /* enet_protocol_send_acknowledgements */
+        batch->sendPositions[index] = position;
+        batch->sendSegments[index]  = segments;
+    }
 
-    static int enet_protocol_check_timeouts(ENetHost *host, ENetPeer *peer, ENetEvent *event) {
-        ENetOutgoingCommand *outgoingCommand;
-        ENetListIterator currentCommand, insertPosition, insertSendReliablePosition;
+    /** Builds one message per staged datagram from `position` on, numbering them from `index`.
+     *  Returns the total message count.
+     */
+    static size_t enet_batch_build_single(ENetBatchIO *batch, size_t index, size_t position) {
+        for (; position < batch->sendCount; ++position, ++index) {
+            enet_batch_set_message(batch, index, position, 1, 0);
+        }
 
-        currentCommand = enet_list_begin(&peer->sentReliableCommands);
-        insertPosition = enet_list_begin(&peer->outgoingCommands);
-        insertSendReliablePosition = enet_list_begin(&peer->outgoingSendReliableCommands);
+        return index;
+    }
 
-        while (currentCommand != enet_list_end(&peer->sentReliableCommands)) {
-            outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+#ifdef ENET_USE_UDP_GSO
+    /** Builds messages that coalesce each peer's staged datagrams into UDP_SEGMENT sends.
+     *  Every segment but the last must be exactly as long as the first, so a run ends at
+     *  the first datagram for that peer which is longer (it starts the next run) or shorter
+     *  (it ends this one); datagrams to a peer keep their relative order. Returns the message count.
+     */
+    static size_t enet_batch_build_coalesced(ENetBatchIO *batch) {
+        enet_uint8 taken[ENET_MMSG_BATCH_SIZE];
+        size_t position = 0, messageCount = 0, i, j;
 
-            currentCommand = enet_list_next(currentCommand);
+        memset(taken, 0, sizeof(taken));
 
-            if (ENET_TIME_DIFFERENCE(host->serviceTime, outgoingCommand->sentTime) < outgoingCommand->roundTripTimeout) {
+        for (i = 0; i < batch->sendCount; ++i) {
+            size_t segmentSize, segments = 1, bytes, first = position;
+
+            if (taken[i]) {
                 continue;
             }
 
-            if (peer->earliestTimeout == 0 || ENET_TIME_LESS(outgoingCommand->sentTime, peer->earliestTimeout)) {
-                peer->earliestTimeout = outgoingCommand->sentTime;
-            }
+            segmentSize = bytes = batch->sendLengths[i];
+            batch->sendOrder[position++] = i;
 
-            if (peer->earliestTimeout != 0 &&
-                (ENET_TIME_DIFFERENCE(host->serviceTime, peer->earliestTimeout) >= peer->timeoutMaximum ||
-                ((1u << (outgoingCommand->sendAttempts - 1)) >= peer->timeoutLimit &&
-                ENET_TIME_DIFFERENCE(host->serviceTime, peer->earliestTimeout) >= peer->timeoutMinimum))
-            ) {
-                enet_protocol_notify_disconnect_timeout(host, peer, event);
-                return 1;
-            }
+            for (j = i + 1; j < batch->sendCount; ++j) {
+                size_t length = batch->sendLengths[j];
 
-            ++peer->packetsLost;
-            ++peer->totalPacketsLost;
+                if (taken[j] || memcmp(&batch->sendAddresses[i], &batch->sendAddresses[j], sizeof(struct sockaddr_in6)) != 0) {
+                    continue;
+                }
 
-            /* Replaced exponential backoff time with something more linear */
-            /* Source: http://lists.cubik.org/pipermail/enet-discuss/2014-May/002308.html */
-            outgoingCommand->roundTripTimeout = peer->roundTripTime + 4 * peer->roundTripTimeVariance;
+                if (length > segmentSize || segments >= ENET_UDP_GSO_MAX_SEGMENTS || bytes + length > ENET_UDP_GSO_MAX_BYTES) {
+                    break;
+                }
 
-            if (outgoingCommand->packet != NULL) {
-                peer->reliableDataInTransit -= outgoingCommand->fragmentLength;
-                enet_list_insert(insertSendReliablePosition, enet_list_remove (& outgoingCommand->outgoingCommandList));
-            } else {
-                enet_list_insert(insertPosition, enet_list_remove (& outgoingCommand->outgoingCommandList));
-            }
+                taken[j] = 1;
+                batch->sendOrder[position++] = j;
+                segments++;
+                bytes += length;
 
-            if (currentCommand == enet_list_begin(&peer->sentReliableCommands) && !enet_list_empty(&peer->sentReliableCommands)) {
-                outgoingCommand = (ENetOutgoingCommand *) currentCommand;
-                peer->nextTimeout = outgoingCommand->sentTime + outgoingCommand->roundTripTimeout;
+                if (length < segmentSize) {
+                    break;
+                }
             }
+
+            enet_batch_set_message(batch, messageCount++, first, segments, segmentSize);
         }
 
-        return 0;
-    } /* enet_protocol_check_timeouts */
+        return messageCount;
+    }
+#endif /* ENET_USE_UDP_GSO */
 
-    static int enet_protocol_check_outgoing_commands(ENetHost *host, ENetPeer *peer, ENetList *sentUnreliableCommands) {
-        ENetProtocol *command = &host->commands[host->commandCount];
-        ENetBuffer *buffer    = &host->buffers[host->bufferCount];
-        ENetOutgoingCommand *outgoingCommand = NULL;
-        ENetListIterator currentCommand, currentSendReliableCommand;
-        ENetChannel *channel = NULL;
-        enet_uint16 reliableWindow = 0;
-        size_t commandSize=0;
-        int windowWrap = 0, canPing = 1;
+    /** Sends every staged datagram with as few sendmmsg calls as possible. */
+    static int enet_batch_flush(ENetHost *host) {
+        ENetBatchIO *batch = host->batch;
+        size_t sent = 0, messageCount, i;
 
-        currentCommand = enet_list_begin(&peer->outgoingCommands);
-        currentSendReliableCommand = enet_list_begin (&peer->outgoingSendReliableCommands);
+        for (i = 0; i < batch->sendCount; ++i) {
+            batch->sendOrder[i] = i;
+        }
 
-        for (;;) {
-            if (currentCommand != enet_list_end (& peer->outgoingCommands))
-            {
-                outgoingCommand = (ENetOutgoingCommand *) currentCommand;
-                if (currentSendReliableCommand != enet_list_end (& peer->outgoingSendReliableCommands) && ENET_TIME_LESS (((ENetOutgoingCommand *) currentSendReliableCommand)->queueTime, outgoingCommand->queueTime)) {
-                    goto useSendReliableCommand;
-                }
-                currentCommand = enet_list_next (currentCommand);
-            } else if (currentSendReliableCommand != enet_list_end (& peer->outgoingSendReliableCommands)) {
-                useSendReliableCommand:
-                outgoingCommand = (ENetOutgoingCommand *) currentSendReliableCommand;
-                currentSendReliableCommand = enet_list_next (currentSendReliableCommand);
-            } else {
-                break;
-            }
+        #ifdef ENET_USE_UDP_GSO
+        messageCount = batch->gsoUnavailable ? enet_batch_build_single(batch, 0, 0) : enet_batch_build_coalesced(batch);
+        #else
+        messageCount = enet_batch_build_single(batch, 0, 0);
+        #endif
 
+        for (i = 0; i < batch->sendCount; ++i) {
+            batch->sendVectors[i].iov_base = batch->sendData[batch->sendOrder[i]];
+            batch->sendVectors[i].iov_len  = batch->sendLengths[batch->sendOrder[i]];
+        }
 
-            if (outgoingCommand->command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE) {
-                channel = outgoingCommand->command.header.channelID < peer->channelCount ? & peer->channels [outgoingCommand->command.header.channelID] : NULL;
-                reliableWindow = outgoingCommand->reliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
-                if (channel != NULL) {
-                    if (windowWrap) {
-                        continue;
-                    } else if (outgoingCommand->sendAttempts < 1 && 
-                            !(outgoingCommand->reliableSequenceNumber % ENET_PEER_RELIABLE_WINDOW_SIZE) &&
-                            (channel->reliableWindows [(reliableWindow + ENET_PEER_RELIABLE_WINDOWS - 1) % ENET_PEER_RELIABLE_WINDOWS] >= ENET_PEER_RELIABLE_WINDOW_SIZE ||
-                            channel->usedReliableWindows & ((((1u << (ENET_PEER_FREE_RELIABLE_WINDOWS + 2)) - 1) << reliableWindow) | 
-                            (((1u << (ENET_PEER_FREE_RELIABLE_WINDOWS + 2)) - 1) >> (ENET_PEER_RELIABLE_WINDOWS - reliableWindow))))) 
-                    {
-                        windowWrap = 1;
-                        currentSendReliableCommand = enet_list_end (& peer->outgoingSendReliableCommands);
-                        continue;
-                    }
-                }
+        while (sent < messageCount) {
+            int result = sendmmsg(host->socket, &batch->sendMessages[sent], messageCount - sent, MSG_NOSIGNAL);
+            host->totalSendCalls++;
 
-                if (outgoingCommand->packet != NULL) {
-                    enet_uint32 windowSize = (peer->packetThrottle * peer->windowSize) / ENET_PEER_PACKET_THROTTLE_SCALE;
+            if (result == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
 
-                    if (peer->reliableDataInTransit + outgoingCommand->fragmentLength > ENET_MAX (windowSize, peer->mtu))
-                    {
-                        currentSendReliableCommand = enet_list_end (& peer->outgoingSendReliableCommands);
-                        continue;
-                    }
+                #ifdef ENET_USE_UDP_GSO
+                /* No checksum offload on the route (EIO) or segmentation refused (EINVAL):
+                 * stop coalescing for this host and resend the rest one datagram per message */
+                if ((errno == EIO || errno == EINVAL) && batch->sendSegments[sent] > 1) {
+                    batch->gsoUnavailable = 1;
+                    messageCount = enet_batch_build_single(batch, sent, batch->sendPositions[sent]);
+                    continue;
+                }
+                #endif
+
+                /* Same as enet_socket_send: a full socket buffer or an oversized datagram drops it */
+                if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                    break;
+                }
+
+                if (errno == EMSGSIZE) {
+                    ++sent;
+                    continue;
+                }
+
+                batch->sendCount = 0;
+                return -1;
+            }
+
+            sent += result;
+        }
+
+        batch->sendCount = 0;
+        return 0;
+    } /* enet_batch_flush */
+
+    /** Copies a datagram into the send batch, flushing first if the batch is full. */
+    static int enet_batch_send(ENetHost *host, const ENetAddress *address, const ENetBuffer *buffers, size_t bufferCount) {
+        ENetBatchIO *batch = host->batch;
+        struct sockaddr_in6 *sin;
+        enet_uint8 *data;
+        size_t index, length = 0, i;
+
+        if (batch->sendCount >= ENET_MMSG_BATCH_SIZE && enet_batch_flush(host) < 0) {
+            return -1;
+        }
+
+        index = batch->sendCount;
+        data  = batch->sendData[index];
+
+        for (i = 0; i < bufferCount; ++i) {
+            if (length + buffers[i].dataLength > ENET_PROTOCOL_MAXIMUM_MTU) {
+                return -2;
+            }
+
+            memcpy(data + length, buffers[i].data, buffers[i].dataLength);
+            length += buffers[i].dataLength;
+        }
+
+        sin = &batch->sendAddresses[index];
+        memset(sin, 0, sizeof(struct sockaddr_in6));
+        sin->sin6_family   = AF_INET6;
+        sin->sin6_port     = ENET_HOST_TO_NET_16(address->port);
+        sin->sin6_addr     = address->host;
+        sin->sin6_scope_id = address->sin6_scope_id;
+
+        batch->sendLengths[index] = length;
+        batch->sendCount++;
+        return (int) length;
+    } /* enet_batch_send */
+#endif /* ENET_USE_MMSG */
+
+#ifdef ENET_USE_IO_URING
+    #define ENET_URING_RECEIVE_TAG 0xFFFFFFFFFFFFFFFFULL
+    #define ENET_URING_PROVIDE_TAG 0xFFFFFFFFFFFFFFFEULL
+
+    typedef struct _ENetUringQueue {
+        int                   fd;
+        void *                sqRing;
+        size_t                sqRingSize;
+        void *                cqRing;
+        size_t                cqRingSize;
+        struct io_uring_sqe * sqes;
+        size_t                sqesSize;
+        unsigned *            sqHead;
+        unsigned *            sqTail;
+        unsigned *            sqMask;
+        unsigned *            sqArray;
+        unsigned *            cqHead;
+        unsigned *            cqTail;
+        unsigned *            cqMask;
+        struct io_uring_cqe * cqes;
+    } ENetUringQueue;
+
+    typedef struct _ENetUring {
+        /* Receive: one multishot recvmsg landing datagrams in buffers provided to the kernel */
+        ENetUringQueue            receiveQueue;
+        enet_uint8 *              buffers;
+        size_t                    bufferSize;
+        struct msghdr             receiveTemplate;
+        int                       receiveArmed;
+        int                       heldBuffer; /* buffer the last returned datagram lives in, -1 if none */
+        unsigned                  pendingProvides; /* buffers handed back but not yet submitted */
+
+        /* Send: datagrams staged per flush and submitted with a single io_uring_enter */
+        ENetUringQueue            sendQueue;
+        struct msghdr             sendMessages[ENET_URING_SEND_SLOTS];
+        struct iovec              sendVectors[ENET_URING_SEND_SLOTS];
+        struct sockaddr_in6       sendAddresses[ENET_URING_SEND_SLOTS];
+        enet_uint8                sendData[ENET_URING_SEND_SLOTS][ENET_PROTOCOL_MAXIMUM_MTU];
+        size_t                    sendCount;
+    } ENetUring;
+
+    static int enet_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return (int) syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+    }
+
+    static void enet_uring_queue_destroy(ENetUringQueue *queue) {
+        if (queue->sqes != NULL && queue->sqes != MAP_FAILED) {
+            munmap(queue->sqes, queue->sqesSize);
+        }
+        if (queue->cqRing != NULL && queue->cqRing != MAP_FAILED && queue->cqRing != queue->sqRing) {
+            munmap(queue->cqRing, queue->cqRingSize);
+        }
+        if (queue->sqRing != NULL && queue->sqRing != MAP_FAILED) {
+            munmap(queue->sqRing, queue->sqRingSize);
+        }
+        if (queue->fd >= 0) {
+            close(queue->fd);
+        }
+        memset(queue, 0, sizeof(ENetUringQueue));
+        queue->fd = -1;
+    }
+
+    static int enet_uring_queue_create(ENetUringQueue *queue, unsigned entries) {
+        struct io_uring_params params;
+
+        memset(queue, 0, sizeof(ENetUringQueue));
+        memset(&params, 0, sizeof(struct io_uring_params));
+
+        queue->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+        if (queue->fd < 0) {
+            queue->fd = -1;
+            return -1;
+        }
+
+        queue->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        queue->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            queue->sqRingSize = queue->cqRingSize = ENET_MAX(queue->sqRingSize, queue->cqRingSize);
+        }
+
+        queue->sqRing = mmap(NULL, queue->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, queue->fd, IORING_OFF_SQ_RING);
+        if (queue->sqRing == MAP_FAILED) {
+            enet_uring_queue_destroy(queue);
+            return -1;
+        }
+
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            queue->cqRing = queue->sqRing;
+        } else {
+            queue->cqRing = mmap(NULL, queue->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, queue->fd, IORING_OFF_CQ_RING);
+            if (queue->cqRing == MAP_FAILED) {
+                enet_uring_queue_destroy(queue);
+                return -1;
+            }
+        }
+
+        queue->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        queue->sqes = (struct io_uring_sqe *) mmap(NULL, queue->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, queue->fd, IORING_OFF_SQES);
+        if (queue->sqes == MAP_FAILED) {
+            enet_uring_queue_destroy(queue);
+            return -1;
+        }
+
+        queue->sqHead  = (unsigned *) ((char *) queue->sqRing + params.sq_off.head);
+        queue->sqTail  = (unsigned *) ((char *) queue->sqRing + params.sq_off.tail);
+        queue->sqMask  = (unsigned *) ((char *) queue->sqRing + params.sq_off.ring_mask);
+        queue->sqArray = (unsigned *) ((char *) queue->sqRing + params.sq_off.array);
+        queue->cqHead  = (unsigned *) ((char *) queue->cqRing + params.cq_off.head);
+        queue->cqTail  = (unsigned *) ((char *) queue->cqRing + params.cq_off.tail);
+        queue->cqMask  = (unsigned *) ((char *) queue->cqRing + params.cq_off.ring_mask);
+        queue->cqes    = (struct io_uring_cqe *) ((char *) queue->cqRing + params.cq_off.cqes);
+
+        return 0;
+    }
+
+    /** Returns a zeroed SQE at the submission tail; published by enet_uring_publish_sqe. */
+    static struct io_uring_sqe * enet_uring_get_sqe(ENetUringQueue *queue) {
+        unsigned tail = *queue->sqTail;
+        unsigned index = tail & *queue->sqMask;
+        struct io_uring_sqe *sqe = &queue->sqes[index];
+
+        memset(sqe, 0, sizeof(struct io_uring_sqe));
+        queue->sqArray[index] = index;
+        return sqe;
+    }
+
+    static void enet_uring_publish_sqe(ENetUringQueue *queue) {
+        __atomic_store_n(queue->sqTail, *queue->sqTail + 1, __ATOMIC_RELEASE);
+    }
+
+    /** Queues a PROVIDE_BUFFERS request for count buffers starting at firstBufferID; submitted
+     *  along with the next io_uring_enter on the receive queue.
+     */
+    static void enet_uring_provide_buffers(ENetUring *uring, int firstBufferID, int count) {
+        struct io_uring_sqe *sqe = enet_uring_get_sqe(&uring->receiveQueue);
+
+        sqe->opcode    = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd        = count;
+        sqe->addr      = (unsigned long long) (uintptr_t) (uring->buffers + (size_t) firstBufferID * uring->bufferSize);
+        sqe->len       = (unsigned) uring->bufferSize;
+        sqe->off       = (unsigned long long) firstBufferID;
+        sqe->buf_group = 0;
+        sqe->flags     = IOSQE_CQE_SKIP_SUCCESS;
+        sqe->user_data = ENET_URING_PROVIDE_TAG;
+        enet_uring_publish_sqe(&uring->receiveQueue);
+
+        uring->pendingProvides++;
+    }
+
+    static int enet_uring_submit_provides(ENetHost *host) {
+        ENetUring *uring = host->uring;
+        unsigned count = uring->pendingProvides;
+
+        if (count == 0) {
+            return 0;
+        }
+
+        uring->pendingProvides = 0;
+        host->totalReceiveCalls++;
+        return enet_uring_enter(uring->receiveQueue.fd, count, 0, 0) == (int) count ? 0 : -1;
+    }
+
+    static int enet_uring_recycle_buffer(ENetHost *host, int bufferID) {
+        enet_uring_provide_buffers(host->uring, bufferID, 1);
+
+        /* Returned buffers are batched; the backlog stays far below ENET_URING_BUFFER_COUNT and
+         * leaves room in the submission queue for the receive re-arm */
+        if (host->uring->pendingProvides >= ENET_URING_RECEIVE_ENTRIES / 2) {
+            return enet_uring_submit_provides(host);
+        }
+
+        return 0;
+    }
+
+    static int enet_uring_arm_receive(ENetHost *host) {
+        ENetUring *uring = host->uring;
+        struct io_uring_sqe *sqe = enet_uring_get_sqe(&uring->receiveQueue);
+        unsigned toSubmit = uring->pendingProvides + 1;
+
+        sqe->opcode    = IORING_OP_RECVMSG;
+        sqe->fd        = host->socket;
+        sqe->addr      = (unsigned long long) (uintptr_t) &uring->receiveTemplate;
+        sqe->len       = 1;
+        sqe->ioprio    = IORING_RECV_MULTISHOT;
+        sqe->flags     = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = 0;
+        sqe->user_data = ENET_URING_RECEIVE_TAG;
+        enet_uring_publish_sqe(&uring->receiveQueue);
+
+        /* Buffers handed back since the last submit go in with the re-arm */
+        uring->pendingProvides = 0;
+        host->totalReceiveCalls++;
+        if (enet_uring_enter(uring->receiveQueue.fd, toSubmit, 0, 0) != (int) toSubmit) {
+            return -1;
+        }
+
+        uring->receiveArmed = 1;
+        return 0;
+    }
+
+    static void enet_uring_destroy(ENetUring *uring) {
+        enet_uring_queue_destroy(&uring->receiveQueue);
+        enet_uring_queue_destroy(&uring->sendQueue);
+        enet_free(uring->buffers);
+        enet_free(uring);
+    }
+
+    /** Returns the next datagram the multishot receive landed in a provided buffer.
+     *  Same return convention as enet_socket_receive; *data points into the buffer, which
+     *  stays owned by the host until the next call.
+     */
+    static int enet_uring_receive(ENetHost *host, ENetAddress *address, enet_uint8 **data) {
+        ENetUring *uring = host->uring;
+        ENetUringQueue *queue = &uring->receiveQueue;
+        int rearmed = 0;
+
+        if (uring->heldBuffer >= 0) {
+            int bufferID = uring->heldBuffer;
+
+            uring->heldBuffer = -1;
+            if (enet_uring_recycle_buffer(host, bufferID) < 0) {
+                return -1;
+            }
+        }
+
+        for (;;) {
+            unsigned head = *queue->cqHead;
+            struct io_uring_cqe cqe;
+            struct io_uring_recvmsg_out *out;
+            struct sockaddr_in6 *sin;
+            enet_uint8 *buffer;
+            int bufferID;
+
+            if (head == __atomic_load_n(queue->cqTail, __ATOMIC_ACQUIRE)) {
+                if (uring->receiveArmed) {
+                    return 0;
+                }
+
+                /* Multishot ended (e.g. ran out of buffers); re-arm once before reporting empty so waits stay valid */
+                if (rearmed || enet_uring_arm_receive(host) < 0) {
+                    return rearmed ? 0 : -1;
+                }
+                rearmed = 1;
+                continue;
+            }
+
+            cqe = queue->cqes[head & *queue->cqMask];
+            __atomic_store_n(queue->cqHead, head + 1, __ATOMIC_RELEASE);
+
+            if (cqe.user_data == ENET_URING_PROVIDE_TAG) {
+                return -1;
+            }
+
+            if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                uring->receiveArmed = 0;
+            }
+
+            if (cqe.res < 0) {
+                if (cqe.res == -ENOBUFS || cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                    continue;
+                }
+
+                return -1;
+            }
+
+            if (!(cqe.flags & IORING_CQE_F_BUFFER)) {
+                continue;
+            }
+
+            bufferID = (int) (cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            buffer   = uring->buffers + (size_t) bufferID * uring->bufferSize;
+            out      = (struct io_uring_recvmsg_out *) buffer;
+
+            if ((out->flags & MSG_TRUNC) || out->payloadlen == 0) {
+                return enet_uring_recycle_buffer(host, bufferID) < 0 ? -1 : -2;
+            }
+
+            sin = (struct sockaddr_in6 *) (buffer + sizeof(struct io_uring_recvmsg_out));
+            address->host          = sin->sin6_addr;
+            address->port          = ENET_NET_TO_HOST_16(sin->sin6_port);
+            address->sin6_scope_id = sin->sin6_scope_id;
+
+            #ifdef ENET_USE_TIMESTAMPNS
+            {
+                struct msghdr controlHdr;
+
+                memset(&controlHdr, 0, sizeof(struct msghdr));
+                controlHdr.msg_control    = buffer + sizeof(struct io_uring_recvmsg_out) + uring->receiveTemplate.msg_namelen;
+                controlHdr.msg_controllen = out->controllen;
+                host->receivedTimestamp = enet_socket_read_timestamp(&controlHdr);
+            }
+            #endif
+
+            uring->heldBuffer = bufferID;
+            *data = buffer + sizeof(struct io_uring_recvmsg_out) + uring->receiveTemplate.msg_namelen + uring->receiveTemplate.msg_controllen;
+            return (int) out->payloadlen;
+        }
+    } /* enet_uring_receive */
+
+    /** Submits every staged datagram with one io_uring_enter and reaps their completions. */
+    static int enet_uring_flush(ENetHost *host) {
+        ENetUring *uring = host->uring;
+        ENetUringQueue *queue = &uring->sendQueue;
+        size_t count = uring->sendCount, completed = 0;
+        int result;
+
+        if (count == 0) {
+            return 0;
+        }
+
+        uring->sendCount = 0;
+
+        do {
+            result = enet_uring_enter(queue->fd, (unsigned) count, (unsigned) count, IORING_ENTER_GETEVENTS);
+            host->totalSendCalls++;
+        } while (result < 0 && errno == EINTR);
+
+        if (result < 0) {
+            return -1;
+        }
+
+        /* As with enet_socket_send, individual failed sends just drop that datagram */
+        while (completed < count) {
+            unsigned head = *queue->cqHead;
+
+            if (head == __atomic_load_n(queue->cqTail, __ATOMIC_ACQUIRE)) {
+                do {
+                    result = enet_uring_enter(queue->fd, 0, 1, IORING_ENTER_GETEVENTS);
+                } while (result < 0 && errno == EINTR);
+
+                if (result < 0) {
+                    return -1;
+                }
+                continue;
+            }
+
+            __atomic_store_n(queue->cqHead, head + 1, __ATOMIC_RELEASE);
+            completed++;
+        }
+
+        return 0;
+    } /* enet_uring_flush */
+
+    static int enet_uring_send(ENetHost *host, const ENetAddress *address, const ENetBuffer *buffers, size_t bufferCount) {
+        ENetUring *uring = host->uring;
+        struct io_uring_sqe *sqe;
+        struct sockaddr_in6 *sin;
+        enet_uint8 *data;
+        size_t index, length = 0, i;
+
+        if (uring->sendCount >= ENET_URING_SEND_SLOTS && enet_uring_flush(host) < 0) {
+            return -1;
+        }
+
+        index = uring->sendCount;
+        data  = uring->sendData[index];
+
+        for (i = 0; i < bufferCount; ++i) {
+            if (length + buffers[i].dataLength > ENET_PROTOCOL_MAXIMUM_MTU) {
+                return -2;
+            }
+
+            memcpy(data + length, buffers[i].data, buffers[i].dataLength);
+            length += buffers[i].dataLength;
+        }
+
+        sin = &uring->sendAddresses[index];
+        memset(sin, 0, sizeof(struct sockaddr_in6));
+        sin->sin6_family   = AF_INET6;
+        sin->sin6_port     = ENET_HOST_TO_NET_16(address->port);
+        sin->sin6_addr     = address->host;
+        sin->sin6_scope_id = address->sin6_scope_id;
+
+        uring->sendVectors[index].iov_base = data;
+        uring->sendVectors[index].iov_len  = length;
+
+        memset(&uring->sendMessages[index], 0, sizeof(struct msghdr));
+        uring->sendMessages[index].msg_name    = sin;
+        uring->sendMessages[index].msg_namelen = sizeof(struct sockaddr_in6);
+        uring->sendMessages[index].msg_iov     = &uring->sendVectors[index];
+        uring->sendMessages[index].msg_iovlen  = 1;
+
+        sqe = enet_uring_get_sqe(&uring->sendQueue);
+        sqe->opcode    = IORING_OP_SENDMSG;
+        sqe->fd        = host->socket;
+        sqe->addr      = (unsigned long long) (uintptr_t) &uring->sendMessages[index];
+        sqe->len       = 1;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = index;
+        enet_uring_publish_sqe(&uring->sendQueue);
+
+        uring->sendCount++;
+        return (int) length;
+    } /* enet_uring_send */
+#endif /* ENET_USE_IO_URING */
+
+#ifdef ENET_USE_XDP
+    typedef struct _ENetXdpRing {
+        unsigned * producer;
+        unsigned * consumer;
+        unsigned * flags;
+        void *     descs;
+        unsigned   mask;
+        void *     map;
+        size_t     mapSize;
+    } ENetXdpRing;
+
+    /* Where to send a peer heard through AF_XDP: the addresses of the frame it arrived in, swapped */
+    typedef struct _ENetXdpRoute {
+        struct in6_addr host;
+        enet_uint16     port;
+        int             used;
+        enet_uint8      peerMac[6];
+        enet_uint8      localMac[6];
+        enet_uint32     localIp; /* network byte order */
+    } ENetXdpRoute;
+
+    typedef struct _ENetXdp {
+        int           fd;
+        int           mapFd;
+        int           programFd;
+        int           linkFd;
+        int           waitFd; /* epoll set of fd and the host socket, see enet_host_get_wait_socket */
+        enet_uint8 *  umem;
+        ENetXdpRing   fill;
+        ENetXdpRing   completion;
+        ENetXdpRing   receive;
+        ENetXdpRing   transmit;
+        enet_uint64   freeFrames[ENET_XDP_FRAME_COUNT / 2]; /* transmit frames not in flight */
+        size_t        freeFrameCount;
+        enet_uint64   heldFrame; /* receive frame the last returned datagram lives in */
+        int           holding;
+        unsigned      transmitPending; /* descriptors queued since the last kick */
+        ENetXdpRoute  routes[ENET_XDP_ROUTES];
+    } ENetXdp;
+
+    #define ENET_XDP_HEADERS_SIZE (14 + 20 + 8) /* Ethernet, IPv4 without options, UDP */
+
+    static int enet_xdp_bpf(int command, union bpf_attr *attr) {
+        return (int) syscall(__NR_bpf, command, attr, sizeof(union bpf_attr));
+    }
+
+    static struct bpf_insn enet_xdp_insn(enet_uint8 code, enet_uint8 dst, enet_uint8 src, int16_t off, int32_t imm) {
+        struct bpf_insn insn;
+
+        memset(&insn, 0, sizeof(struct bpf_insn));
+        insn.code    = code;
+        insn.dst_reg = dst;
+        insn.src_reg = src;
+        insn.off     = off;
+        insn.imm     = imm;
+        return insn;
+    }
+
+    /** Loads the XDP program: redirect IPv4/UDP datagrams for `port` whose first ENet command is
+     *  SEND_UNRELIABLE or SEND_UNSEQUENCED into the socket in the XSKMAP slot of the receive queue,
+     *  pass everything else (and anything on a queue without a socket) to the stack.
+     */
+    static int enet_xdp_load_program(int mapFd, enet_uint16 port) {
+        #define ENET_XDP_PASS_JUMP(at) ((int16_t) (31 - (at) - 1)) /* to the pass exit at instruction 31 */
+        struct bpf_insn program[33];
+        union bpf_attr attr;
+        int i = 0;
+
+        program[i++] = enet_xdp_insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0);
+        program[i++] = enet_xdp_insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_1, offsetof(struct xdp_md, data), 0);
+        program[i++] = enet_xdp_insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_3, BPF_REG_1, offsetof(struct xdp_md, data_end), 0);
+        /* Headers plus the ENet header (with sent time) and one command byte must be there */
+        program[i++] = enet_xdp_insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0);
+        program[i++] = enet_xdp_insn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, ENET_XDP_HEADERS_SIZE + 5);
+        program[i] = enet_xdp_insn(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, ENET_XDP_PASS_JUMP(i), 0); i++;
+        program[i++] = enet_xdp_insn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, 12, 0);
+        program[i] = enet_xdp_insn(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, ENET_XDP_PASS_JUMP(i), ENET_HOST_TO_NET_16(0x0800)); i++;
+        program[i++] = enet_xdp_insn(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2, 14, 0);
+        program[i] = enet_xdp_insn(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, ENET_XDP_PASS_JUMP(i), 0x45); i++;
+        program[i++] = enet_xdp_insn(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2, 23, 0);
+        program[i] = enet_xdp_insn(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, ENET_XDP_PASS_JUMP(i), IPPROTO_UDP); i++;
+        /* Fragments go to the stack for reassembly */
+        program[i++] = enet_xdp_insn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, 20, 0);
+        program[i++] = enet_xdp_insn(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_5, 0, 0, ENET_HOST_TO_NET_16(0x3FFF));
+        program[i] = enet_xdp_insn(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, ENET_XDP_PASS_JUMP(i), 0); i++;
+        program[i++] = enet_xdp_insn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, 36, 0);
+        program[i] = enet_xdp_insn(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, ENET_XDP_PASS_JUMP(i), ENET_HOST_TO_NET_16(port)); i++;
+        /* First command follows the 2 byte peer ID, and the 2 byte sent time when its flag is set */
+        program[i++] = enet_xdp_insn(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2, ENET_XDP_HEADERS_SIZE, 0);
+        program[i++] = enet_xdp_insn(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_4, BPF_REG_2, ENET_XDP_HEADERS_SIZE + 2, 0);
+        program[i++] = enet_xdp_insn(BPF_JMP | BPF_JSET | BPF_K, BPF_REG_5, 0, 1, ENET_PROTOCOL_HEADER_FLAG_SENT_TIME >> 8);
+        program[i++] = enet_xdp_insn(BPF_JMP | BPF_JA, 0, 0, 1, 0);
+        program[i++] = enet_xdp_insn(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_4, BPF_REG_2, ENET_XDP_HEADERS_SIZE + 4, 0);
+        program[i++] = enet_xdp_insn(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_4, 0, 0, ENET_PROTOCOL_COMMAND_MASK);
+        program[i++] = enet_xdp_insn(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_4, 0, 1, ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE);
+        program[i] = enet_xdp_insn(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_4, 0, ENET_XDP_PASS_JUMP(i), ENET_PROTOCOL_COMMAND_SEND_UNSEQUENCED); i++;
+        /* bpf_redirect_map(map, rx_queue_index, XDP_PASS): the flags are the action when the slot is empty */
+        program[i++] = enet_xdp_insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_6, offsetof(struct xdp_md, rx_queue_index), 0);
+        program[i++] = enet_xdp_insn(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, mapFd);
+        program[i++] = enet_xdp_insn(0, 0, 0, 0, 0);
+        program[i++] = enet_xdp_insn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS);
+        program[i++] = enet_xdp_insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map);
+        program[i++] = enet_xdp_insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+        /* 31: pass */
+        program[i++] = enet_xdp_insn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS);
+        program[i++] = enet_xdp_insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+        #undef ENET_XDP_PASS_JUMP
+
+        memset(&attr, 0, sizeof(union bpf_attr));
+        attr.prog_type = BPF_PROG_TYPE_XDP;
+        attr.insns     = (enet_uint64) (uintptr_t) program;
+        attr.insn_cnt  = i;
+        attr.license   = (enet_uint64) (uintptr_t) "GPL";
+        return enet_xdp_bpf(BPF_PROG_LOAD, &attr);
+    }
+
+    static int enet_xdp_map_ring(int fd, ENetXdpRing *ring, const struct xdp_ring_offset *offsets, unsigned size, size_t descSize, off_t pageOffset) {
+        ring->mapSize = offsets->desc + size * descSize;
+        ring->map     = mmap(NULL, ring->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, pageOffset);
+        if (ring->map == MAP_FAILED) {
+            ring->map = NULL;
+            return -1;
+        }
+
+        ring->producer = (unsigned *) ((char *) ring->map + offsets->producer);
+        ring->consumer = (unsigned *) ((char *) ring->map + offsets->consumer);
+        ring->flags    = (unsigned *) ((char *) ring->map + offsets->flags);
+        ring->descs    = (char *) ring->map + offsets->desc;
+        ring->mask     = size - 1;
+        return 0;
+    }
+
+    static void enet_xdp_destroy(ENetXdp *xdp) {
+        ENetXdpRing *rings[4];
+        int i;
+
+        rings[0] = &xdp->fill;
+        rings[1] = &xdp->completion;
+        rings[2] = &xdp->receive;
+        rings[3] = &xdp->transmit;
+
+        /* Closing the link detaches the program from the interface */
+        if (xdp->linkFd >= 0) close(xdp->linkFd);
+        if (xdp->programFd >= 0) close(xdp->programFd);
+        if (xdp->mapFd >= 0) close(xdp->mapFd);
+        if (xdp->waitFd >= 0) close(xdp->waitFd);
+        if (xdp->fd >= 0) close(xdp->fd);
+
+        for (i = 0; i < 4; ++i) {
+            if (rings[i]->map != NULL) {
+                munmap(rings[i]->map, rings[i]->mapSize);
+            }
+        }
+
+        if (xdp->umem != NULL) {
+            munmap(xdp->umem, (size_t) ENET_XDP_FRAME_COUNT * ENET_XDP_FRAME_SIZE);
+        }
+
+        enet_free(xdp);
+    }
+
+    static size_t enet_xdp_route_index(const struct in6_addr *host, enet_uint16 port) {
+        enet_uint32 hash;
+
+        memcpy(&hash, &host->s6_addr[12], sizeof(enet_uint32));
+        hash ^= port * 0x9E3779B1U;
+        hash ^= hash >> 16;
+        return hash % ENET_XDP_ROUTES;
+    }
+
+    static ENetXdpRoute * enet_xdp_find_route(ENetXdp *xdp, const ENetAddress *address) {
+        size_t index = enet_xdp_route_index(&address->host, address->port), probe;
+
+        for (probe = 0; probe < ENET_XDP_ROUTES; ++probe) {
+            ENetXdpRoute *route = &xdp->routes[(index + probe) % ENET_XDP_ROUTES];
+
+            if (!route->used) {
+                return NULL;
+            }
+
+            if (route->port == address->port && memcmp(&route->host, &address->host, sizeof(struct in6_addr)) == 0) {
+                return route;
+            }
+        }
+
+        return NULL;
+    }
+
+    /** Records (or refreshes) the way back to the sender of a received frame. A full table
+     *  overwrites the home slot; that peer's replies then take the socket until it is heard again.
+     */
+    static void enet_xdp_learn_route(ENetXdp *xdp, const ENetAddress *address, const enet_uint8 *frame) {
+        size_t index = enet_xdp_route_index(&address->host, address->port), probe;
+        ENetXdpRoute *route = &xdp->routes[index];
+
+        for (probe = 0; probe < ENET_XDP_ROUTES; ++probe) {
+            ENetXdpRoute *candidate = &xdp->routes[(index + probe) % ENET_XDP_ROUTES];
+
+            if (!candidate->used || (candidate->port == address->port && memcmp(&candidate->host, &address->host, sizeof(struct in6_addr)) == 0)) {
+                route = candidate;
+                break;
+            }
+        }
+
+        route->used = 1;
+        route->host = address->host;
+        route->port = address->port;
+        memcpy(route->peerMac, frame + 6, 6);
+        memcpy(route->localMac, frame, 6);
+        memcpy(&route->localIp, frame + 14 + 16, sizeof(enet_uint32));
+    }
+
+    static enet_uint32 enet_xdp_checksum_add(const enet_uint8 *data, size_t length, enet_uint32 sum) {
+        size_t i;
+
+        for (i = 0; i + 1 < length; i += 2) {
+            sum += ((enet_uint32) data[i] << 8) | data[i + 1];
+        }
+
+        if (length & 1) {
+            sum += (enet_uint32) data[length - 1] << 8;
+        }
+
+        return sum;
+    }
+
+    static enet_uint16 enet_xdp_checksum_fold(enet_uint32 sum) {
+        while (sum >> 16) {
+            sum = (sum & 0xFFFF) + (sum >> 16);
+        }
+
+        return (enet_uint16) ~sum;
+    }
+
+    static void enet_xdp_refill(ENetXdp *xdp, enet_uint64 frame) {
+        unsigned producer = *xdp->fill.producer;
+
+        ((enet_uint64 *) xdp->fill.descs)[producer & xdp->fill.mask] = frame;
+        __atomic_store_n(xdp->fill.producer, producer + 1, __ATOMIC_RELEASE);
+    }
+
+    /** Takes transmit frames the kernel is done with back onto the free list. */
+    static void enet_xdp_reap_completions(ENetXdp *xdp) {
+        unsigned consumer = *xdp->completion.consumer;
+        unsigned producer = __atomic_load_n(xdp->completion.producer, __ATOMIC_ACQUIRE);
+
+        while (consumer != producer) {
+            xdp->freeFrames[xdp->freeFrameCount++] = ((enet_uint64 *) xdp->completion.descs)[consumer & xdp->completion.mask];
+            ++consumer;
+        }
+
+        __atomic_store_n(xdp->completion.consumer, consumer, __ATOMIC_RELEASE);
+    }
+
+    static unsigned enet_xdp_pending_receives(ENetXdp *xdp) {
+        return __atomic_load_n(xdp->receive.producer, __ATOMIC_ACQUIRE) - *xdp->receive.consumer;
+    }
+
+    /** Returns the next datagram redirected to the socket, 0 if there is none.
+     *  Same return convention as enet_socket_receive; *data points into the UMEM on success.
+     */
+    static int enet_xdp_receive(ENetHost *host, ENetAddress *address, enet_uint8 **data) {
+        ENetXdp *xdp = host->xdp;
+
+        if (xdp->holding) {
+            xdp->holding = 0;
+            enet_xdp_refill(xdp, xdp->heldFrame);
+        }
+
+        for (;;) {
+            unsigned consumer = *xdp->receive.consumer;
+            struct xdp_desc desc;
+            enet_uint8 *frame;
+            size_t udpLength;
+
+            if (consumer == __atomic_load_n(xdp->receive.producer, __ATOMIC_ACQUIRE)) {
+                return 0;
+            }
+
+            desc = ((struct xdp_desc *) xdp->receive.descs)[consumer & xdp->receive.mask];
+            __atomic_store_n(xdp->receive.consumer, consumer + 1, __ATOMIC_RELEASE);
+
+            frame     = xdp->umem + desc.addr;
+            udpLength = desc.len >= ENET_XDP_HEADERS_SIZE ? ((size_t) frame[14 + 20 + 4] << 8 | frame[14 + 20 + 5]) : 0;
+
+            /* The program only lets well-formed IPv4/UDP through, but don't trust lengths */
+            if (udpLength < 8 || ENET_XDP_HEADERS_SIZE - 8 + udpLength > desc.len || udpLength - 8 > host->mtu) {
+                enet_xdp_refill(xdp, desc.addr & ~((enet_uint64) ENET_XDP_FRAME_SIZE - 1));
+                return -2;
+            }
+
+            memset(&address->host, 0, sizeof(struct in6_addr));
+            address->host.s6_addr[10] = 0xFF;
+            address->host.s6_addr[11] = 0xFF;
+            memcpy(&address->host.s6_addr[12], frame + 14 + 12, 4);
+            address->port          = (enet_uint16) (frame[14 + 20] << 8 | frame[14 + 20 + 1]);
+            address->sin6_scope_id = 0;
+
+            enet_xdp_learn_route(xdp, address, frame);
+
+            xdp->heldFrame = desc.addr & ~((enet_uint64) ENET_XDP_FRAME_SIZE - 1);
+            xdp->holding   = 1;
+            host->receivedTimestamp = 0;
+
+            *data = frame + ENET_XDP_HEADERS_SIZE;
+            return (int) (udpLength - 8);
+        }
+    } /* enet_xdp_receive */
+
+    /** Builds the Ethernet/IPv4/UDP frame for a datagram to a routed peer and queues it for
+     *  transmission; enet_xdp_flush kicks the kernel. Needs a free transmit frame.
+     */
+    static int enet_xdp_send(ENetHost *host, const ENetXdpRoute *route, const ENetBuffer *buffers, size_t bufferCount) {
+        ENetXdp *xdp = host->xdp;
+        enet_uint64 frameAddress = xdp->freeFrames[--xdp->freeFrameCount];
+        enet_uint8 *frame = xdp->umem + frameAddress, *ip = frame + 14, *udp = ip + 20;
+        enet_uint16 ipChecksum, udpChecksum;
+        enet_uint32 sum;
+        unsigned producer;
+        size_t length = 0, i;
+        struct xdp_desc *desc;
+
+        for (i = 0; i < bufferCount; ++i) {
+            if (ENET_XDP_HEADERS_SIZE + length + buffers[i].dataLength > ENET_XDP_FRAME_SIZE) {
+                xdp->freeFrameCount++;
+                return -2;
+            }
+
+            memcpy(udp + 8 + length, buffers[i].data, buffers[i].dataLength);
+            length += buffers[i].dataLength;
+        }
+
+        memcpy(frame, route->peerMac, 6);
+        memcpy(frame + 6, route->localMac, 6);
+        frame[12] = 0x08;
+        frame[13] = 0x00;
+
+        ip[0]  = 0x45;
+        ip[1]  = 0;
+        ip[2]  = (enet_uint8) ((20 + 8 + length) >> 8);
+        ip[3]  = (enet_uint8) (20 + 8 + length);
+        ip[4]  = ip[5] = 0;
+        ip[6]  = 0x40; /* don't fragment */
+        ip[7]  = 0;
+        ip[8]  = 64;
+        ip[9]  = IPPROTO_UDP;
+        ip[10] = ip[11] = 0;
+        memcpy(ip + 12, &route->localIp, 4);
+        memcpy(ip + 16, &route->host.s6_addr[12], 4);
+        ipChecksum = enet_xdp_checksum_fold(enet_xdp_checksum_add(ip, 20, 0));
+        ip[10] = (enet_uint8) (ipChecksum >> 8);
+        ip[11] = (enet_uint8) ipChecksum;
+
+        udp[0] = (enet_uint8) (host->address.port >> 8);
+        udp[1] = (enet_uint8) host->address.port;
+        udp[2] = (enet_uint8) (route->port >> 8);
+        udp[3] = (enet_uint8) route->port;
+        udp[4] = (enet_uint8) ((8 + length) >> 8);
+        udp[5] = (enet_uint8) (8 + length);
+        udp[6] = udp[7] = 0;
+        sum = enet_xdp_checksum_add(ip + 12, 8, IPPROTO_UDP + 8 + (enet_uint32) length);
+        udpChecksum = enet_xdp_checksum_fold(enet_xdp_checksum_add(udp, 8 + length, sum));
+        if (udpChecksum == 0) udpChecksum = 0xFFFF;
+        udp[6] = (enet_uint8) (udpChecksum >> 8);
+        udp[7] = (enet_uint8) udpChecksum;
+
+        producer = *xdp->transmit.producer;
+        desc = &((struct xdp_desc *) xdp->transmit.descs)[producer & xdp->transmit.mask];
+        desc->addr    = frameAddress;
+        desc->len     = (enet_uint32) (ENET_XDP_HEADERS_SIZE + length);
+        desc->options = 0;
+        __atomic_store_n(xdp->transmit.producer, producer + 1, __ATOMIC_RELEASE);
+        xdp->transmitPending++;
+
+        return (int) length;
+    } /* enet_xdp_send */
+
+    /** Kicks the kernel to transmit queued frames (copy mode transmits during the call). */
+    static void enet_xdp_flush(ENetHost *host) {
+        ENetXdp *xdp = host->xdp;
+
+        if (xdp->transmitPending > 0) {
+            xdp->transmitPending = 0;
+            sendto(xdp->fd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+            host->totalSendCalls++;
+        }
+
+        enet_xdp_reap_completions(xdp);
+    }
+#endif /* ENET_USE_XDP */
+
+    /** Reads the next datagram for the host through whichever socket I/O path it was built/configured with.
+     *  Same return convention as enet_socket_receive; *data is left pointing at the datagram.
+     */
+    static int enet_host_receive_datagram(ENetHost *host, ENetAddress *address, enet_uint8 **data) {
+        #ifdef ENET_USE_IO_URING
+        if (host->uring != NULL) {
+            return enet_uring_receive(host, address, data);
+        }
+        #endif
+
+        #ifdef ENET_USE_XDP
+        if (host->xdp != NULL) {
+            int result = enet_xdp_receive(host, address, data);
+
+            if (result != 0) {
+                return result;
+            }
+
+        }
+        #endif
+
+        #ifdef ENET_USE_MMSG
+        return enet_batch_receive(host, address, data);
+        #elif defined(ENET_USE_TIMESTAMPNS)
+        return enet_socket_receive_timestamped(host, address, *data);
+        #else
+        ENetBuffer buffer;
+
+        buffer.data       = *data;
+        // buffer.dataLength = sizeof (host->packetData[0]);
+        buffer.dataLength = host->mtu;
+
+        host->totalReceiveCalls++;
+        return enet_socket_receive(host->socket, address, &buffer, 1);
+        #endif
+    }
+
+    /** Sends (or stages, for batched I/O paths) one datagram; same return convention as enet_socket_send. */
+    static int enet_host_send_datagram(ENetHost *host, const ENetAddress *address, const ENetBuffer *buffers, size_t bufferCount) {
+        #ifdef ENET_USE_IO_URING
+        if (host->uring != NULL) {
+            return enet_uring_send(host, address, buffers, bufferCount);
+        }
+        #endif
+
+        #ifdef ENET_USE_XDP
+        if (host->xdp != NULL) {
+            const ENetXdpRoute *route = enet_xdp_find_route(host->xdp, address);
+
+            if (route != NULL && host->xdp->freeFrameCount == 0) {
+                enet_xdp_reap_completions(host->xdp);
+            }
+
+            if (route != NULL && host->xdp->freeFrameCount > 0) {
+                return enet_xdp_send(host, route, buffers, bufferCount);
+            }
+        }
+        #endif
+
+        #ifdef ENET_USE_MMSG
+        return enet_batch_send(host, address, buffers, bufferCount);
+        #else
+        host->totalSendCalls++;
+        return enet_socket_send(host->socket, address, buffers, bufferCount);
+        #endif
+    }
+
+    /** Sends any datagrams staged by enet_host_send_datagram. */
+    static int enet_host_flush_datagrams(ENetHost *host) {
+        #ifdef ENET_USE_IO_URING
+        if (host->uring != NULL) {
+            return enet_uring_flush(host);
+        }
+        #endif
+
+        #ifdef ENET_USE_XDP
+        if (host->xdp != NULL) {
+            enet_xdp_flush(host);
+        }
+        #endif
+
+        #ifdef ENET_USE_MMSG
+        return enet_batch_flush(host);
+        #else
+        ENET_UNUSED(host)
+        return 0;
+        #endif
+    }
+
+    static int enet_protocol_receive_incoming_commands(ENetHost *host, ENetEvent *event) {
+        int packets;
+
+        for (packets = 0; packets < 256; ++packets) {
+            int receivedLength;
+            enet_uint8 *receivedData = host->packetData[0];
+
+            receivedLength = enet_host_receive_datagram(host, &host->receivedAddress, &receivedData);
+
+            if (receivedLength == -2)
+                continue;
+
+            if (receivedLength < 0) {
+                return -1;
+            }
+
+            if (receivedLength == 0) {
+                return 0;
+            }
+
+            host->receivedData       = receivedData;
+            host->receivedDataLength = receivedLength;
+
+            host->totalReceivedData += receivedLength;
+            host->totalReceivedPackets++;
+
+            if (host->intercept != NULL) {
+                switch (host->intercept(host, (void *)event)) {
+                    case 1:
+                        if (event != NULL && event->type != ENET_EVENT_TYPE_NONE) {
+                            return 1;
+                        }
+
+                        continue;
+
+                    case -1:
+                        return -1;
+
+                    default:
+                        break;
+                }
+            }
+
+            switch (enet_protocol_handle_incoming_commands(host, event)) {
+                case 1:
+                    return 1;
+
+                case -1:
+                    return -1;
+
+                default:
+                    break;
+            }
+        }
+
+        return -1;
+    } /* enet_protocol_receive_incoming_commands */
+
+    static void enet_protocol_send_acknowledgements(ENetHost *host, ENetPeer *peer) {
+        ENetProtocol *command = &host->commands[host->commandCount];
+        ENetBuffer *buffer    = &host->buffers[host->bufferCount];
+        ENetAcknowledgement *acknowledgement;
+        ENetListIterator currentAcknowledgement;
+        enet_uint16 reliableSequenceNumber;
+
+        currentAcknowledgement = enet_list_begin(&peer->acknowledgements);
+
+        while (currentAcknowledgement != enet_list_end(&peer->acknowledgements)) {
+            if (command >= &host->commands[sizeof(host->commands) / sizeof(ENetProtocol)] ||
+                buffer >= &host->buffers[sizeof(host->buffers) / sizeof(ENetBuffer)] ||
+                peer->mtu - host->packetSize < sizeof(ENetProtocolAcknowledge)
+            ) {
+                peer->flags |= ENET_PEER_FLAG_CONTINUE_SENDING;
+                break;
+            }
+
+            acknowledgement = (ENetAcknowledgement *) currentAcknowledgement;
+            currentAcknowledgement = enet_list_next(currentAcknowledgement);
+
+            buffer->data       = command;
+            buffer->dataLength = sizeof(ENetProtocolAcknowledge);
+            host->packetSize += buffer->dataLength;
+
+            reliableSequenceNumber = ENET_HOST_TO_NET_16(acknowledgement->command.header.reliableSequenceNumber);
+
+            command->header.command   = ENET_PROTOCOL_COMMAND_ACKNOWLEDGE;
+            command->header.channelID = acknowledgement->command.header.channelID;
+            command->header.reliableSequenceNumber = reliableSequenceNumber;
+            command->acknowledge.receivedReliableSequenceNumber = reliableSequenceNumber;
+            command->acknowledge.receivedSentTime = ENET_HOST_TO_NET_16(acknowledgement->sentTime);
+
+            if ((acknowledgement->command.header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_DISCONNECT) {
+                enet_protocol_dispatch_state(host, peer, ENET_PEER_STATE_ZOMBIE);
+            }
+
+            enet_list_remove(&acknowledgement->acknowledgementList);
+            enet_free(acknowledgement);
+
+            ++command;
+            ++buffer;
+        }
+
+        host->commandCount = command - host->commands;
+        host->bufferCount  = buffer - host->buffers;
+    } /* enet_protocol_send_acknowledgements */
+
+    static int enet_protocol_check_timeouts(ENetHost *host, ENetPeer *peer, ENetEvent *event) {
+        ENetOutgoingCommand *outgoingCommand;
+        ENetListIterator currentCommand, insertPosition, insertSendReliablePosition;
+
+        currentCommand = enet_list_begin(&peer->sentReliableCommands);
+        insertPosition = enet_list_begin(&peer->outgoingCommands);
+        insertSendReliablePosition = enet_list_begin(&peer->outgoingSendReliableCommands);
+
+        while (currentCommand != enet_list_end(&peer->sentReliableCommands)) {
+            outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+
+            currentCommand = enet_list_next(currentCommand);
+
+            if (ENET_TIME_DIFFERENCE(host->serviceTime, outgoingCommand->sentTime) < outgoingCommand->roundTripTimeout) {
+                continue;
+            }
+
+            if (peer->earliestTimeout == 0 || ENET_TIME_LESS(outgoingCommand->sentTime, peer->earliestTimeout)) {
+                peer->earliestTimeout = outgoingCommand->sentTime;
+            }
+
+            if (peer->earliestTimeout != 0 &&
+                (ENET_TIME_DIFFERENCE(host->serviceTime, peer->earliestTimeout) >= peer->timeoutMaximum ||
+                ((1u << (outgoingCommand->sendAttempts - 1)) >= peer->timeoutLimit &&
+                ENET_TIME_DIFFERENCE(host->serviceTime, peer->earliestTimeout) >= peer->timeoutMinimum))
+            ) {
+                enet_protocol_notify_disconnect_timeout(host, peer, event);
+                return 1;
+            }
+
+            ++peer->packetsLost;
+            ++peer->totalPacketsLost;
+
+            /* Replaced exponential backoff time with something more linear */
+            /* Source: http://lists.cubik.org/pipermail/enet-discuss/2014-May/002308.html */
+            outgoingCommand->roundTripTimeout = peer->roundTripTime + 4 * peer->roundTripTimeVariance;
+
+            if (outgoingCommand->packet != NULL) {
+                peer->reliableDataInTransit -= outgoingCommand->fragmentLength;
+                enet_list_insert(insertSendReliablePosition, enet_list_remove (& outgoingCommand->outgoingCommandList));
+            } else {
+                enet_list_insert(insertPosition, enet_list_remove (& outgoingCommand->outgoingCommandList));
+            }
+
+            if (currentCommand == enet_list_begin(&peer->sentReliableCommands) && !enet_list_empty(&peer->sentReliableCommands)) {
+                outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+                peer->nextTimeout = outgoingCommand->sentTime + outgoingCommand->roundTripTimeout;
+            }
+        }
+
+        return 0;
+    } /* enet_protocol_check_timeouts */
+
+    static int enet_protocol_check_outgoing_commands(ENetHost *host, ENetPeer *peer, ENetList *sentUnreliableCommands) {
+        ENetProtocol *command = &host->commands[host->commandCount];
+        ENetBuffer *buffer    = &host->buffers[host->bufferCount];
+        ENetOutgoingCommand *outgoingCommand = NULL;
+        ENetListIterator currentCommand, currentSendReliableCommand;
+        ENetChannel *channel = NULL;
+        enet_uint16 reliableWindow = 0;
+        size_t commandSize=0;
+        int windowWrap = 0, canPing = 1;
+
+        currentCommand = enet_list_begin(&peer->outgoingCommands);
+        currentSendReliableCommand = enet_list_begin (&peer->outgoingSendReliableCommands);
+
+        for (;;) {
+            if (currentCommand != enet_list_end (& peer->outgoingCommands))
+            {
+                outgoingCommand = (ENetOutgoingCommand *) currentCommand;
+                if (currentSendReliableCommand != enet_list_end (& peer->outgoingSendReliableCommands) && ENET_TIME_LESS (((ENetOutgoingCommand *) currentSendReliableCommand)->queueTime, outgoingCommand->queueTime)) {
+                    goto useSendReliableCommand;
+                }
+                currentCommand = enet_list_next (currentCommand);
+            } else if (currentSendReliableCommand != enet_list_end (& peer->outgoingSendReliableCommands)) {
+                useSendReliableCommand:
+                outgoingCommand = (ENetOutgoingCommand *) currentSendReliableCommand;
+                currentSendReliableCommand = enet_list_next (currentSendReliableCommand);
+            } else {
+                break;
+            }
+
+
+            if (outgoingCommand->command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE) {
+                channel = outgoingCommand->command.header.channelID < peer->channelCount ? & peer->channels [outgoingCommand->command.header.channelID] : NULL;
+                reliableWindow = outgoingCommand->reliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
+                if (channel != NULL) {
+                    if (windowWrap) {
+                        continue;
+                    } else if (outgoingCommand->sendAttempts < 1 && 
+                            !(outgoingCommand->reliableSequenceNumber % ENET_PEER_RELIABLE_WINDOW_SIZE) &&
+                            (channel->reliableWindows [(reliableWindow + ENET_PEER_RELIABLE_WINDOWS - 1) % ENET_PEER_RELIABLE_WINDOWS] >= ENET_PEER_RELIABLE_WINDOW_SIZE ||
+                            channel->usedReliableWindows & ((((1u << (ENET_PEER_FREE_RELIABLE_WINDOWS + 2)) - 1) << reliableWindow) | 
+                            (((1u << (ENET_PEER_FREE_RELIABLE_WINDOWS + 2)) - 1) >> (ENET_PEER_RELIABLE_WINDOWS - reliableWindow))))) 
+                    {
+                        windowWrap = 1;
+                        currentSendReliableCommand = enet_list_end (& peer->outgoingSendReliableCommands);
+                        continue;
+                    }
+                }
+
+                if (outgoingCommand->packet != NULL) {
+                    enet_uint32 windowSize = (peer->packetThrottle * peer->windowSize) / ENET_PEER_PACKET_THROTTLE_SCALE;
+
+                    if (peer->reliableDataInTransit + outgoingCommand->fragmentLength > ENET_MAX (windowSize, peer->mtu))
+                    {
+                        currentSendReliableCommand = enet_list_end (& peer->outgoingSendReliableCommands);
+                        continue;
+                    }
                 }
 
                 canPing = 0;
@@ -3176,6 +4568,10 @@ extern "C" {
                     enet_protocol_check_timeouts(host, currentPeer, event) == 1
                 ) {
                     if (event != NULL && event->type != ENET_EVENT_TYPE_NONE) {
+                        if (enet_host_flush_datagrams(host) < 0) {
+                            return -1;
+                        }
+
                         return 1;
                     } else {
                         goto nextPeer;
@@ -3230,96 +4626,391 @@ extern "C" {
                     host->buffers[0].dataLength = sizeof(ENetProtocolHeaderMinimal);
                 }
 
-                shouldCompress = 0;
-                if (host->compressor.context != NULL && host->compressor.compress != NULL) {
-                    size_t originalSize = host->packetSize - sizeof(ENetProtocolHeader),
-                      compressedSize    = host->compressor.compress(host->compressor.context, &host->buffers[1], host->bufferCount - 1, originalSize, host->packetData[1], originalSize);
-                    if (compressedSize > 0 && compressedSize < originalSize) {
-                        host->headerFlags |= ENET_PROTOCOL_HEADER_FLAG_COMPRESSED;
-                        shouldCompress     = compressedSize;
-                        #ifdef ENET_DEBUG_COMPRESS
-                        printf("peer %u: compressed %u->%u (%u%%)\n", currentPeer->incomingPeerID, originalSize, compressedSize, (compressedSize * 100) / originalSize);
-                        #endif
-                    }
-                }
+                shouldCompress = 0;
+                if (host->compressor.context != NULL && host->compressor.compress != NULL) {
+                    size_t originalSize = host->packetSize - sizeof(ENetProtocolHeader),
+                      compressedSize    = host->compressor.compress(host->compressor.context, &host->buffers[1], host->bufferCount - 1, originalSize, host->packetData[1], originalSize);
+                    if (compressedSize > 0 && compressedSize < originalSize) {
+                        host->headerFlags |= ENET_PROTOCOL_HEADER_FLAG_COMPRESSED;
+                        shouldCompress     = compressedSize;
+                        #ifdef ENET_DEBUG_COMPRESS
+                        printf("peer %u: compressed %u->%u (%u%%)\n", currentPeer->incomingPeerID, originalSize, compressedSize, (compressedSize * 100) / originalSize);
+                        #endif
+                    }
+                }
+
+                if (currentPeer->outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID) {
+                    host->headerFlags |= currentPeer->outgoingSessionID << ENET_PROTOCOL_HEADER_SESSION_SHIFT;
+                }
+
+#ifdef ENET_USE_MORE_PEERS
+                {
+                    enet_uint16 basePeerID = (enet_uint16)(currentPeer->outgoingPeerID & 0x07FF);
+                    enet_uint16 flagsAndSession = (enet_uint16)(host->headerFlags & 0xF800); /* top bits only */
+
+                    if (currentPeer->outgoingPeerID > 0x07FF)
+                    {
+                        flagsAndSession |= ENET_PROTOCOL_HEADER_FLAG_PEER_EXTRA;
+                        header->peerID = ENET_HOST_TO_NET_16(basePeerID | flagsAndSession);
+                        {
+                            enet_uint8 overflowByte = (enet_uint8)((currentPeer->outgoingPeerID >> 11) & 0xFF);
+                            enet_uint8 *extraPeerIDByte   = &headerData[host->buffers[0].dataLength];
+                            *extraPeerIDByte             = overflowByte;
+                            host->buffers[0].dataLength += sizeof(enet_uint8);
+                        }
+                    }
+                    else
+                    {
+                        header->peerID = ENET_HOST_TO_NET_16(basePeerID | flagsAndSession);
+                    }
+                }
+#else
+                header->peerID = ENET_HOST_TO_NET_16(currentPeer->outgoingPeerID | host->headerFlags);
+#endif
+
+                if (host->checksum != NULL) {
+                    enet_uint32 *checksum = (enet_uint32 *) &headerData[host->buffers[0].dataLength];
+                    *checksum = currentPeer->outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID ? currentPeer->connectID : 0;
+                    host->buffers[0].dataLength += sizeof(enet_uint32);
+                    *checksum = host->checksum(host->buffers, host->bufferCount);
+                }
+
+                if (shouldCompress > 0) {
+                    host->buffers[1].data       = host->packetData[1];
+                    host->buffers[1].dataLength = shouldCompress;
+                    host->bufferCount = 2;
+                }
+
+                currentPeer->lastSendTime = host->serviceTime;
+                sentLength = enet_host_send_datagram(host, &currentPeer->address, host->buffers, host->bufferCount);
+                enet_protocol_remove_sent_unreliable_commands(currentPeer, &sentUnreliableCommands);
+
+                if (sentLength < 0) {
+                    // The local 'headerData' array (to which 'data' is assigned) goes out
+                    // of scope on return from this function, so ensure we no longer point to it.
+                    host->buffers[0].data = NULL;
+                    return -1;
+                }
+
+                host->totalSentData += sentLength;
+                currentPeer->totalDataSent += sentLength;
+                host->totalSentPackets++;
+            nextPeer:
+                if (currentPeer->flags & ENET_PEER_FLAG_CONTINUE_SENDING)
+                    continueSending = sendPass + 1;
+            }
+
+        // The local 'headerData' array (to which 'data' is assigned) goes out
+        // of scope on return from this function, so ensure we no longer point to it.
+        host->buffers[0].data = NULL;
+
+        if (enet_host_flush_datagrams(host) < 0) {
+            return -1;
+        }
+
+        return 0;
+    } /* enet_protocol_send_outgoing_commands */
+
+    /** Sends any queued packets on the host specified to its designated peers.
+     *
+     *  @param host   host to flush
+     *  @remarks this function need only be used in circumstances where one wishes to send queued packets earlier than in a call to enet_host_service().
+     *  @ingroup host
+     */
+    void enet_host_flush(ENetHost *host) {
+        host->serviceTime = enet_time_get();
+        enet_protocol_send_outgoing_commands(host, NULL, 0);
+    }
+
+    /** Returns the number of datagrams already read off the socket but not yet processed.
+     *
+     *  @param host host to check
+     *  @remarks Always 0 unless built with ENET_BATCH_IO. Callers waiting on the host socket
+     *  themselves must service the host instead of waiting while this is non-zero.
+     *  @ingroup host
+     */
+    size_t enet_host_pending_receives(ENetHost *host) {
+        #ifdef ENET_USE_IO_URING
+        if (host->uring != NULL) {
+            return __atomic_load_n(host->uring->receiveQueue.cqTail, __ATOMIC_ACQUIRE) - *host->uring->receiveQueue.cqHead;
+        }
+        #endif
+
+        #ifdef ENET_USE_XDP
+        if (host->xdp != NULL && enet_xdp_pending_receives(host->xdp) > 0) {
+            return enet_xdp_pending_receives(host->xdp);
+        }
+        #endif
+
+        #ifdef ENET_USE_MMSG
+        return host->batch->receiveCount - host->batch->receiveIndex;
+        #else
+        ENET_UNUSED(host)
+        return 0;
+        #endif
+    }
+
+    /** Switches the host's datagram I/O to io_uring: a multishot recvmsg into kernel-provided
+     *  buffers for receiving, and one io_uring_enter per flush for sending.
+     *
+     *  @param host host to switch
+     *  @retval 0 on success
+     *  @retval -1 if io_uring is not compiled in (see ENET_IO_URING) or not supported by the
+     *  running kernel; the host keeps using its regular socket path
+     *  @ingroup host
+     */
+    int enet_host_use_io_uring(ENetHost *host) {
+        #ifdef ENET_USE_IO_URING
+        ENetUring *uring;
+        struct io_uring_cqe *cqe;
+        unsigned head;
+
+        if (host->uring != NULL) {
+            return 0;
+        }
+
+        #ifdef ENET_USE_XDP
+        if (host->xdp != NULL) {
+            return -1;
+        }
+        #endif
+
+        uring = (ENetUring *) enet_malloc(sizeof(ENetUring));
+        if (uring == NULL) {
+            return -1;
+        }
+        memset(uring, 0, sizeof(ENetUring));
+        uring->receiveQueue.fd = -1;
+        uring->sendQueue.fd    = -1;
+        uring->heldBuffer      = -1;
+
+        if (enet_uring_queue_create(&uring->receiveQueue, ENET_URING_RECEIVE_ENTRIES) < 0 ||
+            enet_uring_queue_create(&uring->sendQueue, ENET_URING_SEND_SLOTS) < 0
+        ) {
+            enet_uring_destroy(uring);
+            return -1;
+        }
+
+        uring->receiveTemplate.msg_namelen = sizeof(struct sockaddr_in6);
+        #ifdef ENET_USE_TIMESTAMPNS
+        uring->receiveTemplate.msg_controllen = ENET_TIMESTAMP_CONTROL_SIZE;
+        #endif
+        uring->bufferSize = sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in6) + uring->receiveTemplate.msg_controllen + ENET_PROTOCOL_MAXIMUM_MTU;
+        uring->buffers    = (enet_uint8 *) enet_malloc(uring->bufferSize * ENET_URING_BUFFER_COUNT);
+        if (uring->buffers == NULL) {
+            enet_uring_destroy(uring);
+            return -1;
+        }
+
+        /* Hand every buffer over in one request; only a failure posts a completion */
+        enet_uring_provide_buffers(uring, 0, ENET_URING_BUFFER_COUNT);
+        uring->pendingProvides = 0;
+        if (enet_uring_enter(uring->receiveQueue.fd, 1, 0, 0) != 1 ||
+            *uring->receiveQueue.cqHead != __atomic_load_n(uring->receiveQueue.cqTail, __ATOMIC_ACQUIRE)
+        ) {
+            enet_uring_destroy(uring);
+            return -1;
+        }
+
+        host->uring = uring;
+        if (enet_uring_arm_receive(host) < 0) {
+            host->uring = NULL;
+            enet_uring_destroy(uring);
+            return -1;
+        }
+
+        /* Kernels without multishot recvmsg fail the request right away */
+        head = *uring->receiveQueue.cqHead;
+        if (head != __atomic_load_n(uring->receiveQueue.cqTail, __ATOMIC_ACQUIRE)) {
+            cqe = &uring->receiveQueue.cqes[head & *uring->receiveQueue.cqMask];
+            if (cqe->res < 0) {
+                host->uring = NULL;
+                enet_uring_destroy(uring);
+                return -1;
+            }
+        }
+
+        return 0;
+        #else
+        ENET_UNUSED(host)
+        return -1;
+        #endif
+    }
+
+    /** Attaches an AF_XDP fast path for the host on one interface receive queue: loads an XDP
+     *  program (generic/skb mode, so it also works on veth and loopback) that hands the host's
+     *  unreliable IPv4 traffic to an AF_XDP socket, and sends datagrams to peers heard that way
+     *  as raw frames. Reliable, control and IPv6 traffic keeps using the host socket.
+     *
+     *  @param host host to attach; must be bound and not using io_uring
+     *  @param interfaceName network interface the host's traffic arrives on
+     *  @param queue receive queue to attach to; traffic on other queues takes the socket
+     *  @retval 0 on success
+     *  @retval -1 if AF_XDP is not compiled in (see ENET_AF_XDP), the interface is unknown, or
+     *  the kernel refuses (needs CAP_NET_ADMIN and CAP_BPF); the host keeps using its socket
+     *  @ingroup host
+     */
+    int enet_host_use_xdp(ENetHost *host, const char *interfaceName, enet_uint32 queue) {
+        #ifdef ENET_USE_XDP
+        ENetXdp *xdp;
+        struct xdp_umem_reg umemRegistration;
+        struct xdp_mmap_offsets offsets;
+        struct sockaddr_xdp bindAddress;
+        struct epoll_event waitEvent;
+        union bpf_attr attr;
+        socklen_t offsetsLength = sizeof(offsets);
+        unsigned ringSize = ENET_XDP_FRAME_COUNT / 2, i;
+        unsigned ifindex = if_nametoindex(interfaceName);
+        int fd;
+
+        if (host->xdp != NULL) {
+            return 0;
+        }
+
+        #ifdef ENET_USE_IO_URING
+        if (host->uring != NULL) {
+            return -1;
+        }
+        #endif
+
+        if (ifindex == 0) {
+            return -1;
+        }
+
+        xdp = (ENetXdp *) enet_malloc(sizeof(ENetXdp));
+        if (xdp == NULL) {
+            return -1;
+        }
+        memset(xdp, 0, sizeof(ENetXdp));
+        xdp->mapFd = xdp->programFd = xdp->linkFd = xdp->waitFd = -1;
 
-                if (currentPeer->outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID) {
-                    host->headerFlags |= currentPeer->outgoingSessionID << ENET_PROTOCOL_HEADER_SESSION_SHIFT;
-                }
+        xdp->fd = fd = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            enet_xdp_destroy(xdp);
+            return -1;
+        }
 
-#ifdef ENET_USE_MORE_PEERS
-                {
-                    enet_uint16 basePeerID = (enet_uint16)(currentPeer->outgoingPeerID & 0x07FF);
-                    enet_uint16 flagsAndSession = (enet_uint16)(host->headerFlags & 0xF800); /* top bits only */
+        xdp->umem = (enet_uint8 *) mmap(NULL, (size_t) ENET_XDP_FRAME_COUNT * ENET_XDP_FRAME_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (xdp->umem == MAP_FAILED) {
+            xdp->umem = NULL;
+            enet_xdp_destroy(xdp);
+            return -1;
+        }
 
-                    if (currentPeer->outgoingPeerID > 0x07FF)
-                    {
-                        flagsAndSession |= ENET_PROTOCOL_HEADER_FLAG_PEER_EXTRA;
-                        header->peerID = ENET_HOST_TO_NET_16(basePeerID | flagsAndSession);
-                        {
-                            enet_uint8 overflowByte = (enet_uint8)((currentPeer->outgoingPeerID >> 11) & 0xFF);
-                            enet_uint8 *extraPeerIDByte   = &headerData[host->buffers[0].dataLength];
-                            *extraPeerIDByte             = overflowByte;
-                            host->buffers[0].dataLength += sizeof(enet_uint8);
-                        }
-                    }
-                    else
-                    {
-                        header->peerID = ENET_HOST_TO_NET_16(basePeerID | flagsAndSession);
-                    }
-                }
-#else
-                header->peerID = ENET_HOST_TO_NET_16(currentPeer->outgoingPeerID | host->headerFlags);
-#endif
+        memset(&umemRegistration, 0, sizeof(umemRegistration));
+        umemRegistration.addr       = (enet_uint64) (uintptr_t) xdp->umem;
+        umemRegistration.len        = (enet_uint64) ENET_XDP_FRAME_COUNT * ENET_XDP_FRAME_SIZE;
+        umemRegistration.chunk_size = ENET_XDP_FRAME_SIZE;
+
+        if (setsockopt(fd, SOL_XDP, XDP_UMEM_REG, &umemRegistration, sizeof(umemRegistration)) < 0 ||
+            setsockopt(fd, SOL_XDP, XDP_UMEM_FILL_RING, &ringSize, sizeof(ringSize)) < 0 ||
+            setsockopt(fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ringSize, sizeof(ringSize)) < 0 ||
+            setsockopt(fd, SOL_XDP, XDP_RX_RING, &ringSize, sizeof(ringSize)) < 0 ||
+            setsockopt(fd, SOL_XDP, XDP_TX_RING, &ringSize, sizeof(ringSize)) < 0 ||
+            getsockopt(fd, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &offsetsLength) < 0 ||
+            enet_xdp_map_ring(fd, &xdp->fill, &offsets.fr, ringSize, sizeof(enet_uint64), XDP_UMEM_PGOFF_FILL_RING) < 0 ||
+            enet_xdp_map_ring(fd, &xdp->completion, &offsets.cr, ringSize, sizeof(enet_uint64), XDP_UMEM_PGOFF_COMPLETION_RING) < 0 ||
+            enet_xdp_map_ring(fd, &xdp->receive, &offsets.rx, ringSize, sizeof(struct xdp_desc), XDP_PGOFF_RX_RING) < 0 ||
+            enet_xdp_map_ring(fd, &xdp->transmit, &offsets.tx, ringSize, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING) < 0
+        ) {
+            enet_xdp_destroy(xdp);
+            return -1;
+        }
 
-                if (host->checksum != NULL) {
-                    enet_uint32 *checksum = (enet_uint32 *) &headerData[host->buffers[0].dataLength];
-                    *checksum = currentPeer->outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID ? currentPeer->connectID : 0;
-                    host->buffers[0].dataLength += sizeof(enet_uint32);
-                    *checksum = host->checksum(host->buffers, host->bufferCount);
-                }
+        /* First half of the UMEM receives, second half transmits */
+        for (i = 0; i < ringSize; ++i) {
+            enet_xdp_refill(xdp, (enet_uint64) i * ENET_XDP_FRAME_SIZE);
+            xdp->freeFrames[xdp->freeFrameCount++] = (enet_uint64) (ringSize + i) * ENET_XDP_FRAME_SIZE;
+        }
 
-                if (shouldCompress > 0) {
-                    host->buffers[1].data       = host->packetData[1];
-                    host->buffers[1].dataLength = shouldCompress;
-                    host->bufferCount = 2;
-                }
+        /* Generic mode only supports copying */
+        memset(&bindAddress, 0, sizeof(bindAddress));
+        bindAddress.sxdp_family   = AF_XDP;
+        bindAddress.sxdp_ifindex  = ifindex;
+        bindAddress.sxdp_queue_id = queue;
+        bindAddress.sxdp_flags    = XDP_COPY | XDP_USE_NEED_WAKEUP;
+        if (bind(fd, (struct sockaddr *) &bindAddress, sizeof(bindAddress)) < 0) {
+            enet_xdp_destroy(xdp);
+            return -1;
+        }
 
-                currentPeer->lastSendTime = host->serviceTime;
-                sentLength = enet_socket_send(host->socket, &currentPeer->address, host->buffers, host->bufferCount);
-                enet_protocol_remove_sent_unreliable_commands(currentPeer, &sentUnreliableCommands);
+        memset(&attr, 0, sizeof(attr));
+        attr.map_type    = BPF_MAP_TYPE_XSKMAP;
+        attr.key_size    = sizeof(enet_uint32);
+        attr.value_size  = sizeof(int);
+        attr.max_entries = queue + 1;
+        xdp->mapFd = enet_xdp_bpf(BPF_MAP_CREATE, &attr);
+        if (xdp->mapFd < 0) {
+            enet_xdp_destroy(xdp);
+            return -1;
+        }
 
-                if (sentLength < 0) {
-                    // The local 'headerData' array (to which 'data' is assigned) goes out
-                    // of scope on return from this function, so ensure we no longer point to it.
-                    host->buffers[0].data = NULL;
-                    return -1;
-                }
+        memset(&attr, 0, sizeof(attr));
+        attr.map_fd = xdp->mapFd;
+        attr.key    = (enet_uint64) (uintptr_t) &queue;
+        attr.value  = (enet_uint64) (uintptr_t) &fd;
+        if (enet_xdp_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0) {
+            enet_xdp_destroy(xdp);
+            return -1;
+        }
 
-                host->totalSentData += sentLength;
-                currentPeer->totalDataSent += sentLength;
-                host->totalSentPackets++;
-            nextPeer:
-                if (currentPeer->flags & ENET_PEER_FLAG_CONTINUE_SENDING)
-                    continueSending = sendPass + 1;
-            }
+        xdp->programFd = enet_xdp_load_program(xdp->mapFd, host->address.port);
+        if (xdp->programFd < 0) {
+            enet_xdp_destroy(xdp);
+            return -1;
+        }
 
-        // The local 'headerData' array (to which 'data' is assigned) goes out
-        // of scope on return from this function, so ensure we no longer point to it.
-        host->buffers[0].data = NULL;
+        memset(&attr, 0, sizeof(attr));
+        attr.link_create.prog_fd        = xdp->programFd;
+        attr.link_create.target_ifindex = ifindex;
+        attr.link_create.attach_type    = BPF_XDP;
+        attr.link_create.flags          = XDP_FLAGS_SKB_MODE;
+        xdp->linkFd = enet_xdp_bpf(BPF_LINK_CREATE, &attr);
+        if (xdp->linkFd < 0) {
+            enet_xdp_destroy(xdp);
+            return -1;
+        }
+
+        xdp->waitFd = epoll_create1(EPOLL_CLOEXEC);
+        memset(&waitEvent, 0, sizeof(waitEvent));
+        waitEvent.events = EPOLLIN;
+        if (xdp->waitFd < 0 ||
+            epoll_ctl(xdp->waitFd, EPOLL_CTL_ADD, fd, &waitEvent) < 0 ||
+            epoll_ctl(xdp->waitFd, EPOLL_CTL_ADD, host->socket, &waitEvent) < 0
+        ) {
+            enet_xdp_destroy(xdp);
+            return -1;
+        }
 
+        host->xdp = xdp;
         return 0;
-    } /* enet_protocol_send_outgoing_commands */
+        #else
+        ENET_UNUSED(host)
+        ENET_UNUSED(interfaceName)
+        ENET_UNUSED(queue)
+        return -1;
+        #endif
+    }
 
-    /** Sends any queued packets on the host specified to its designated peers.
-     *
-     *  @param host   host to flush
-     *  @remarks this function need only be used in circumstances where one wishes to send queued packets earlier than in a call to enet_host_service().
+    /** Returns the descriptor that becomes readable when the host has datagrams to process:
+     *  the io_uring completion queue when the host uses io_uring, an epoll set of the AF_XDP
+     *  socket and the host socket when it uses AF_XDP, otherwise the host socket.
      *  @ingroup host
      */
-    void enet_host_flush(ENetHost *host) {
-        host->serviceTime = enet_time_get();
-        enet_protocol_send_outgoing_commands(host, NULL, 0);
+    ENetSocket enet_host_get_wait_socket(ENetHost *host) {
+        #ifdef ENET_USE_IO_URING
+        if (host->uring != NULL) {
+            return host->uring->receiveQueue.fd;
+        }
+        #endif
+
+        #ifdef ENET_USE_XDP
+        if (host->xdp != NULL) {
+            return host->xdp->waitFd;
+        }
+        #endif
+
+        return host->socket;
     }
 
     /** Checks for any queued events on the host and dispatches one if available.
@@ -3452,6 +5143,13 @@ extern "C" {
                 return 0;
             }
 
+            /* Datagrams already read off the socket won't wake the socket wait */
+            if (enet_host_pending_receives(host) > 0) {
+                host->serviceTime = enet_time_get();
+                waitCondition = ENET_SOCKET_WAIT_RECEIVE;
+                continue;
+            }
+
             do {
                 host->serviceTime = enet_time_get();
 
@@ -3460,7 +5158,7 @@ extern "C" {
                 }
 
                 waitCondition = ENET_SOCKET_WAIT_RECEIVE | ENET_SOCKET_WAIT_INTERRUPT;
-                if (enet_socket_wait(host->socket, &waitCondition, ENET_TIME_DIFFERENCE(timeout, host->serviceTime)) != 0) {
+                if (enet_socket_wait(enet_host_get_wait_socket(host), &waitCondition, ENET_TIME_DIFFERENCE(timeout, host->serviceTime)) != 0) {
                     return -1;
                 }
             } while (waitCondition & ENET_SOCKET_WAIT_INTERRUPT);
@@ -3687,7 +5385,7 @@ extern "C" {
                 commandNumber       = ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE_FRAGMENT;
                 startSequenceNumber = ENET_HOST_TO_NET_16(channel->outgoingUnreliableSequenceNumber + 1);
             } else {
-                commandNumber       = ENET_PROTOCOL_COMMAND_SEND_FRAGMENT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
+                commandNumber       = ENET_PROTOCOL_COMMAND_SEND_FRAGMENT | (int) ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
                 startSequenceNumber = ENET_HOST_TO_NET_16(channel->outgoingReliableSequenceNumber + 1);
             }
 
@@ -3958,6 +5656,78 @@ extern "C" {
         enet_peer_reset_queues(peer);
     }
 
+    /** Captures the protocol state of a peer so another host sharing this host's socket can take
+     *  the connection over with enet_host_restore_peer, without the foreign host noticing.
+     *  @param peer     peer to capture
+     *  @param snapshot where to store its state
+     *  @retval 0 on success
+     *  @retval < 0 if the peer isn't connected or still has reliable commands in flight, queued
+     *  outgoing commands, acknowledgements to send or received commands not yet dispatched;
+     *  keep servicing and flushing the host until it has none
+     *  @remarks Capture and hand over without servicing the host in between, or a command
+     *  may be received or sent that the snapshot doesn't account for.
+     */
+    int enet_peer_snapshot(ENetPeer *peer, ENetPeerSnapshot *snapshot) {
+        size_t i;
+
+        if (peer->state != ENET_PEER_STATE_CONNECTED ||
+            (peer->flags & ENET_PEER_FLAG_NEEDS_DISPATCH) ||
+            !enet_list_empty(&peer->acknowledgements) ||
+            !enet_list_empty(&peer->sentReliableCommands) ||
+            !enet_list_empty(&peer->outgoingCommands) ||
+            !enet_list_empty(&peer->outgoingSendReliableCommands) ||
+            !enet_list_empty(&peer->dispatchedCommands)
+        ) {
+            return -1;
+        }
+
+        for (i = 0; i < peer->channelCount; ++i) {
+            if (!enet_list_empty(&peer->channels[i].incomingReliableCommands) ||
+                !enet_list_empty(&peer->channels[i].incomingUnreliableCommands)
+            ) {
+                return -1;
+            }
+        }
+
+        memset(snapshot, 0, sizeof(ENetPeerSnapshot));
+        snapshot->incomingPeerID                 = peer->incomingPeerID;
+        snapshot->outgoingPeerID                 = peer->outgoingPeerID;
+        snapshot->connectID                      = peer->connectID;
+        snapshot->outgoingSessionID              = peer->outgoingSessionID;
+        snapshot->incomingSessionID              = peer->incomingSessionID;
+        snapshot->address                        = peer->address;
+        snapshot->incomingBandwidth              = peer->incomingBandwidth;
+        snapshot->outgoingBandwidth              = peer->outgoingBandwidth;
+        snapshot->packetThrottle                 = peer->packetThrottle;
+        snapshot->packetThrottleLimit            = peer->packetThrottleLimit;
+        snapshot->packetThrottleAcceleration     = peer->packetThrottleAcceleration;
+        snapshot->packetThrottleDeceleration     = peer->packetThrottleDeceleration;
+        snapshot->packetThrottleInterval         = peer->packetThrottleInterval;
+        snapshot->pingInterval                   = peer->pingInterval;
+        snapshot->timeoutLimit                   = peer->timeoutLimit;
+        snapshot->timeoutMinimum                 = peer->timeoutMinimum;
+        snapshot->timeoutMaximum                 = peer->timeoutMaximum;
+        snapshot->roundTripTime                  = peer->roundTripTime;
+        snapshot->roundTripTimeVariance          = peer->roundTripTimeVariance;
+        snapshot->mtu                            = peer->mtu;
+        snapshot->windowSize                     = peer->windowSize;
+        snapshot->outgoingReliableSequenceNumber = peer->outgoingReliableSequenceNumber;
+        snapshot->incomingUnsequencedGroup       = peer->incomingUnsequencedGroup;
+        snapshot->outgoingUnsequencedGroup       = peer->outgoingUnsequencedGroup;
+        snapshot->eventData                      = peer->eventData;
+        snapshot->channelCount                   = (enet_uint32) peer->channelCount;
+        memcpy(snapshot->unsequencedWindow, peer->unsequencedWindow, sizeof(peer->unsequencedWindow));
+
+        for (i = 0; i < peer->channelCount; ++i) {
+            snapshot->channels[i].outgoingReliableSequenceNumber   = peer->channels[i].outgoingReliableSequenceNumber;
+            snapshot->channels[i].outgoingUnreliableSequenceNumber = peer->channels[i].outgoingUnreliableSequenceNumber;
+            snapshot->channels[i].incomingReliableSequenceNumber   = peer->channels[i].incomingReliableSequenceNumber;
+            snapshot->channels[i].incomingUnreliableSequenceNumber = peer->channels[i].incomingUnreliableSequenceNumber;
+        }
+
+        return 0;
+    }
+
     /** Sends a ping request to a peer.
      *  @param peer destination for the ping request
      *  @remarks ping requests factor into the mean round trip time as designated by the
@@ -4452,6 +6222,7 @@ extern "C" {
         if (packet == NULL) {
             goto notifyError;
         }
+        packet->receivedTimestamp = peer->host->receivedTimestamp;
 
         incomingCommand = (ENetIncomingCommand *) enet_malloc(sizeof(ENetIncomingCommand));
         if (incomingCommand == NULL) {
@@ -4524,22 +6295,7 @@ extern "C" {
 // !
 // =======================================================================//
 
-    /** Creates a host for communicating to peers.
-     *
-     *  @param address   the address at which other peers may connect to this host.  If NULL, then no peers may connect to the host.
-     *  @param peerCount the maximum number of peers that should be allocated for the host.
-     *  @param channelLimit the maximum number of channels allowed; if 0, then this is equivalent to ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT
-     *  @param incomingBandwidth downstream bandwidth of the host in bytes/second; if 0, ENet will assume unlimited bandwidth.
-     *  @param outgoingBandwidth upstream bandwidth of the host in bytes/second; if 0, ENet will assume unlimited bandwidth.
-     *
-     *  @returns the host on success and NULL on failure
-     *
-     *  @remarks ENet will strategically drop packets on specific sides of a connection between hosts
-     *  to ensure the host's bandwidth is not overwhelmed.  The bandwidth parameters also determine
-     *  the window size of a connection which limits the amount of reliable packets that may be in transit
-     *  at any given time.
-     */
-    ENetHost * enet_host_create(const ENetAddress *address, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth) {
+    static ENetHost * enet_host_create_internal(const ENetAddress *address, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth, int reusePort) {
         ENetHost *host;
         ENetPeer *currentPeer;
 
@@ -4559,16 +6315,32 @@ extern "C" {
 
         memset(host->peers, 0, peerCount * sizeof(ENetPeer));
 
+        #ifdef ENET_USE_MMSG
+        host->batch = (ENetBatchIO *) enet_malloc(sizeof(ENetBatchIO));
+        if (host->batch == NULL) {
+            enet_free(host->peers);
+            enet_free(host);
+            return NULL;
+        }
+        memset(host->batch, 0, sizeof(ENetBatchIO));
+        #endif
+
         host->socket = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
         if (host->socket != ENET_SOCKET_NULL) {
             enet_socket_set_option (host->socket, ENET_SOCKOPT_IPV6_V6ONLY, 0);
         }
 
-        if (host->socket == ENET_SOCKET_NULL || (address != NULL && enet_socket_bind(host->socket, address) < 0)) {
+        if (host->socket == ENET_SOCKET_NULL ||
+            (reusePort && enet_socket_set_option(host->socket, ENET_SOCKOPT_REUSEPORT, 1) < 0) ||
+            (address != NULL && enet_socket_bind(host->socket, address) < 0)
+        ) {
             if (host->socket != ENET_SOCKET_NULL) {
                 enet_socket_destroy(host->socket);
             }
 
+            #ifdef ENET_USE_MMSG
+            enet_free(host->batch);
+            #endif
             enet_free(host->peers);
             enet_free(host);
 
@@ -4610,6 +6382,8 @@ extern "C" {
         host->totalSentPackets              = 0;
         host->totalReceivedData             = 0;
         host->totalReceivedPackets          = 0;
+        host->totalSendCalls                = 0;
+        host->totalReceiveCalls             = 0;
         host->totalQueued                   = 0;
         host->connectedPeers                = 0;
         host->bandwidthLimitedPeers         = 0;
@@ -4640,7 +6414,144 @@ extern "C" {
         }
 
         return host;
-    } /* enet_host_create */
+    } /* enet_host_create_internal */
+
+    /** Creates a host for communicating to peers.
+     *
+     *  @param address   the address at which other peers may connect to this host.  If NULL, then no peers may connect to the host.
+     *  @param peerCount the maximum number of peers that should be allocated for the host.
+     *  @param channelLimit the maximum number of channels allowed; if 0, then this is equivalent to ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT
+     *  @param incomingBandwidth downstream bandwidth of the host in bytes/second; if 0, ENet will assume unlimited bandwidth.
+     *  @param outgoingBandwidth upstream bandwidth of the host in bytes/second; if 0, ENet will assume unlimited bandwidth.
+     *
+     *  @returns the host on success and NULL on failure
+     *
+     *  @remarks ENet will strategically drop packets on specific sides of a connection between hosts
+     *  to ensure the host's bandwidth is not overwhelmed.  The bandwidth parameters also determine
+     *  the window size of a connection which limits the amount of reliable packets that may be in transit
+     *  at any given time.
+     */
+    ENetHost * enet_host_create(const ENetAddress *address, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth) {
+        return enet_host_create_internal(address, peerCount, channelLimit, incomingBandwidth, outgoingBandwidth, 0);
+    }
+
+    /** Creates a host like enet_host_create, with SO_REUSEPORT set on its socket before binding,
+     *  so several hosts (typically one per thread) can bind the same address. The kernel then
+     *  spreads incoming datagrams across them by source address, so each client sticks to one host.
+     *
+     *  @returns the host on success and NULL on failure, including when the platform has no SO_REUSEPORT
+     *  @ingroup host
+     */
+    ENetHost * enet_host_create_reuseport(const ENetAddress *address, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth) {
+        return enet_host_create_internal(address, peerCount, channelLimit, incomingBandwidth, outgoingBandwidth, 1);
+    }
+
+    /** Creates a host like enet_host_create around an already bound datagram socket, typically
+     *  one inherited from a host in another process whose peers are then restored with
+     *  enet_host_restore_peer. The host takes ownership of the socket.
+     *
+     *  @returns the host on success and NULL on failure, in which case the socket is left open
+     *  @ingroup host
+     */
+    ENetHost * enet_host_create_from_socket(ENetSocket socket, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth) {
+        ENetHost *host = enet_host_create_internal(NULL, peerCount, channelLimit, incomingBandwidth, outgoingBandwidth, 0);
+        if (host == NULL) {
+            return NULL;
+        }
+
+        enet_socket_destroy(host->socket);
+        host->socket = socket;
+        enet_socket_set_option(host->socket, ENET_SOCKOPT_NONBLOCK, 1);
+        enet_socket_get_address(host->socket, &host->address);
+        return host;
+    }
+
+    /** Brings back a connection captured by enet_peer_snapshot, in the same peer slot, as if it
+     *  had been connected to this host all along. No event is generated.
+     *
+     *  @returns the peer on success and NULL if its slot is out of range or in use, or the host
+     *  allows fewer channels than the connection uses
+     *  @ingroup host
+     */
+    ENetPeer * enet_host_restore_peer(ENetHost *host, const ENetPeerSnapshot *snapshot) {
+        ENetPeer *peer;
+        size_t i;
+
+        if (snapshot->incomingPeerID >= host->peerCount ||
+            snapshot->channelCount == 0 ||
+            snapshot->channelCount > host->channelLimit
+        ) {
+            return NULL;
+        }
+
+        peer = &host->peers[snapshot->incomingPeerID];
+        if (peer->state != ENET_PEER_STATE_DISCONNECTED) {
+            return NULL;
+        }
+
+        peer->channels = (ENetChannel *) enet_malloc(snapshot->channelCount * sizeof(ENetChannel));
+        if (peer->channels == NULL) {
+            return NULL;
+        }
+        peer->channelCount = snapshot->channelCount;
+
+        for (i = 0; i < peer->channelCount; ++i) {
+            ENetChannel *channel = &peer->channels[i];
+
+            channel->outgoingReliableSequenceNumber   = snapshot->channels[i].outgoingReliableSequenceNumber;
+            channel->outgoingUnreliableSequenceNumber = snapshot->channels[i].outgoingUnreliableSequenceNumber;
+            channel->incomingReliableSequenceNumber   = snapshot->channels[i].incomingReliableSequenceNumber;
+            channel->incomingUnreliableSequenceNumber = snapshot->channels[i].incomingUnreliableSequenceNumber;
+            channel->usedReliableWindows = 0;
+            memset(channel->reliableWindows, 0, sizeof(channel->reliableWindows));
+
+            enet_list_clear(&channel->incomingReliableCommands);
+            enet_list_clear(&channel->incomingUnreliableCommands);
+        }
+
+        host->serviceTime = enet_time_get();
+
+        peer->outgoingPeerID                 = snapshot->outgoingPeerID;
+        peer->connectID                      = snapshot->connectID;
+        peer->outgoingSessionID              = snapshot->outgoingSessionID;
+        peer->incomingSessionID              = snapshot->incomingSessionID;
+        peer->address                        = snapshot->address;
+        peer->incomingBandwidth              = snapshot->incomingBandwidth;
+        peer->outgoingBandwidth              = snapshot->outgoingBandwidth;
+        peer->packetThrottle                 = snapshot->packetThrottle;
+        peer->packetThrottleLimit            = snapshot->packetThrottleLimit;
+        peer->packetThrottleAcceleration     = snapshot->packetThrottleAcceleration;
+        peer->packetThrottleDeceleration     = snapshot->packetThrottleDeceleration;
+        peer->packetThrottleInterval         = snapshot->packetThrottleInterval;
+        peer->pingInterval                   = snapshot->pingInterval;
+        peer->timeoutLimit                   = snapshot->timeoutLimit;
+        peer->timeoutMinimum                 = snapshot->timeoutMinimum;
+        peer->timeoutMaximum                 = snapshot->timeoutMaximum;
+        peer->roundTripTime                  = snapshot->roundTripTime;
+        peer->lastRoundTripTime              = snapshot->roundTripTime;
+        peer->lowestRoundTripTime            = snapshot->roundTripTime;
+        peer->roundTripTimeVariance          = snapshot->roundTripTimeVariance;
+        peer->lastRoundTripTimeVariance      = snapshot->roundTripTimeVariance;
+        peer->highestRoundTripTimeVariance   = snapshot->roundTripTimeVariance;
+        peer->mtu                            = snapshot->mtu;
+        peer->windowSize                     = snapshot->windowSize;
+        peer->outgoingReliableSequenceNumber = snapshot->outgoingReliableSequenceNumber;
+        peer->incomingUnsequencedGroup       = snapshot->incomingUnsequencedGroup;
+        peer->outgoingUnsequencedGroup       = snapshot->outgoingUnsequencedGroup;
+        peer->eventData                      = snapshot->eventData;
+        memcpy(peer->unsequencedWindow, snapshot->unsequencedWindow, sizeof(peer->unsequencedWindow));
+
+        /* Timestamps of the capturing host mean nothing here; start the clocks afresh */
+        peer->lastSendTime                   = host->serviceTime;
+        peer->lastReceiveTime                = host->serviceTime;
+        peer->packetLossEpoch                = host->serviceTime;
+        peer->packetThrottleEpoch            = host->serviceTime;
+        peer->incomingBandwidthThrottleEpoch = host->serviceTime;
+        peer->outgoingBandwidthThrottleEpoch = host->serviceTime;
+
+        enet_protocol_change_state(host, peer, ENET_PEER_STATE_CONNECTED);
+        return peer;
+    }
 
     /** Destroys the host and all resources associated with it.
      *  @param host pointer to the host to destroy
@@ -4652,6 +6563,18 @@ extern "C" {
             return;
         }
 
+        #ifdef ENET_USE_IO_URING
+        if (host->uring != NULL) {
+            enet_uring_destroy(host->uring);
+        }
+        #endif
+
+        #ifdef ENET_USE_XDP
+        if (host->xdp != NULL) {
+            enet_xdp_destroy(host->xdp);
+        }
+        #endif
+
         enet_socket_destroy(host->socket);
 
         for (currentPeer = host->peers; currentPeer < &host->peers[host->peerCount]; ++currentPeer) {
@@ -4662,6 +6585,9 @@ extern "C" {
             (*host->compressor.destroy)(host->compressor.context);
         }
 
+        #ifdef ENET_USE_MMSG
+        enet_free(host->batch);
+        #endif
         enet_free(host->peers);
         enet_free(host);
     }
@@ -4782,6 +6708,36 @@ extern "C" {
         }
     }
 
+    /** Queues a packet to be sent to a set of peers associated with the host.
+     *  The packet is shared by all recipients, not copied; peers that are not
+     *  connected are skipped.
+     *  @param host host on which to broadcast the packet
+     *  @param channelID channel on which to broadcast
+     *  @param packet packet to broadcast
+     *  @param peers peers to send the packet to
+     *  @param length number of peers
+     */
+    void enet_host_broadcast_selective(ENetHost *host, enet_uint8 channelID, ENetPacket *packet, ENetPeer **peers, size_t length) {
+        ENetPeer *currentPeer;
+        size_t i;
+
+        ENET_UNUSED(host)
+
+        for (i = 0; i < length; ++i) {
+            currentPeer = peers[i];
+
+            if (currentPeer == NULL || currentPeer->state != ENET_PEER_STATE_CONNECTED) {
+                continue;
+            }
+
+            enet_peer_send(currentPeer, channelID, packet);
+        }
+
+        if (packet->referenceCount == 0) {
+            callbacks.packet_destroy(packet);
+        }
+    }
+
     /** Sends raw data to specified address. Useful when you want to send unconnected data using host's socket.
      *  @param host host sending data
      *  @param address destination address
@@ -5654,6 +7610,24 @@ extern "C" {
                 result = setsockopt(socket, IPPROTO_IP, IP_TTL, (char *)&value, sizeof(int));
                 break;
 
+            #ifdef SO_REUSEPORT
+            case ENET_SOCKOPT_REUSEPORT:
+                result = setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, (char *)&value, sizeof(int));
+                break;
+            #endif
+
+            #ifdef SO_BUSY_POLL
+            case ENET_SOCKOPT_BUSY_POLL:
+                result = setsockopt(socket, SOL_SOCKET, SO_BUSY_POLL, (char *)&value, sizeof(int));
+                break;
+            #endif
+
+            #ifdef ENET_USE_TIMESTAMPNS
+            case ENET_SOCKOPT_TIMESTAMPNS:
+                result = setsockopt(socket, SOL_SOCKET, SO_TIMESTAMPNS, (char *)&value, sizeof(int));
+                break;
+            #endif
+
             default:
                 break;
         }
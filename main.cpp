@@ -6,9 +6,28 @@
 #include <iostream>
 #include <thread>
 #include <array>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <sstream>
+#include <coroutine>
+#include <memory>
+#include <deque>
+#include <cmath>
+#include <numbers>
 
 #include "libs/json.hpp"
 #define ENET_IMPLEMENTATION
+// The io_uring transport and AF_XDP fast path are compiled in where supported
+// and only used when selected at startup; -D_HNS_NO_IO_URING / -D_HNS_NO_AF_XDP
+// leave them (and their headers) out
+#if !defined(ENET_IO_URING) && !defined(_HNS_NO_IO_URING)
+#define ENET_IO_URING
+#endif
+#if !defined(ENET_AF_XDP) && !defined(_HNS_NO_AF_XDP)
+#define ENET_AF_XDP
+#endif
 #include "libs/enet.h"
 
 #ifdef _WIN32
@@ -16,6 +35,19 @@
 #undef max
 #endif
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 
 #define DEFAULT_PORT 55555
 #define MAX_PLAYERS 8
@@ -24,10 +56,95 @@
 
 #define ROUND_TRANSITION_COOLDOWN 2.0
 
+// Delta snapshots: how many past snapshots each shard keeps for deltas to be
+// encoded against (how far a client's acknowledgement may lag before it gets
+// full states again), and how often the latest one is resent to a client that
+// hasn't acknowledged it while nothing newer comes along
+#define SNAPSHOT_HISTORY 32
+#define SNAPSHOT_RESEND_INTERVAL_MS 100
+
+// Quantized snapshots: positions are sent as fixed point across the map's
+// bounds, which are its objects' extent plus this margin all around
+#define QUANTIZED_BOUNDS_MARGIN 64.0f
+
+// How long a finished game waits for its final reliable packets to be
+// acknowledged before the match ends anyway
+#define GAME_END_DELIVERY_TIMEOUT_MS 1000
+
+#define DEFAULT_TICK_RATE 60
+
+// Upper bound on how long the main loop blocks in the socket wait when nothing
+// is scheduled sooner; keeps ENet's own resend/ping timers serviced
+#define MAX_SERVICE_TIMEOUT_MS 100
+
+// Net thread mode (--net-thread): capacity of each ring between the net and
+// game threads, and how long the net thread may block between ENet services
+#define NET_RING_SIZE 4096
+#define NET_THREAD_SERVICE_TIMEOUT_MS 10
+
+// Busy-poll mode (--busy-poll): SO_BUSY_POLL budget for the host sockets, and
+// the priority requested by --sched-fifo
+#define BUSY_POLL_USEC 50
+#define SCHED_FIFO_PRIORITY 50
+
+// Most ready descriptors taken from the game thread's epoll set per wait
+#define EVENT_LOOP_MAX_EVENTS 64
+
+// Latency stats (--latency-stats): log2 microsecond buckets per histogram, and
+// how often each shard prints and resets them
+#define LATENCY_HISTOGRAM_BUCKETS 24
+#define LATENCY_REPORT_INTERVAL_MS 10000
+
+// Adaptive tick rate (--tick-tiers): how long each load measurement window
+// is, the load (fraction of the window the loop spent working) above which a
+// shard steps down a tier, and the projected load at the next faster tier
+// below which it steps back up
+#define TICK_TIER_WINDOW_MS 1000
+#define TICK_TIER_STEP_DOWN_LOAD 0.75
+#define TICK_TIER_STEP_UP_LOAD 0.5
+#define TICK_TIER_STEP_UP_WINDOWS 5 // Consecutive calm windows before stepping up
+
+// Tick budget watchdog (--tick-budget): iterations over this many budgets
+// print a trace (at most once per TICK_TRACE_INTERVAL_MS), and how often each
+// shard prints and resets its counters
+#define TICK_TRACE_FACTOR 2
+#define TICK_TRACE_INTERVAL_MS 1000
+#define TICK_BUDGET_REPORT_INTERVAL_MS 10000
+
+// Send stats (--flush-stats): how often each shard prints them (benchmarks
+// build with a shorter -D_HNS_FLUSH_STATS_INTERVAL_MS), and the per-datagram
+// header cost (IPv4 + UDP + ENet protocol header) every packet sharing a
+// datagram with another one saves
+#ifdef _HNS_FLUSH_STATS_INTERVAL_MS
+#define FLUSH_STATS_INTERVAL_MS _HNS_FLUSH_STATS_INTERVAL_MS
+#else
+#define FLUSH_STATS_INTERVAL_MS 10000
+#endif
+#define DATAGRAM_HEADER_BYTES 32
+
+// Capacity of each shard's admin command queue
+#define ADMIN_QUEUE_SIZE 64
+
+// Default for --peer-quota: packets handled per peer per loop iteration before
+// that peer's further PLAYER_SYNCs are coalesced (latest wins) and its other
+// packets deferred to the next iteration
+#define DEFAULT_PEER_EVENT_QUOTA 8
+
+// Hot upgrade (--upgrade-socket): how long a requested handover waits for every
+// connection to have nothing in flight before it's refused, and the version of
+// the state passed to the new process
+#define UPGRADE_SETTLE_TIMEOUT_MS 3000
+#define UPGRADE_STATE_VERSION 4
+
+// How often a draining shard reports on the game it is waiting for, and how
+// long shards wait for their last disconnects to go out once all have drained
+#define DRAIN_REPORT_INTERVAL_MS 10000
+#define DRAIN_SHUTDOWN_TIMEOUT_MS 1000
+
 
 typedef uint16_t PlayerID;
 
-PlayerID _player_GUID = 0;
+thread_local PlayerID _player_GUID = 0;
 static inline const PlayerID NewPlayerGUID() {
 	if (_player_GUID == std::numeric_limits<PlayerID>::max()) throw std::runtime_error(
 		"Player GUID counter overflow"
@@ -36,6 +153,9 @@ static inline const PlayerID NewPlayerGUID() {
 	return _player_GUID++;
 }
 
+// Never handed out by NewPlayerGUID
+#define NO_PLAYER_ID std::numeric_limits<PlayerID>::max()
+
 
 #pragma pack(1)
 typedef struct {
@@ -67,6 +187,17 @@ typedef struct {
 typedef struct {
 	bool ready = false;
         bool was_seeker = false;
+	bool state_dirty = false; // Received a PLAYER_SYNC changing the state, not yet relayed this tick
+	std::chrono::time_point<std::chrono::steady_clock> state_handled_time; // Latest changing PLAYER_SYNC; only kept with --latency-stats
+
+	// Delta snapshots (see SNAPSHOTS)
+	bool snapshot_acked = false;
+	uint16_t acked_snapshot_sequence = 0;
+	bool snapshot_sent = false;
+	uint16_t sent_snapshot_sequence = 0;
+	std::chrono::time_point<std::chrono::steady_clock> snapshot_sent_time;
+	uint8_t snapshot_encoding = 0; // SnapshotEncoding
+	bool snapshots = false; // Set an encoding; until then other players' PLAYER_SYNCs are relayed instead
 } ServerPlayerData;
 
 #pragma pack(1)
@@ -90,7 +221,13 @@ enum PacketType : char {
 	CONTROL_MAP_DATA,
 	CONTROL_GAME_START,
 	CONTROL_SET_PLAYER_STATE,
-	CONTROL_GAME_END
+	CONTROL_GAME_END,
+
+	PLAYER_SNAPSHOT, // Server -> Clients; other players' states, as a delta
+	PLAYER_SNAPSHOT_ACK, // Client -> Server
+	PLAYER_SET_SNAPSHOT_ENCODING, // Client -> Server
+	PLAYER_SNAPSHOT_QUANTIZED, // Server -> Clients; PLAYER_SNAPSHOT, with SNAPSHOT_ENCODING_QUANTIZED fields
+	CONTROL_SNAPSHOT_ENCODING // Server -> Client; confirms PLAYER_SET_SNAPSHOT_ENCODING
 };
 
 #pragma region PACKETS_DATA
@@ -102,6 +239,64 @@ typedef struct {
 	PlayerState player_state;
 } PlayerSyncPacketData;
 
+enum SnapshotFields : uint8_t {
+	SNAPSHOT_POSITION = 1 << 0,
+	SNAPSHOT_YAW = 1 << 1,
+	SNAPSHOT_PITCH = 1 << 2,
+	SNAPSHOT_FLAGS = 1 << 3,
+	SNAPSHOT_HOOK_POINT = 1 << 4,
+	SNAPSHOT_ALL_FIELDS = 0b11111
+};
+
+#pragma pack(1)
+typedef struct {
+	PlayerID player_id;
+	uint8_t fields; // SnapshotFields bitmask; those fields follow, in PlayerState order
+} PlayerSnapshotEntry;
+
+#pragma pack(1)
+typedef struct {
+	PacketType packet_type = PacketType::PLAYER_SNAPSHOT;
+	uint16_t sequence;
+	// How many snapshots before this one the snapshot it's a delta against
+	// is; 0 when against none, with every field of every other player
+	uint8_t baseline_age = 0;
+	uint8_t player_count = 0;
+	// Followed by player_count PlayerSnapshotEntry, each with its fields
+} PlayerSnapshotPacketData;
+
+#pragma pack(1)
+typedef struct {
+	PacketType packet_type = PacketType::PLAYER_SNAPSHOT_ACK;
+	uint16_t sequence; // Of the latest PLAYER_SNAPSHOT received
+} PlayerSnapshotAckPacketData;
+
+// How a connection's snapshot fields are sent. Quantized:
+// - position, hook_point: 3 uint16_t, fixed point from bounds_min (0) to
+//   bounds_max (65535) of CONTROL_SNAPSHOT_ENCODING, clamped to them
+// - yaw, pitch: uint16_t, radians as a fraction of a full turn, wrapped
+// - flags: unchanged
+enum SnapshotEncoding : uint8_t {
+	SNAPSHOT_ENCODING_FLOAT, // Fields as in PlayerState
+	SNAPSHOT_ENCODING_QUANTIZED,
+	SNAPSHOT_ENCODING_COUNT
+};
+
+#pragma pack(1)
+typedef struct {
+	PacketType packet_type = PacketType::PLAYER_SET_SNAPSHOT_ENCODING;
+	uint8_t encoding; // SnapshotEncoding
+} PlayerSetSnapshotEncodingPacketData;
+
+// Sent again with a new map's bounds; snapshots after it use them
+#pragma pack(1)
+typedef struct {
+	PacketType packet_type = PacketType::CONTROL_SNAPSHOT_ENCODING;
+	uint8_t encoding; // SnapshotEncoding
+	Vec3 bounds_min;
+	Vec3 bounds_max;
+} ControlSnapshotEncodingPacketData;
+
 #pragma pack(1)
 typedef struct {
 	PacketType packet_type = PacketType::PLAYER_SET_NAME;
@@ -139,299 +334,2067 @@ typedef struct {
 #pragma endregion PACKETS_DATA
 
 
-ENetHost* server;
+#pragma region TIMER_WHEEL
+
+// Hierarchical timer wheel with 1ms resolution: TIMER_WHEEL_LEVELS levels of
+// TIMER_WHEEL_SLOTS slots, each level-N slot spanning one full revolution of
+// level N-1. Scheduling and cancelling are O(1); a higher level slot is
+// cascaded down into the lower levels whenever the level below it wraps.
 
-std::unordered_map<ENetPeer*, PlayerID> peer_to_player_id(MAX_PLAYERS);
-std::unordered_map<PlayerID, ENetPeer*> player_id_to_peer(MAX_PLAYERS);
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_MAX_DELAY ((1ull << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1)
 
-std::unordered_map<PlayerID, PlayerState> player_states(MAX_PLAYERS);
-std::unordered_map<PlayerID, ServerPlayerData> serverside_player_data(MAX_PLAYERS);
-std::unordered_map<PlayerID, PlayerStats> players_stats(MAX_PLAYERS);
+#define TIMER_NIL std::numeric_limits<uint32_t>::max()
 
-std::string map_data;
-Vec3 hider_spawn = {};
-Vec3 seeker_spawn = {};
+// Timer node index in the low 32 bits, node generation in the high 32 bits;
+// 0 is never a valid ID, so it can be used as "no timer"
+typedef uint64_t TimerID;
 
-bool game_started = false;
+typedef struct {
+	std::function<void()> callback;
+	uint64_t expiry = 0; // Wheel time (ms)
+	uint32_t generation = 0;
+	uint32_t prev = TIMER_NIL;
+	uint32_t next = TIMER_NIL;
+	uint32_t bucket = 0; // level * TIMER_WHEEL_SLOTS + slot
+	bool pending = false;
+} TimerNode;
+
+// One wheel per shard thread
+thread_local std::vector<TimerNode> timer_nodes;
+thread_local std::vector<uint32_t> free_timer_nodes;
+thread_local std::array<uint32_t, TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS> timer_buckets;
+thread_local std::array<uint64_t, TIMER_WHEEL_LEVELS> timer_bucket_occupancy = {0};
+thread_local uint64_t timer_wheel_time = 0; // Last processed wheel time (ms)
+thread_local size_t pending_timers_count = 0;
+
+static inline void InitTimerWheel() {
+	timer_buckets.fill(TIMER_NIL);
+}
 
-PlayerID current_seeker_id;
-std::chrono::time_point<std::chrono::steady_clock> current_seeker_timer;
+static inline void LinkTimer(const uint32_t node_index) {
+	TimerNode& node = timer_nodes[node_index];
 
-std::chrono::time_point<std::chrono::steady_clock> round_transition_cooldown_timer;
+	uint64_t delay = node.expiry - timer_wheel_time;
+	if (delay > TIMER_WHEEL_MAX_DELAY) delay = TIMER_WHEEL_MAX_DELAY;
 
-#ifdef _HNS_DEBUG
-std::ofstream _DEBUG_LOG("HnSServer.log");
-#endif // _HNS_DEBUG
+	int level = 0;
+	while (delay >= (1ull << (TIMER_WHEEL_SLOT_BITS * (level + 1)))) level++;
 
+	// Timers beyond the wheel's range sit in the top level and get re-linked
+	// (with their real expiry) every time that slot is cascaded
+	const uint64_t slot_time = (node.expiry - timer_wheel_time > TIMER_WHEEL_MAX_DELAY)
+		? timer_wheel_time + TIMER_WHEEL_MAX_DELAY
+		: node.expiry;
+	const uint32_t slot = (slot_time >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK;
 
-static inline void HandleHiderCaughtPacket(
-	ENetPeer* peer,
-	ENetPacket* packet
+	node.bucket = level * TIMER_WHEEL_SLOTS + slot;
+	node.prev = TIMER_NIL;
+	node.next = timer_buckets[node.bucket];
+	if (node.next != TIMER_NIL) timer_nodes[node.next].prev = node_index;
+	timer_buckets[node.bucket] = node_index;
+	timer_bucket_occupancy[level] |= (1ull << slot);
+}
+
+static inline void UnlinkTimer(const uint32_t node_index) {
+	TimerNode& node = timer_nodes[node_index];
+
+	if (node.prev != TIMER_NIL) timer_nodes[node.prev].next = node.next;
+	else timer_buckets[node.bucket] = node.next;
+	if (node.next != TIMER_NIL) timer_nodes[node.next].prev = node.prev;
+
+	if (timer_buckets[node.bucket] == TIMER_NIL) {
+		timer_bucket_occupancy[node.bucket / TIMER_WHEEL_SLOTS] &= ~(
+			1ull << (node.bucket % TIMER_WHEEL_SLOTS)
+		);
+	}
+}
+
+static inline TimerID ScheduleTimer(
+	const uint64_t delay_ms,
+	std::function<void()> callback
 ) {
-	if (packet->dataLength < sizeof(PlayerHiderCaughtPacketData)) {
-		#ifdef _HNS_DEBUG
-			_DEBUG_LOG
-			<< "Received packet PLAYER_HIDER_CAUGHT size " << packet->dataLength
-			<< " is less than size of PlayerHiderCaughtPacketData " << sizeof(PlayerHiderCaughtPacketData)
-			<< std::endl;
-		#endif // _HNS_DEBUG
+	uint32_t node_index;
+	if (!free_timer_nodes.empty()) {
+		node_index = free_timer_nodes.back();
+		free_timer_nodes.pop_back();
+	} else {
+		node_index = timer_nodes.size();
+		timer_nodes.emplace_back();
+	}
+
+	TimerNode& node = timer_nodes[node_index];
+	node.callback = std::move(callback);
+	// Never expire in the slot currently being processed
+	node.expiry = timer_wheel_time + ((delay_ms == 0) ? 1 : delay_ms);
+	node.generation++;
+	node.pending = true;
+	LinkTimer(node_index);
+	pending_timers_count++;
+
+	return ((uint64_t)node.generation << 32) | node_index;
+}
+
+static inline bool IsTimerPending(const TimerID timer_id) {
+	const uint32_t node_index = timer_id & 0xFFFFFFFF;
+	if (node_index >= timer_nodes.size()) return false;
+
+	const TimerNode& node = timer_nodes[node_index];
+	return node.pending && node.generation == (timer_id >> 32);
+}
+
+static inline void CancelTimer(const TimerID timer_id) {
+	if (!IsTimerPending(timer_id)) return;
+
+	const uint32_t node_index = timer_id & 0xFFFFFFFF;
+	UnlinkTimer(node_index);
+	timer_nodes[node_index].pending = false;
+	timer_nodes[node_index].callback = nullptr;
+	free_timer_nodes.push_back(node_index);
+	pending_timers_count--;
+}
 
+// Fires every timer that expired up to now_ms (wheel time)
+static inline void AdvanceTimers(const uint64_t now_ms) {
+	if (pending_timers_count == 0) {
+		timer_wheel_time = now_ms;
 		return;
 	}
-	if (peer_to_player_id.find(peer) == peer_to_player_id.end()) return;
 
+	while (timer_wheel_time < now_ms) {
+		timer_wheel_time++;
+
+		// Cascade from the highest level that wrapped down
+		int wrapped_levels = 0;
+		while (
+			wrapped_levels < TIMER_WHEEL_LEVELS - 1 &&
+			((timer_wheel_time >> (TIMER_WHEEL_SLOT_BITS * (wrapped_levels + 1))) << (TIMER_WHEEL_SLOT_BITS * (wrapped_levels + 1)))
+				== timer_wheel_time
+		) wrapped_levels++;
+		for (int level = wrapped_levels; level >= 1; level--) {
+			const uint32_t bucket = level * TIMER_WHEEL_SLOTS + (
+				(timer_wheel_time >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK
+			);
+			uint32_t node_index = timer_buckets[bucket];
+			timer_buckets[bucket] = TIMER_NIL;
+			timer_bucket_occupancy[level] &= ~(1ull << (bucket % TIMER_WHEEL_SLOTS));
+			while (node_index != TIMER_NIL) {
+				const uint32_t next_node_index = timer_nodes[node_index].next;
+				LinkTimer(node_index);
+				node_index = next_node_index;
+			}
+		}
 
-	if (
-		(std::chrono::steady_clock::now() - round_transition_cooldown_timer).count()
-		< ROUND_TRANSITION_COOLDOWN
-	) return;
+		// Callbacks may schedule/cancel timers, so pop expired ones one by one
+		const uint32_t bucket = timer_wheel_time & TIMER_WHEEL_SLOT_MASK;
+		while (timer_buckets[bucket] != TIMER_NIL) {
+			const uint32_t node_index = timer_buckets[bucket];
+			UnlinkTimer(node_index);
 
+			std::function<void()> callback = std::move(timer_nodes[node_index].callback);
+			timer_nodes[node_index].callback = nullptr;
+			timer_nodes[node_index].pending = false;
+			free_timer_nodes.push_back(node_index);
+			pending_timers_count--;
 
-	const PlayerID player_id = peer_to_player_id[peer];
+			callback();
+		}
 
+		if (pending_timers_count == 0) {
+			timer_wheel_time = now_ms;
+			return;
+		}
+	}
+}
 
-	// If not sent by seeker: return
-	if (!(
-		player_states[player_id].player_state_flags
-		& PlayerStateFlags::IS_SEEKER
-	)) {
-		#ifdef _HNS_DEBUG
-			_DEBUG_LOG
-			<< "Received packet PLAYER_HIDER_CAUGHT sender "
-			<< player_id
-			<< " is found to not be a seeker; dropping"
-			<< std::endl;
-		#endif // _HNS_DEBUG
+// Upper bound on ms until the wheel next has work to do (fire or cascade)
+static inline uint64_t NextTimerDelay() {
+	if (pending_timers_count == 0) return TIMER_WHEEL_MAX_DELAY;
 
-		return;
+	// Every higher level cascades on a level 0 wrap, and what it brings down
+	// may be due right after it
+	const uint64_t until_cascade = TIMER_WHEEL_SLOTS - (timer_wheel_time & TIMER_WHEEL_SLOT_MASK);
+	bool higher_levels_occupied = false;
+	for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+		if (timer_bucket_occupancy[level] != 0) higher_levels_occupied = true;
 	}
 
+	const uint32_t next_slot = (timer_wheel_time + 1) & TIMER_WHEEL_SLOT_MASK;
+	const uint64_t level0_occupancy = timer_bucket_occupancy[0];
+	if (level0_occupancy != 0) {
+		// Rotate so bit 0 is the next slot to be processed
+		const uint64_t rotated = (next_slot == 0)
+			? level0_occupancy
+			: (level0_occupancy >> next_slot) | (level0_occupancy << (TIMER_WHEEL_SLOTS - next_slot));
+		const uint64_t until_level0 = __builtin_ctzll(rotated) + 1;
+		return higher_levels_occupied ? std::min(until_level0, until_cascade) : until_level0;
+	}
 
-	PlayerID caught_hider_id = *((PlayerID*)(
-		packet->data + offsetof(PlayerHiderCaughtPacketData, caught_hider_id)
-	));
+	// Nothing on level 0; wake at the next cascade
+	return until_cascade;
+}
 
+#pragma endregion TIMER_WHEEL
 
-	#ifdef _HNS_DEBUG
-		_DEBUG_LOG
-		<< "Received packet PLAYER_HIDER_CAUGHT from Player "
-		<< player_id
-		<< ", with caught hider ID "
-		<< caught_hider_id
-		<< std::endl;
-	#endif // _HNS_DEBUG
 
+#pragma region SPSC_RING
 
-	// Kill caught hider
-	player_states[caught_hider_id].player_state_flags &= ~PlayerStateFlags::ALIVE;
-	player_states[caught_hider_id].position = hider_spawn;
-	{
-	ControlSetPlayerStatePacketData cspsp_data{};
-	cspsp_data.state = player_states[caught_hider_id];
-	ENetPacket* set_state_packet = enet_packet_create(
-		&cspsp_data,
-		sizeof(ControlSetPlayerStatePacketData),
-		ENET_PACKET_FLAG_RELIABLE
-	);
-	enet_peer_send(player_id_to_peer[caught_hider_id], 0, set_state_packet);
+// The packet structs leave #pragma pack(1) in effect; atomics, mutexes and
+// condition variables need their natural alignment
+#pragma pack(push)
+#pragma pack()
 
-	#ifdef _HNS_DEBUG
-		_DEBUG_LOG
-		<< "Sending packet CONTROL_SET_PLAYER_STATE to "
-		<< caught_hider_id
-		<< " with data:"
-		<< "\n- packet type: " << std::to_string(cspsp_data.packet_type)
-		<< "\n- pos X (seeker spawn X): " << cspsp_data.state.position.x
-		<< "\n- pos Y (seeker spawn Y): " << cspsp_data.state.position.y
-		<< "\n- pos Z (seeker spawn Z): " << cspsp_data.state.position.z
-		<< "\n- yaw: " << cspsp_data.state.yaw
-		<< "\n- pitch: " << cspsp_data.state.pitch
-		<< "\n- flags:"
-		<< "\n^ - ALIVE: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::ALIVE) > 0)
-		<< "\n^ - IS_SEEKER: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::IS_SEEKER) > 0)
-		<< "\n^ - JUMPED: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-		<< "\n^ - WALLJUMP: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-		<< "\n^ - SLIDING: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-		<< "\n^ - FLASHLIGHT: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-		<< "\n- hook_point X: " << cspsp_data.state.hook_point.x
-		<< "\n- hook_point Y: " << cspsp_data.state.hook_point.y
-		<< "\n- hook_point Z: " << cspsp_data.state.hook_point.z
-		<< std::endl;
-	#endif // _HNS_DEBUG
+// Bounded lock-free single-producer/single-consumer ring; N must be a power
+// of 2. Each side owns one cache line (its index plus a cached copy of the
+// other side's) so the other side's line is only read when the cache says
+// the ring looks full/empty
+
+template <typename T, size_t N>
+struct SPSCRing {
+	static_assert((N & (N - 1)) == 0, "SPSCRing size must be a power of 2");
+
+	alignas(64) std::atomic<size_t> head{0}; // Consumer
+	size_t cached_tail = 0;
+	alignas(64) std::atomic<size_t> tail{0}; // Producer
+	size_t cached_head = 0;
+	alignas(64) std::array<T, N> items;
+};
+
+template <typename T, size_t N>
+static inline bool RingPush(SPSCRing<T, N>& ring, const T& item) {
+	const size_t tail = ring.tail.load(std::memory_order_relaxed);
+	if (tail - ring.cached_head == N) {
+		ring.cached_head = ring.head.load(std::memory_order_acquire);
+		if (tail - ring.cached_head == N) return false;
 	}
 
+	ring.items[tail & (N - 1)] = item;
+	ring.tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
 
-	// If alive hiders still left in round: return
-	int alive_hiders_left = 0;
-	for (auto const& [_, player_state] : player_states) {
-		if (player_state.player_state_flags & PlayerStateFlags::IS_SEEKER) continue;
-		if (player_state.player_state_flags & PlayerStateFlags::ALIVE) alive_hiders_left++;
+template <typename T, size_t N>
+static inline bool RingPop(SPSCRing<T, N>& ring, T& item) {
+	const size_t head = ring.head.load(std::memory_order_relaxed);
+	if (head == ring.cached_tail) {
+		ring.cached_tail = ring.tail.load(std::memory_order_acquire);
+		if (head == ring.cached_tail) return false;
 	}
-	#ifdef _HNS_DEBUG
-		_DEBUG_LOG << "alive_hiders_left == " << alive_hiders_left << std::endl;
-	#endif // _HNS_DEBUG
-	if (alive_hiders_left != 0) return;
 
+	item = ring.items[head & (N - 1)];
+	ring.head.store(head + 1, std::memory_order_release);
+	return true;
+}
 
-	round_transition_cooldown_timer = std::chrono::steady_clock::now();
+// Safe from either side
+template <typename T, size_t N>
+static inline bool RingEmpty(const SPSCRing<T, N>& ring) {
+	return ring.head.load(std::memory_order_acquire) == ring.tail.load(std::memory_order_acquire);
+}
 
+#pragma pack(pop)
 
-	// Set/calculate players stats
+#pragma endregion SPSC_RING
 
-	players_stats[player_id].seek_time = std::chrono::duration<float>(
-		std::chrono::steady_clock::now() - current_seeker_timer
-	).count();
+#pragma region MPSC_RING
 
-	current_seeker_timer = std::chrono::steady_clock::now();
+#pragma pack(push)
+#pragma pack()
 
-	serverside_player_data[player_id].was_seeker = true;
+// Bounded lock-free multi-producer/single-consumer ring; N must be a power of
+// 2. Producers claim a slot by advancing tail with a CAS; each cell's
+// sequence number says whether it is free for the producer at that position
+// (== position) or holds an item for the consumer (== position + 1), so a
+// producer that claimed a slot but hasn't written it yet only stalls the
+// consumer, never other producers
 
-	players_stats[caught_hider_id].last_alive_rounds++;
+template <typename T, size_t N>
+struct MPSCRing {
+	static_assert((N & (N - 1)) == 0, "MPSCRing size must be a power of 2");
 
-	#ifdef _HNS_DEBUG
-		_DEBUG_LOG
-		<< "Set/calculated post-round player stats:"
-		<< "\n- seeker " << player_id << " seek time: "
-			<<  players_stats[player_id].seek_time
-		<< "\n- hider " << caught_hider_id << " last alive rounds: "
-			<< std::to_string(players_stats[caught_hider_id].last_alive_rounds)
-		<< std::endl;
-	#endif // _HNS_DEBUG
+	typedef struct {
+		std::atomic<size_t> sequence;
+		T item;
+	} Cell;
 
+	alignas(64) std::atomic<size_t> tail{0}; // Producers
+	alignas(64) size_t head = 0; // Consumer
+	alignas(64) std::array<Cell, N> cells;
 
-	// End game if everyone has been a seeker
-	int done_seekers_count = 0;
-	for (auto const& [_, ss_player_data] : serverside_player_data) {
-		if (ss_player_data.was_seeker) done_seekers_count++;
+	MPSCRing() {
+		for (size_t i = 0; i < N; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
 	}
-	#ifdef _HNS_DEBUG
-		_DEBUG_LOG
-		<< "done_seekers_count == " << done_seekers_count
-		<< std::endl;
-	#endif // _HNS_DEBUG
-	if (done_seekers_count == peer_to_player_id.size()) {
-		#ifdef _HNS_DEBUG
-			_DEBUG_LOG
-			<< "Everyone was a seeker; ending game..."
-			<< std::endl;
-		#endif // _HNS_DEBUG
+};
 
-		std::vector<std::pair<PlayerID, float>> seek_times_sorted;
-		seek_times_sorted.reserve(players_stats.size());
-		for (auto const& [player_id, player_stats] : players_stats) {
-			seek_times_sorted.push_back({
-				player_id,
-				player_stats.seek_time
-			});
-		}
-		std::sort(
-			seek_times_sorted.begin(),
-			seek_times_sorted.end(),
-			[](
-				const std::pair<PlayerID, float>& st1,
-				const std::pair<PlayerID, float>& st2
-			){
-				return st1.second < st2.second;
+template <typename T, size_t N>
+static inline bool RingPush(MPSCRing<T, N>& ring, const T& item) {
+	size_t tail = ring.tail.load(std::memory_order_relaxed);
+	for (;;) {
+		auto& cell = ring.cells[tail & (N - 1)];
+		const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		if (sequence == tail) {
+			if (ring.tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+				cell.item = item;
+				cell.sequence.store(tail + 1, std::memory_order_release);
+				return true;
 			}
-		);
-		std::unordered_map<PlayerID, int> seek_time_placements;
-		seek_time_placements.reserve(players_stats.size());
-		for (int i = 0; i < players_stats.size(); i++) {
-			seek_time_placements[seek_times_sorted[i].first] = i;
 		}
-		for (auto& [player_id, player_stats] : players_stats) {
-			// points = (player_count - seek_placement - 1) + last_alive_rounds
-			player_stats.points = (
-				(players_stats.size() - seek_time_placements[player_id] - 1)
-				+ player_stats.last_alive_rounds
-			);
-
-			#ifdef _HNS_DEBUG
-				_DEBUG_LOG
-				<< "Final player " << player_id << " stats:"
-				<< "\n- name: " << player_stats.name
-				<< "\n- seek time: " << player_stats.seek_time
-				<< "\n- seek time placement: " << seek_time_placements[player_id]
-				<< "\n- last alive rounds: " << std::to_string(player_stats.last_alive_rounds)
-				<< "\n- points: " << std::to_string(player_stats.points)
-				<< std::endl;
-			#endif // _HNS_DEBUG
+		// Still holds the item from one lap ago
+		else if ((ptrdiff_t)(sequence - tail) < 0) return false;
+		else tail = ring.tail.load(std::memory_order_relaxed);
+	}
+}
 
-			PlayerStatsPacketData psp_data{};
-			psp_data.player_id = player_id;
-			psp_data.player_stats = player_stats;
-			ENetPacket* player_stats_packet = enet_packet_create(
-				&psp_data,
-				sizeof(PlayerStatsPacketData),
-				ENET_PACKET_FLAG_RELIABLE
-			);
-			enet_host_broadcast(server, 0, player_stats_packet);
+template <typename T, size_t N>
+static inline bool RingPop(MPSCRing<T, N>& ring, T& item) {
+	auto& cell = ring.cells[ring.head & (N - 1)];
+	if (cell.sequence.load(std::memory_order_acquire) != ring.head + 1) return false;
 
-			#ifdef _HNS_DEBUG
-				_DEBUG_LOG
-				<< "Broadcasting aforementioned stats"
-				<< " with packet PLAYER_STATS " << std::to_string(PacketType::PLAYER_STATS)
-				<< std::endl;
-			#endif // _HNS_DEBUG
-		}
+	item = std::move(cell.item);
+	cell.item = T{};
+	cell.sequence.store(ring.head + N, std::memory_order_release);
+	ring.head++;
+	return true;
+}
 
-		ENetPacket* control_game_end_packet = enet_packet_create(
-			std::array<char, 1>{PacketType::CONTROL_GAME_END}.data(),
-			sizeof(PacketType),
-			ENET_PACKET_FLAG_RELIABLE
-		);
-		enet_host_broadcast(server, 0, control_game_end_packet);
+#pragma pack(pop)
+
+#pragma endregion MPSC_RING
+
+
+// Each shard is a thread with its own ENetHost bound to the server port
+// (SO_REUSEPORT when there is more than one) and its own match; everything a
+// match touches is thread_local, everything below that isn't is read-only
+// once the shards are running
+size_t shard_count = 1;
+std::vector<ENetHost*> shard_hosts;
+thread_local size_t shard_index = 0;
+
+thread_local ENetHost* server;
+
+#pragma region THREAD_SCHEDULING
+
+// Busy-poll mode never blocks waiting for packets: the game loop and net
+// threads spin on their socket (or event ring), yielding between passes so
+// threads sharing a core, including SCHED_FIFO ones, still get to run
+bool busy_poll = false;
+std::vector<int> pinned_cpus; // Empty leaves thread placement to the OS
+bool use_sched_fifo = false;
+
+// Threads take CPUs from pinned_cpus by slot (wrapping around): shard N's
+// game thread is slot N, or 2N with its net thread at 2N+1 in net thread mode
+static inline void ConfigureThreadScheduling(const size_t slot, const std::string& thread_name) {
+#ifdef __linux__
+	if (!pinned_cpus.empty()) {
+		const int cpu = pinned_cpus[slot % pinned_cpus.size()];
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		CPU_SET(cpu, &cpu_set);
+		const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+		if (error != 0) std::cout
+			<< "WARNING: Failed to pin " << thread_name << " to CPU " << cpu << ": " << strerror(error)
+			<< std::endl;
+	}
 
-		#ifdef _HNS_DEBUG
-			_DEBUG_LOG
-			<< "Broadcasting packet CONTROL_GAME_END "
-			<< PacketType::CONTROL_GAME_END
+	if (use_sched_fifo) {
+		sched_param param = {};
+		param.sched_priority = SCHED_FIFO_PRIORITY;
+		const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (error != 0) std::cout
+			<< "WARNING: Failed to set SCHED_FIFO for " << thread_name << ": " << strerror(error)
 			<< std::endl;
-		#endif // _HNS_DEBUG
+	}
+#endif // __linux__
+}
 
-		enet_host_flush(server);
+#pragma endregion THREAD_SCHEDULING
 
-		std::cout << "Game ended, shutting down..." << std::endl;
+#pragma region EVENT_LOOP
 
-		exit(0);
+// On Linux each shard's game thread blocks in one epoll set holding ENet's
+// wait socket (or, in net thread mode, an eventfd the net thread signals) and
+// whatever descriptors are registered below, so extra sockets and timers are
+// served on the game thread between ticks instead of needing threads of their
+// own. Callbacks run once per loop iteration after the receive phase; a stale
+// readiness report can make them run with nothing to read, so registered
+// descriptors should be non-blocking
+
+#ifdef __linux__
+typedef std::function<void(const uint32_t events)> FdCallback; // Gets the ready EPOLL* events
+
+thread_local int loop_epoll_fd = -1;
+thread_local int loop_wait_fd = -1;
+thread_local std::unordered_map<int, FdCallback> fd_callbacks;
+thread_local std::array<epoll_event, EVENT_LOOP_MAX_EVENTS> ready_fds;
+thread_local int ready_fds_count = 0;
+
+static inline void InitEventLoop(const int wait_fd) {
+	loop_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (loop_epoll_fd < 0) throw std::runtime_error("Failed to create epoll set");
+
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.fd = wait_fd;
+	if (epoll_ctl(loop_epoll_fd, EPOLL_CTL_ADD, wait_fd, &event) < 0) throw std::runtime_error("Failed to add wait socket to epoll set");
+	loop_wait_fd = wait_fd;
+}
+
+// Fails (see errno) for descriptors epoll can't watch or that are already registered
+static inline bool RegisterFd(const int fd, const uint32_t events, FdCallback callback) {
+	epoll_event event = {};
+	event.events = events;
+	event.data.fd = fd;
+	if (epoll_ctl(loop_epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) return false;
+
+	fd_callbacks[fd] = std::move(callback);
+	return true;
+}
+
+// Closing fd is left to the caller
+static inline void UnregisterFd(const int fd) {
+	if (fd_callbacks.erase(fd) == 0) return;
+
+	epoll_ctl(loop_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+// Runs callback interval_ms (> 0) from now, then every interval_ms if repeat,
+// until UnregisterTimerFd; returns the timerfd, or -1 on failure
+static inline int RegisterTimerFd(
+	const uint64_t interval_ms,
+	const bool repeat,
+	std::function<void()> callback
+) {
+	const int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0) return -1;
+
+	itimerspec timer_spec = {};
+	timer_spec.it_value.tv_sec = interval_ms / 1000;
+	timer_spec.it_value.tv_nsec = (interval_ms % 1000) * 1000000;
+	if (repeat) timer_spec.it_interval = timer_spec.it_value;
+	if (
+		timerfd_settime(fd, 0, &timer_spec, nullptr) < 0 ||
+		!RegisterFd(fd, EPOLLIN, [fd, callback = std::move(callback)](const uint32_t) {
+			// Expirations missed while the loop was busy run the callback once
+			uint64_t expirations;
+			if (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations)) callback();
+		})
+	) {
+		close(fd);
+		return -1;
 	}
+	return fd;
+}
 
+static inline void UnregisterTimerFd(const int fd) {
+	UnregisterFd(fd);
+	close(fd);
+}
 
-	// Advance round (set players states -> respawn)
+// Returns whether the loop's wait socket or eventfd is ready
+static inline bool WaitForEvents(const enet_uint32 timeout_ms) {
+	ready_fds_count = epoll_wait(loop_epoll_fd, ready_fds.data(), ready_fds.size(), (int)timeout_ms);
+	if (ready_fds_count < 0) ready_fds_count = 0; // Interrupted
 
-	#ifdef _HNS_DEBUG
-		_DEBUG_LOG << "Advancing to next round..." << std::endl;
-	#endif // _HNS_DEBUG
+	for (int i = 0; i < ready_fds_count; i++) {
+		if (ready_fds[i].data.fd == loop_wait_fd) return true;
+	}
+	return false;
+}
 
-	serverside_player_data[player_id].was_seeker = true;
+// Checks registered descriptors without blocking, for loops that never wait
+static inline void PollFds() {
+	if (!fd_callbacks.empty()) WaitForEvents(0);
+}
 
-	PlayerID next_seeker_id = -1;
-	for (auto const& [player_id, ss_player_data] : serverside_player_data) {
-		if (ss_player_data.was_seeker == false) {
-			next_seeker_id = player_id;
-			break;
-		}
+static inline void RunFdCallbacks() {
+	for (int i = 0; i < ready_fds_count; i++) {
+		const auto entry = fd_callbacks.find(ready_fds[i].data.fd);
+		if (entry == fd_callbacks.end()) continue; // The wait socket, or unregistered since
+
+		// Copied as the callback may unregister its own descriptor
+		const FdCallback callback = entry->second;
+		callback(ready_fds[i].events);
 	}
-	#ifdef _HNS_DEBUG
-		_DEBUG_LOG << "Next seeker ID: " << next_seeker_id << std::endl;
-	#endif // _HNS_DEBUG
-	{
-	player_states[next_seeker_id].player_state_flags |= PlayerStateFlags::IS_SEEKER;
-	player_states[next_seeker_id].player_state_flags |= PlayerStateFlags::ALIVE;
-	player_states[next_seeker_id].position = seeker_spawn;
-	ControlSetPlayerStatePacketData cspsp_data{};
-	cspsp_data.state = player_states[next_seeker_id];
-	ENetPacket* set_state_packet = enet_packet_create(
-		&cspsp_data,
-		sizeof(ControlSetPlayerStatePacketData),
-		ENET_PACKET_FLAG_RELIABLE
-	);
-	enet_peer_send(player_id_to_peer[next_seeker_id], 0, set_state_packet);
+	ready_fds_count = 0;
+}
+#else
+static inline void PollFds() {}
+static inline void RunFdCallbacks() {}
+#endif // __linux__
 
-	#ifdef _HNS_DEBUG
+#pragma endregion EVENT_LOOP
+
+#pragma region NET_THREAD
+
+#pragma pack(push)
+#pragma pack()
+
+// In net thread mode each shard's ENetHost is serviced by a dedicated thread;
+// the game thread only sees decoded events and only issues commands, both
+// through SPSC rings, so slow game logic never delays ENet's ACKs and pings
+
+// The ENetPeer itself belongs to the net thread: the game thread only uses its
+// address as a key and never reads its fields, so whatever it needs from them
+// travels with the event
+typedef struct {
+	ENetEvent event;
+	enet_uint32 connect_id; // Of event.peer when the event was produced
+	ENetAddress address; // Same
+} NetEvent;
+
+enum NetCommandType : uint8_t {
+	NET_SEND,
+	NET_BROADCAST,
+	NET_DISCONNECT_LATER,
+	NET_REJECT, // Disconnect, flush & reset
+	NET_RELEASE_PACKET, // Drop the game thread's hold on a packet sent to several peers
+	NET_STOP // Run remaining commands, flush, then exit the net thread
+};
+
+typedef struct {
+	NetCommandType type;
+	ENetPeer* peer = nullptr;
+	// Peer slots get reused; commands for a connection that is gone by the
+	// time the net thread runs them are dropped
+	enet_uint32 connect_id = 0;
+	ENetPacket* packet = nullptr;
+} NetCommand;
+
+typedef struct {
+	ENetHost* host;
+	size_t shard;
+	std::thread thread;
+
+	SPSCRing<NetEvent, NET_RING_SIZE> events; // Net thread -> game thread
+	SPSCRing<NetCommand, NET_RING_SIZE> commands; // Game thread -> net thread
+
+	// Loopback socket the net thread waits on alongside the host socket; the
+	// game thread sends it a byte when it queues commands
+	ENetSocket wake_socket;
+	ENetAddress wake_address;
+	std::atomic<bool> wake_pending{false};
+
+	#ifdef __linux__
+	int game_wake_fd; // eventfd in the game thread's epoll set
+	#else
+	std::mutex game_wait_mutex;
+	std::condition_variable game_wait_cv;
+	#endif
+	std::atomic<bool> game_waiting{false};
+
+	std::atomic<enet_uint32> sent_datagrams{0}; // host->totalSentPackets, published by the net thread
+	std::atomic<enet_uint32> send_calls{0}; // host->totalSendCalls, same
+	std::atomic<enet_uint32> receive_calls{0}; // host->totalReceiveCalls, same
+	std::atomic<size_t> connected_peers{0}; // host->connectedPeers, same
+} NetChannel;
+
+bool use_net_thread = false;
+std::vector<NetChannel*> net_channels; // Per shard
+thread_local NetChannel* net_channel = nullptr; // Game thread side; nullptr when ENet runs on the game thread
+thread_local std::unordered_map<ENetPeer*, enet_uint32> peer_connect_ids(MAX_PLAYERS);
+thread_local bool net_commands_queued = false;
+thread_local uint64_t sent_game_packets = 0; // Per recipient
+
+static inline void WakeNetThread(NetChannel* channel) {
+	// A busy-polling net thread checks its command ring on every pass
+	if (busy_poll || channel->wake_pending.exchange(true)) return;
+
+	ENetBuffer buffer;
+	char byte = 0;
+	buffer.data = &byte;
+	buffer.dataLength = 1;
+	enet_socket_send(channel->wake_socket, &channel->wake_address, &buffer, 1);
+}
+
+static inline void WakeGameThread(NetChannel* channel) {
+	// Pairs with the fence in WaitForNetEvents so either we see the game
+	// thread waiting or it sees our events
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!channel->game_waiting.load()) return;
+
+	#ifdef __linux__
+	const uint64_t wake = 1;
+	if (write(channel->game_wake_fd, &wake, sizeof(wake)) < 0) return; // Already signalled
+	#else
+	std::lock_guard<std::mutex> lock(channel->game_wait_mutex);
+	channel->game_wait_cv.notify_one();
+	#endif
+}
+
+static inline void QueueNetCommand(const NetCommand& command) {
+	while (!RingPush(net_channel->commands, command)) {
+		WakeNetThread(net_channel);
+		std::this_thread::yield();
+	}
+	net_commands_queued = true;
+}
+
+// Hands queued commands to the net thread, which runs them all before its
+// next service, so they go out together
+static inline void FlushNetCommands() {
+	if (!net_commands_queued) return;
+	net_commands_queued = false;
+	WakeNetThread(net_channel);
+}
+
+static inline void WaitForNetEvents(const enet_uint32 timeout_ms) {
+	#ifdef __linux__
+	// Registered descriptors still get checked when events are already waiting
+	if (!RingEmpty(net_channel->events)) {
+		PollFds();
+		return;
+	}
+
+	net_channel->game_waiting.store(true);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (WaitForEvents(RingEmpty(net_channel->events) ? timeout_ms : 0)) {
+		uint64_t wakes;
+		if (read(net_channel->game_wake_fd, &wakes, sizeof(wakes)) < 0) wakes = 0;
+	}
+	net_channel->game_waiting.store(false);
+	#else
+	if (!RingEmpty(net_channel->events)) return;
+
+	std::unique_lock<std::mutex> lock(net_channel->game_wait_mutex);
+	net_channel->game_waiting.store(true);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	net_channel->game_wait_cv.wait_for(
+		lock,
+		std::chrono::milliseconds(timeout_ms),
+		[]{ return !RingEmpty(net_channel->events); }
+	);
+	net_channel->game_waiting.store(false);
+	#endif // __linux__
+}
+
+static inline enet_uint32 PeerConnectID(ENetPeer* peer) {
+	auto connect_id = peer_connect_ids.find(peer);
+	return (connect_id == peer_connect_ids.end()) ? 0 : connect_id->second;
+}
+
+// Outgoing traffic from game code goes through these so it works the same
+// with or without the net thread
+
+static inline void SendPacket(ENetPeer* peer, ENetPacket* packet) {
+	sent_game_packets++;
+	if (net_channel == nullptr) {
+		enet_peer_send(peer, 0, packet);
+		return;
+	}
+
+	QueueNetCommand(NetCommand{NET_SEND, peer, PeerConnectID(peer), packet});
+}
+
+static inline void BroadcastPacket(ENetPacket* packet) {
+	if (net_channel == nullptr) {
+		sent_game_packets += server->connectedPeers;
+		enet_host_broadcast(server, 0, packet);
+		return;
+	}
+
+	sent_game_packets += peer_connect_ids.size();
+
+	QueueNetCommand(NetCommand{NET_BROADCAST, nullptr, 0, packet});
+}
+
+// One packet, shared by every recipient instead of copied for each
+static inline void SendPacketToPeers(ENetPacket* packet, std::vector<ENetPeer*>& peers) {
+	sent_game_packets += peers.size();
+	if (net_channel == nullptr) {
+		enet_host_broadcast_selective(server, 0, packet, peers.data(), peers.size());
+		return;
+	}
+
+	// Held until the net thread has run every send, so a send to a connection
+	// that is gone by then doesn't free it under the others
+	packet->referenceCount++;
+	for (ENetPeer* peer : peers) {
+		QueueNetCommand(NetCommand{NET_SEND, peer, PeerConnectID(peer), packet});
+	}
+	QueueNetCommand(NetCommand{NET_RELEASE_PACKET, nullptr, 0, packet});
+}
+
+// Called once per loop iteration, by the flush phase only
+static inline void FlushPackets() {
+	if (net_channel == nullptr) {
+		enet_host_flush(server);
+		return;
+	}
+
+	FlushNetCommands();
+}
+
+static inline void DisconnectPeerLater(ENetPeer* peer) {
+	if (net_channel == nullptr) {
+		enet_peer_disconnect_later(peer, 0);
+		return;
+	}
+
+	QueueNetCommand(NetCommand{NET_DISCONNECT_LATER, peer, PeerConnectID(peer)});
+	// No longer connected as far as the game thread goes, as its state says
+	// without the net thread: its packets are dropped and sends to it fail
+	peer_connect_ids.erase(peer);
+}
+
+static inline void RejectPeer(ENetPeer* peer) {
+	if (net_channel == nullptr) {
+		enet_peer_disconnect(peer, 0);
+		enet_host_flush(server);
+		enet_peer_reset(peer);
+		return;
+	}
+
+	QueueNetCommand(NetCommand{NET_REJECT, peer, PeerConnectID(peer)});
+	// Packets it sent before the net thread gets to the reject are dropped
+	peer_connect_ids.erase(peer);
+}
+
+static inline void RunNetCommand(ENetHost* host, const NetCommand& command) {
+	if (command.peer != nullptr && (
+		command.peer->connectID != command.connect_id ||
+		command.peer->state == ENET_PEER_STATE_DISCONNECTED
+	)) {
+		if (command.packet != nullptr && command.packet->referenceCount == 0) enet_packet_destroy(command.packet);
+		return;
+	}
+
+	switch (command.type) {
+		default: break;
+
+		case NET_SEND:
+			if (enet_peer_send(command.peer, 0, command.packet) < 0 && command.packet->referenceCount == 0) {
+				enet_packet_destroy(command.packet);
+			}
+			break;
+
+		case NET_BROADCAST:
+			enet_host_broadcast(host, 0, command.packet);
+			break;
+
+		case NET_DISCONNECT_LATER:
+			enet_peer_disconnect_later(command.peer, 0);
+			break;
+
+		case NET_REJECT:
+			enet_peer_disconnect(command.peer, 0);
+			enet_host_flush(host);
+			enet_peer_reset(command.peer);
+			break;
+
+		case NET_RELEASE_PACKET:
+			if (--command.packet->referenceCount == 0) enet_packet_destroy(command.packet);
+			break;
+	}
+}
+
+static void NetThreadMain(NetChannel* channel) {
+try {
+	ENetHost* host = channel->host;
+	ENetEvent event;
+	ConfigureThreadScheduling(
+		channel->shard * 2 + 1,
+		"shard " + std::to_string(channel->shard) + " net thread"
+	);
+	char wake_data[64];
+	ENetBuffer wake_buffer;
+	wake_buffer.data = wake_data;
+	wake_buffer.dataLength = sizeof(wake_data);
+
+	for (;;) {
+		// Commands phase; clear the wake flag first so commands queued from
+		// here on wake us again
+		if (!busy_poll) {
+			channel->wake_pending.store(false);
+			while (enet_socket_receive(channel->wake_socket, nullptr, &wake_buffer, 1) > 0);
+		}
+
+		NetCommand command;
+		while (RingPop(channel->commands, command)) {
+			if (command.type == NET_STOP) {
+				enet_host_flush(host);
+				return;
+			}
+			RunNetCommand(host, command);
+		}
+
+		// Service phase
+		bool events_pushed = false;
+		for (
+			int service_result = enet_host_service(host, &event, 0);
+			service_result > 0;
+			service_result = enet_host_service(host, &event, 0)
+		) {
+			const NetEvent net_event{event, event.peer->connectID, event.peer->address};
+			while (!RingPush(channel->events, net_event)) {
+				WakeGameThread(channel);
+				std::this_thread::yield();
+			}
+			events_pushed = true;
+		}
+		if (events_pushed) WakeGameThread(channel);
+		channel->sent_datagrams.store(host->totalSentPackets, std::memory_order_relaxed);
+		channel->send_calls.store(host->totalSendCalls, std::memory_order_relaxed);
+		channel->receive_calls.store(host->totalReceiveCalls, std::memory_order_relaxed);
+		channel->connected_peers.store(host->connectedPeers, std::memory_order_relaxed);
+
+		// Wait phase
+		if (enet_host_pending_receives(host) > 0 || !RingEmpty(channel->commands)) continue;
+		if (busy_poll) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		const ENetSocket host_socket = enet_host_get_wait_socket(host);
+		ENetSocketSet read_set;
+		ENET_SOCKETSET_EMPTY(read_set);
+		ENET_SOCKETSET_ADD(read_set, host_socket);
+		ENET_SOCKETSET_ADD(read_set, channel->wake_socket);
+		enet_socketset_select(
+			std::max(host_socket, channel->wake_socket),
+			&read_set,
+			nullptr,
+			NET_THREAD_SERVICE_TIMEOUT_MS
+		);
+	}
+} catch (const std::exception& e) {
+	std::cout << "ERROR: " << e.what() << std::endl;
+	exit(1);
+}
+}
+
+static inline NetChannel* StartNetThread(const size_t shard) {
+	NetChannel* channel = new NetChannel();
+	channel->host = shard_hosts[shard];
+	channel->shard = shard;
+
+	channel->wake_socket = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
+	if (channel->wake_socket == ENET_SOCKET_NULL) throw std::runtime_error("Failed to create net thread wake socket");
+	enet_socket_set_option(channel->wake_socket, ENET_SOCKOPT_IPV6_V6ONLY, 0);
+	enet_socket_set_option(channel->wake_socket, ENET_SOCKOPT_NONBLOCK, 1);
+	ENetAddress bind_address = {0};
+	enet_address_set_host_ip(&bind_address, "127.0.0.1");
+	if (
+		enet_socket_bind(channel->wake_socket, &bind_address) < 0 ||
+		enet_socket_get_address(channel->wake_socket, &channel->wake_address) < 0
+	) throw std::runtime_error("Failed to bind net thread wake socket");
+
+	#ifdef __linux__
+	channel->game_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (channel->game_wake_fd < 0) throw std::runtime_error("Failed to create game thread wake eventfd");
+	#endif
+
+	channel->thread = std::thread(NetThreadMain, channel);
+	return channel;
+}
+
+// Lets the net thread send everything queued so far, then joins it
+static inline void StopNetThread(NetChannel* channel) {
+	if (!channel->thread.joinable() || channel->thread.get_id() == std::this_thread::get_id()) return;
+
+	while (!RingPush(channel->commands, NetCommand{NET_STOP})) std::this_thread::yield();
+	WakeNetThread(channel);
+	channel->thread.join();
+}
+
+#pragma pack(pop)
+
+#pragma endregion NET_THREAD
+
+thread_local std::unordered_map<ENetPeer*, PlayerID> peer_to_player_id(MAX_PLAYERS);
+thread_local std::unordered_map<PlayerID, ENetPeer*> player_id_to_peer(MAX_PLAYERS);
+
+thread_local std::unordered_map<PlayerID, PlayerState> player_states(MAX_PLAYERS);
+thread_local std::unordered_map<PlayerID, ServerPlayerData> serverside_player_data(MAX_PLAYERS);
+thread_local std::unordered_map<PlayerID, PlayerStats> players_stats(MAX_PLAYERS);
+
+#pragma pack(push)
+#pragma pack()
+
+typedef struct {
+	std::string data; // Compressed JSON, as sent in CONTROL_MAP_DATA
+	Vec3 hider_spawn;
+	Vec3 seeker_spawn;
+	// Quantized snapshot positions' range
+	Vec3 bounds_min;
+	Vec3 bounds_max;
+} MapInfo;
+
+#pragma pack(pop)
+
+std::shared_ptr<const MapInfo> startup_map;
+thread_local std::shared_ptr<const MapInfo> current_map;
+thread_local std::shared_ptr<const MapInfo> next_match_map; // Set by a map change during a started game
+
+thread_local bool game_started = false;
+
+// Set when the shard's match is over; the match is torn down at the end of the loop iteration
+thread_local bool match_over = false;
+
+thread_local PlayerID current_seeker_id;
+thread_local std::chrono::time_point<std::chrono::steady_clock> current_seeker_timer;
+
+// Set while a round transition cooldown is active
+thread_local bool round_transitioning = false;
+
+// Set once everyone was a seeker, while the final packets are being delivered
+thread_local bool game_ending = false;
+
+// Refusing new connections until the running game has ended (see DRAIN)
+thread_local bool draining = false;
+
+int tick_rate = DEFAULT_TICK_RATE;
+thread_local std::chrono::steady_clock::duration tick_interval; // Of the shard's current tick tier
+thread_local std::chrono::time_point<std::chrono::steady_clock> next_tick_time;
+// No players and no task awaiting NextTick as of the latest tick phase, so no
+// tick is due (see ServeShard)
+thread_local bool ticks_idle = false;
+
+// Sampled once per loop iteration; handlers use this instead of reading the clock
+std::chrono::time_point<std::chrono::steady_clock> server_start_time;
+thread_local std::chrono::time_point<std::chrono::steady_clock> loop_time;
+
+// Over-quota packets held for the next loop iteration (see FAIR_DRAIN)
+thread_local size_t deferred_receives_count = 0;
+
+#ifdef _HNS_DEBUG
+std::ofstream _DEBUG_LOG("HnSServer.log");
+#endif // _HNS_DEBUG
+
+
+static inline uint64_t LoopTimeMs() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		loop_time - server_start_time
+	).count();
+}
+
+// How long the main loop may block waiting for packets before the next tick
+// or timer is due
+static inline enet_uint32 NextServiceTimeout() {
+	if (deferred_receives_count > 0) return 0;
+	// Batched datagrams already read off the socket won't make it readable
+	if (net_channel == nullptr && enet_host_pending_receives(server) > 0) return 0;
+
+	uint64_t timeout_ms = NextTimerDelay();
+	if (!ticks_idle) {
+		const auto until_next_tick = next_tick_time - std::chrono::steady_clock::now();
+		if (until_next_tick <= std::chrono::steady_clock::duration::zero()) return 0;
+
+		// Round up so we don't spin on a sub-millisecond remainder
+		timeout_ms = std::min<uint64_t>(timeout_ms, std::chrono::ceil<std::chrono::milliseconds>(until_next_tick).count());
+	}
+	if (timeout_ms > MAX_SERVICE_TIMEOUT_MS) return MAX_SERVICE_TIMEOUT_MS;
+	return (enet_uint32)timeout_ms;
+}
+
+#pragma region TICK_TIERS
+
+// Each shard measures how much wall time its loop spends working (so time
+// lost to other threads on an oversubscribed box counts) and, rather than
+// stalling, steps its tick rate down a tier when the load gets too high or
+// ticks keep running late; it steps back up once the faster tier would fit
+// again. Every match keeps running, just with coarser updates.
+
+std::vector<int> tick_tiers; // Hz, fastest first; tick_tiers[0] is tick_rate
+thread_local size_t tick_tier = 0;
+thread_local std::chrono::steady_clock::duration tier_busy_time{};
+thread_local std::chrono::time_point<std::chrono::steady_clock> tier_window_start;
+thread_local uint32_t tier_ticks = 0;
+thread_local uint32_t tier_late_ticks = 0; // Ran more than a full interval late
+thread_local uint32_t tier_calm_windows = 0;
+
+static inline void SetTickTier(const size_t tier) {
+	tick_tier = tier;
+	tick_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(1.0 / tick_tiers[tier])
+	);
+}
+
+// Called at the end of every loop iteration, before blocking again
+static inline void UpdateTickTier() {
+	const auto now = std::chrono::steady_clock::now();
+	tier_busy_time += now - loop_time;
+
+	const auto window = now - tier_window_start;
+	if (window < std::chrono::milliseconds(TICK_TIER_WINDOW_MS)) return;
+
+	const double load = std::chrono::duration<double>(tier_busy_time) / window;
+	size_t tier = tick_tier;
+	const bool overloaded = load > TICK_TIER_STEP_DOWN_LOAD || tier_late_ticks * 10 > tier_ticks;
+	// Tick work scales with the rate; the rest of the load doesn't, so this
+	// overestimates and errs on the side of staying down
+	const bool calm = (
+		tier_late_ticks == 0 &&
+		tier > 0 &&
+		load * tick_tiers[tier - 1] / tick_tiers[tier] < TICK_TIER_STEP_UP_LOAD
+	);
+	tier_calm_windows = calm ? tier_calm_windows + 1 : 0;
+	if (overloaded && tier + 1 < tick_tiers.size()) tier++;
+	else if (calm && tier_calm_windows >= TICK_TIER_STEP_UP_WINDOWS) tier--;
+
+	if (tier != tick_tier) {
+		std::cout
+		<< "Shard " << shard_index
+		<< ": load " << (int)(load * 100) << "%, "
+		<< tier_late_ticks << "/" << tier_ticks << " ticks late; tick rate "
+		<< tick_tiers[tick_tier] << " -> " << tick_tiers[tier] << " Hz"
+		<< std::endl;
+		SetTickTier(tier);
+		tier_calm_windows = 0;
+	}
+
+	tier_busy_time = std::chrono::steady_clock::duration::zero();
+	tier_window_start = now;
+	tier_ticks = 0;
+	tier_late_ticks = 0;
+}
+
+#pragma endregion TICK_TIERS
+
+#pragma region TICK_WATCHDOG
+
+#pragma pack(push)
+#pragma pack()
+
+// With --tick-budget every loop iteration, from waking up to blocking again,
+// is timed against the budget; the time is split between the sections below
+// (exclusive of nested ones) so an overrun can be pinned on a handler
+
+enum TickSection : uint8_t {
+	SECTION_NETWORK, // ENet servicing or net thread events, and anything not below
+	SECTION_PLAYER_SYNC,
+	SECTION_HIDER_CAUGHT,
+	SECTION_PLAYER_READY, // Including starting the game
+	SECTION_OTHER_PACKETS,
+	SECTION_ADMIN,
+	SECTION_FD_CALLBACKS, // Registered descriptors and timerfds
+	SECTION_TIMERS,
+	SECTION_SIMULATE,
+	SECTION_RELAY, // Snapshots in BroadcastTick
+	TICK_SECTION_COUNT
+};
+
+const char* tick_section_names[TICK_SECTION_COUNT] = {
+	"network",
+	"PLAYER_SYNC",
+	"PLAYER_HIDER_CAUGHT",
+	"PLAYER_READY",
+	"other packets",
+	"admin",
+	"fd callbacks",
+	"timers",
+	"simulate",
+	"relay"
+};
+
+typedef struct {
+	std::array<std::chrono::steady_clock::duration, TICK_SECTION_COUNT> time{};
+	std::array<uint32_t, TICK_SECTION_COUNT> entries{};
+} IterationTrace;
+
+std::chrono::microseconds tick_budget{0}; // Zero when the watchdog is off
+thread_local bool iteration_watched = false;
+thread_local IterationTrace iteration_trace;
+thread_local TickSection current_section = SECTION_NETWORK;
+thread_local std::chrono::time_point<std::chrono::steady_clock> section_start;
+thread_local std::chrono::time_point<std::chrono::steady_clock> last_trace_time;
+
+// Since the last report
+thread_local uint64_t watched_iterations = 0;
+thread_local uint64_t overrun_iterations = 0;
+thread_local std::chrono::steady_clock::duration longest_iteration{};
+thread_local IterationTrace longest_iteration_trace;
+thread_local std::array<std::chrono::steady_clock::duration, TICK_SECTION_COUNT> section_totals{};
+
+static inline void SwitchTickSection(const TickSection section) {
+	const auto now = std::chrono::steady_clock::now();
+	iteration_trace.time[current_section] += now - section_start;
+	current_section = section;
+	section_start = now;
+}
+
+struct TickSectionScope {
+	TickSection previous;
+
+	explicit TickSectionScope(const TickSection section) : previous(current_section) {
+		if (!iteration_watched) return;
+		iteration_trace.entries[section]++;
+		SwitchTickSection(section);
+	}
+	~TickSectionScope() {
+		if (iteration_watched) SwitchTickSection(previous);
+	}
+};
+
+static inline int64_t DurationUs(const std::chrono::steady_clock::duration duration) {
+	return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+static inline void PrintIterationTrace(const IterationTrace& trace) {
+	for (size_t section = 0; section < TICK_SECTION_COUNT; section++) {
+		if (trace.entries[section] == 0 && trace.time[section] == std::chrono::steady_clock::duration::zero()) continue;
+		std::cout << " " << tick_section_names[section] << " " << DurationUs(trace.time[section]) << "us";
+		if (trace.entries[section] > 1) std::cout << " x" << trace.entries[section];
+	}
+}
+
+// Right after waking up
+static inline void StartIterationWatch() {
+	iteration_trace = IterationTrace{};
+	current_section = SECTION_NETWORK;
+	section_start = loop_time;
+	iteration_watched = true;
+}
+
+// Right before blocking again
+static inline void EndIterationWatch() {
+	if (!iteration_watched) return;
+	iteration_watched = false;
+
+	const auto now = std::chrono::steady_clock::now();
+	iteration_trace.time[current_section] += now - section_start;
+	const auto iteration = now - loop_time;
+
+	watched_iterations++;
+	for (size_t section = 0; section < TICK_SECTION_COUNT; section++) section_totals[section] += iteration_trace.time[section];
+	if (iteration > longest_iteration) {
+		longest_iteration = iteration;
+		longest_iteration_trace = iteration_trace;
+	}
+
+	if (iteration <= tick_budget) return;
+	overrun_iterations++;
+
+	if (
+		iteration > tick_budget * TICK_TRACE_FACTOR &&
+		now - last_trace_time >= std::chrono::milliseconds(TICK_TRACE_INTERVAL_MS)
+	) {
+		last_trace_time = now;
+		std::cout
+		<< "Shard " << shard_index << ": iteration took " << DurationUs(iteration)
+		<< "us (budget " << tick_budget.count() << "us):";
+		PrintIterationTrace(iteration_trace);
+		std::cout << std::endl;
+	}
+}
+
+static inline void ReportTickBudget() {
+	std::cout
+	<< "Shard " << shard_index << " tick budget over the last " << TICK_BUDGET_REPORT_INTERVAL_MS / 1000 << "s: "
+	<< overrun_iterations << "/" << watched_iterations << " iterations over " << tick_budget.count() << "us"
+	<< "\n  longest " << DurationUs(longest_iteration) << "us:";
+	PrintIterationTrace(longest_iteration_trace);
+	std::cout << "\n  total:";
+	for (size_t section = 0; section < TICK_SECTION_COUNT; section++) {
+		std::cout << " " << tick_section_names[section] << " " << DurationUs(section_totals[section]) << "us";
+	}
+	std::cout << std::endl;
+
+	watched_iterations = 0;
+	overrun_iterations = 0;
+	longest_iteration = std::chrono::steady_clock::duration::zero();
+	longest_iteration_trace = IterationTrace{};
+	section_totals = {};
+
+	ScheduleTimer(TICK_BUDGET_REPORT_INTERVAL_MS, ReportTickBudget);
+}
+
+#pragma pack(pop)
+
+#pragma endregion TICK_WATCHDOG
+
+#pragma region FLUSH_STATS
+
+bool flush_stats = false;
+thread_local uint64_t reported_game_packets = 0;
+thread_local enet_uint32 reported_datagrams = 0;
+thread_local enet_uint32 reported_send_calls = 0;
+thread_local enet_uint32 reported_receive_calls = 0;
+thread_local uint64_t ticks_count = 0;
+thread_local uint64_t reported_ticks_count = 0;
+thread_local uint64_t sent_snapshot_bytes = 0; // Per recipient
+thread_local uint64_t full_snapshot_bytes = 0; // What they would have been with every field of the same players
+thread_local uint64_t reported_snapshot_bytes = 0;
+thread_local uint64_t reported_full_snapshot_bytes = 0;
+thread_local uint64_t handled_player_syncs = 0;
+thread_local uint64_t unchanged_player_syncs = 0; // Same state as already held, so nothing to relay
+thread_local uint64_t reported_player_syncs = 0;
+thread_local uint64_t reported_unchanged_player_syncs = 0;
+
+// Datagrams include ENet's own (ACK-only, pings), so the packets per datagram
+// and bytes saved are lower bounds; syscalls are the host's socket calls over
+// the ticks run since the last report
+static inline void ReportFlushStats() {
+	const enet_uint32 total_datagrams = (net_channel == nullptr)
+		? server->totalSentPackets
+		: net_channel->sent_datagrams.load(std::memory_order_relaxed);
+	const enet_uint32 total_send_calls = (net_channel == nullptr)
+		? server->totalSendCalls
+		: net_channel->send_calls.load(std::memory_order_relaxed);
+	const enet_uint32 total_receive_calls = (net_channel == nullptr)
+		? server->totalReceiveCalls
+		: net_channel->receive_calls.load(std::memory_order_relaxed);
+	const uint64_t datagrams = (enet_uint32)(total_datagrams - reported_datagrams);
+	const uint64_t packets = sent_game_packets - reported_game_packets;
+	const uint64_t send_calls = (enet_uint32)(total_send_calls - reported_send_calls);
+	const uint64_t receive_calls = (enet_uint32)(total_receive_calls - reported_receive_calls);
+	const uint64_t ticks = std::max<uint64_t>(ticks_count - reported_ticks_count, 1);
+	reported_datagrams = total_datagrams;
+	reported_game_packets = sent_game_packets;
+	reported_send_calls = total_send_calls;
+	reported_receive_calls = total_receive_calls;
+	reported_ticks_count = ticks_count;
+	const uint64_t snapshot_bytes = sent_snapshot_bytes - reported_snapshot_bytes;
+	const uint64_t full_bytes = full_snapshot_bytes - reported_full_snapshot_bytes;
+	reported_snapshot_bytes = sent_snapshot_bytes;
+	reported_full_snapshot_bytes = full_snapshot_bytes;
+	const uint64_t player_syncs = handled_player_syncs - reported_player_syncs;
+	const uint64_t unchanged_syncs = unchanged_player_syncs - reported_unchanged_player_syncs;
+	reported_player_syncs = handled_player_syncs;
+	reported_unchanged_player_syncs = unchanged_player_syncs;
+
+	const double seconds = FLUSH_STATS_INTERVAL_MS / 1000.0;
+	const size_t peers = std::max<size_t>(peer_to_player_id.size(), 1);
+	std::cout
+	<< "Shard " << shard_index << " sends over the last " << seconds << "s: "
+	<< datagrams / seconds / peers << " datagrams/peer/s, "
+	<< ((datagrams > 0) ? (double)packets / datagrams : 0.0) << " game packets/datagram, "
+	<< ((packets > datagrams) ? (packets - datagrams) * DATAGRAM_HEADER_BYTES / seconds : 0.0)
+	<< " header bytes/s saved by coalescing, "
+	<< snapshot_bytes / seconds / peers << " snapshot bytes/peer/s ("
+	<< (double)snapshot_bytes / ticks / peers << "/tick, "
+	<< ((full_bytes > 0) ? 100.0 * snapshot_bytes / full_bytes : 100.0) << "% of full states' "
+	<< (double)full_bytes / ticks / peers << "/tick), "
+	<< ((player_syncs > 0) ? 100.0 * unchanged_syncs / player_syncs : 0.0) << "% of PLAYER_SYNCs unchanged, "
+	<< (double)send_calls / ticks << " send and " << (double)receive_calls / ticks << " receive syscalls/tick"
+	<< std::endl;
+
+	ScheduleTimer(FLUSH_STATS_INTERVAL_MS, ReportFlushStats);
+}
+
+#pragma endregion FLUSH_STATS
+
+#pragma region COROUTINES
+
+#pragma pack(push)
+#pragma pack()
+
+// Multi-step flows are written as coroutines that suspend on the shard loop's
+// own phases instead of blocking it: co_await NextTick() resumes in the next
+// simulate phase, Sleep() on the timer wheel, and ReliableDelivery() once ENet
+// is done with a packet. A Task starts running immediately and frees itself
+// when it returns; packet handlers must copy what they need out of the packet
+// before their first co_await, as it is destroyed once they suspend.
+
+struct Task {
+	struct promise_type {
+		Task get_return_object() { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		// Whichever phase resumed the task would otherwise get the exception
+		// and take the shard down with it: the task is logged and ends there,
+		// its frame freed like any finished task's
+		void unhandled_exception() noexcept {
+			try {
+				std::rethrow_exception(std::current_exception());
+			} catch (const std::exception& e) {
+				std::cout << "ERROR: Task failed: " << e.what() << std::endl;
+			} catch (...) {
+				std::cout << "ERROR: Task failed" << std::endl;
+			}
+		}
+	};
+};
+
+typedef struct {
+	std::coroutine_handle<> handle;
+	uint64_t match_generation; // Of the match the coroutine was suspended in
+} SuspendedTask;
+
+// Bumped by ResetMatch; coroutines suspended during an earlier match are
+// destroyed instead of resumed
+thread_local uint64_t match_generation = 0;
+
+static inline void ResumeTask(const SuspendedTask& task) {
+	if (task.match_generation != match_generation) task.handle.destroy();
+	else task.handle.resume();
+}
+
+thread_local std::vector<SuspendedTask> next_tick_tasks;
+thread_local std::vector<SuspendedTask> resuming_tasks;
+
+struct NextTick {
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> handle) {
+		next_tick_tasks.push_back(SuspendedTask{handle, match_generation});
+	}
+	void await_resume() const noexcept {}
+};
+
+static inline void ResumeNextTickTasks() {
+	if (next_tick_tasks.empty()) return;
+
+	// Tasks awaiting NextTick again land in the fresh list
+	resuming_tasks.swap(next_tick_tasks);
+	for (const SuspendedTask& task : resuming_tasks) ResumeTask(task);
+	resuming_tasks.clear();
+}
+
+struct Sleep {
+	uint64_t delay_ms;
+
+	explicit Sleep(const uint64_t delay_ms) : delay_ms(delay_ms) {}
+
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> handle) {
+		const SuspendedTask task{handle, match_generation};
+		ScheduleTimer(delay_ms, [task]{ ResumeTask(task); });
+	}
+	void await_resume() const noexcept {}
+};
+
+// Set from the packet's free callback, which runs on whichever thread
+// destroys it: the net thread in net thread mode
+typedef std::shared_ptr<std::atomic<bool>> PacketReleasedFlag;
+
+typedef struct {
+	SuspendedTask task;
+	PacketReleasedFlag released;
+	uint64_t deadline_ms; // Loop time
+} DeliveryWait;
+
+thread_local std::vector<DeliveryWait> delivery_waits;
+
+static void OnAwaitedPacketFree(void* packet) {
+	PacketReleasedFlag* released = (PacketReleasedFlag*)((ENetPacket*)packet)->userData;
+	(*released)->store(true);
+	delete released;
+}
+
+// ENet destroys a reliable packet once every peer it was sent to acknowledged
+// it, or dropped it along with a disconnecting peer. Construct this before
+// sending the packet and don't touch the packet afterwards; co_await yields
+// false if timeout_ms passed first.
+struct ReliableDelivery {
+	PacketReleasedFlag released = std::make_shared<std::atomic<bool>>(false);
+	uint64_t timeout_ms;
+
+	ReliableDelivery(ENetPacket* packet, const uint64_t timeout_ms) : timeout_ms(timeout_ms) {
+		packet->userData = new PacketReleasedFlag(released);
+		enet_packet_set_free_callback(packet, (void*)OnAwaitedPacketFree);
+	}
+
+	bool await_ready() const noexcept { return released->load(); }
+	void await_suspend(std::coroutine_handle<> handle) {
+		delivery_waits.push_back(DeliveryWait{
+			SuspendedTask{handle, match_generation},
+			released,
+			LoopTimeMs() + timeout_ms
+		});
+	}
+	bool await_resume() const noexcept { return released->load(); }
+};
+
+// Polled once per loop iteration; acknowledgements don't produce ENet events
+// and the free callback may run inside enet_host_service or on another thread
+static inline void ResumeDeliveredTasks() {
+	if (delivery_waits.empty()) return;
+
+	const uint64_t now_ms = LoopTimeMs();
+	for (size_t i = 0; i < delivery_waits.size();) {
+		if (!delivery_waits[i].released->load() && now_ms < delivery_waits[i].deadline_ms) {
+			i++;
+			continue;
+		}
+
+		const SuspendedTask task = delivery_waits[i].task;
+		delivery_waits[i] = std::move(delivery_waits.back());
+		delivery_waits.pop_back();
+		ResumeTask(task);
+	}
+}
+
+#pragma pack(pop)
+
+#pragma endregion COROUTINES
+
+#pragma region LATENCY_STATS
+
+// Bucket 0 counts samples under 1us, bucket i samples in [2^(i-1), 2^i) us;
+// the last bucket also takes everything beyond
+typedef struct {
+	std::array<uint64_t, LATENCY_HISTOGRAM_BUCKETS> buckets{};
+	uint64_t count = 0;
+	uint64_t max_us = 0;
+} LatencyHistogram;
+
+bool latency_stats = false;
+thread_local LatencyHistogram queue_delay_histogram; // Kernel arrival -> HandleReceive
+thread_local LatencyHistogram relay_delay_histogram; // PLAYER_SYNC handled -> relayed by BroadcastTick
+
+static inline void RecordLatency(LatencyHistogram& histogram, const int64_t latency_us) {
+	const uint64_t us = (latency_us > 0) ? (uint64_t)latency_us : 0;
+	size_t bucket = 0;
+	while (bucket < LATENCY_HISTOGRAM_BUCKETS - 1 && us >= (1ULL << bucket)) bucket++;
+
+	histogram.buckets[bucket]++;
+	histogram.count++;
+	histogram.max_us = std::max(histogram.max_us, us);
+}
+
+// Upper bound of the bucket holding the given fraction of samples
+static inline uint64_t LatencyPercentile(const LatencyHistogram& histogram, const double fraction) {
+	const uint64_t rank = (uint64_t)(fraction * (histogram.count - 1));
+	uint64_t seen = 0;
+	for (size_t bucket = 0; bucket < LATENCY_HISTOGRAM_BUCKETS - 1; bucket++) {
+		seen += histogram.buckets[bucket];
+		if (seen > rank) return 1ULL << bucket;
+	}
+	return histogram.max_us;
+}
+
+static inline void PrintLatencyHistogram(const char* name, const LatencyHistogram& histogram) {
+	std::cout << "  " << name << ": n=" << histogram.count;
+	if (histogram.count == 0) {
+		std::cout << std::endl;
+		return;
+	}
+
+	std::cout
+	<< " p50<" << LatencyPercentile(histogram, 0.5) << "us"
+	<< " p99<" << LatencyPercentile(histogram, 0.99) << "us"
+	<< " p999<" << LatencyPercentile(histogram, 0.999) << "us"
+	<< " max=" << histogram.max_us << "us\n   ";
+	for (size_t bucket = 0; bucket < LATENCY_HISTOGRAM_BUCKETS; bucket++) {
+		if (histogram.buckets[bucket] == 0) continue;
+		if (bucket == LATENCY_HISTOGRAM_BUCKETS - 1) std::cout << " >=" << (1ULL << (bucket - 1));
+		else std::cout << " <" << (1ULL << bucket);
+		std::cout << "us:" << histogram.buckets[bucket];
+	}
+	std::cout << std::endl;
+}
+
+static inline void ReportLatencyStats() {
+	std::cout << "Shard " << shard_index << " latency over the last " << LATENCY_REPORT_INTERVAL_MS / 1000 << "s:\n";
+	PrintLatencyHistogram("socket queueing (kernel arrival -> handler)", queue_delay_histogram);
+	PrintLatencyHistogram("PLAYER_SYNC handler -> relay", relay_delay_histogram);
+	queue_delay_histogram = LatencyHistogram{};
+	relay_delay_histogram = LatencyHistogram{};
+
+	ScheduleTimer(LATENCY_REPORT_INTERVAL_MS, ReportLatencyStats);
+}
+
+#pragma endregion LATENCY_STATS
+
+// A single-shard server hosts one match and exits with it; shards instead
+// reset and wait for their next match
+static inline void EndMatch(const std::string& reason) {
+	if (match_over) return;
+
+	if (shard_count == 1) {
+		std::cout << reason << ", shutting down..." << std::endl;
+		if (net_channel != nullptr) StopNetThread(net_channel);
+		exit(0);
+	}
+
+	std::cout << "Shard " << shard_index << ": " << reason << ", waiting for next match" << std::endl;
+	match_over = true;
+}
+
+static inline void ResetMatch() {
+	// Let queued reliable packets go out before disconnecting
+	for (auto const& [peer, _] : peer_to_player_id) DisconnectPeerLater(peer);
+
+	peer_to_player_id.clear();
+	player_id_to_peer.clear();
+	player_states.clear();
+	serverside_player_data.clear();
+	players_stats.clear();
+
+	if (next_match_map != nullptr) current_map = std::move(next_match_map);
+
+	// Suspended coroutines of this match are destroyed when next due
+	match_generation++;
+	round_transitioning = false;
+	game_ending = false;
+	game_started = false;
+	_player_GUID = 0;
+	match_over = false;
+}
+
+
+static inline Task RoundTransitionCooldown() {
+	round_transitioning = true;
+	co_await Sleep((uint64_t)(ROUND_TRANSITION_COOLDOWN * 1000));
+	round_transitioning = false;
+}
+
+
+// Broadcasts the final stats, then waits for CONTROL_GAME_END to be delivered
+// so a single-shard server doesn't exit with it still in flight
+static inline Task EndGame() {
+	game_ending = true;
+
+	std::vector<std::pair<PlayerID, float>> seek_times_sorted;
+	seek_times_sorted.reserve(players_stats.size());
+	for (auto const& [player_id, player_stats] : players_stats) {
+		seek_times_sorted.push_back({
+			player_id,
+			player_stats.seek_time
+		});
+	}
+	std::sort(
+		seek_times_sorted.begin(),
+		seek_times_sorted.end(),
+		[](
+			const std::pair<PlayerID, float>& st1,
+			const std::pair<PlayerID, float>& st2
+		){
+			return st1.second < st2.second;
+		}
+	);
+	std::unordered_map<PlayerID, int> seek_time_placements;
+	seek_time_placements.reserve(players_stats.size());
+	for (int i = 0; i < players_stats.size(); i++) {
+		seek_time_placements[seek_times_sorted[i].first] = i;
+	}
+	for (auto& [player_id, player_stats] : players_stats) {
+		// points = (player_count - seek_placement - 1) + last_alive_rounds
+		player_stats.points = (
+			(players_stats.size() - seek_time_placements[player_id] - 1)
+			+ player_stats.last_alive_rounds
+		);
+
+		#ifdef _HNS_DEBUG
+			_DEBUG_LOG
+			<< "Final player " << player_id << " stats:"
+			<< "\n- name: " << player_stats.name
+			<< "\n- seek time: " << player_stats.seek_time
+			<< "\n- seek time placement: " << seek_time_placements[player_id]
+			<< "\n- last alive rounds: " << std::to_string(player_stats.last_alive_rounds)
+			<< "\n- points: " << std::to_string(player_stats.points)
+			<< std::endl;
+		#endif // _HNS_DEBUG
+
+		PlayerStatsPacketData psp_data{};
+		psp_data.player_id = player_id;
+		psp_data.player_stats = player_stats;
+		ENetPacket* player_stats_packet = enet_packet_create(
+			&psp_data,
+			sizeof(PlayerStatsPacketData),
+			ENET_PACKET_FLAG_RELIABLE
+		);
+		BroadcastPacket(player_stats_packet);
+
+		#ifdef _HNS_DEBUG
+			_DEBUG_LOG
+			<< "Broadcasting aforementioned stats"
+			<< " with packet PLAYER_STATS " << std::to_string(PacketType::PLAYER_STATS)
+			<< std::endl;
+		#endif // _HNS_DEBUG
+	}
+
+	ENetPacket* control_game_end_packet = enet_packet_create(
+		std::array<char, 1>{PacketType::CONTROL_GAME_END}.data(),
+		sizeof(PacketType),
+		ENET_PACKET_FLAG_RELIABLE
+	);
+	ReliableDelivery game_end_delivery(control_game_end_packet, GAME_END_DELIVERY_TIMEOUT_MS);
+	BroadcastPacket(control_game_end_packet);
+
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG
+		<< "Broadcasting packet CONTROL_GAME_END "
+		<< PacketType::CONTROL_GAME_END
+		<< std::endl;
+	#endif // _HNS_DEBUG
+
+	if (!co_await game_end_delivery) {
+		#ifdef _HNS_DEBUG
+			_DEBUG_LOG
+			<< "CONTROL_GAME_END not acknowledged within "
+			<< GAME_END_DELIVERY_TIMEOUT_MS << "ms"
+			<< std::endl;
+		#endif // _HNS_DEBUG
+	}
+
+	EndMatch("Game ended");
+}
+
+
+static inline void CatchHider(
+	const PlayerID player_id,
+	const PlayerID caught_hider_id
+) {
+	if (round_transitioning || game_ending) return;
+
+
+	// If not caught by seeker: return
+	if (!(
+		player_states[player_id].player_state_flags
+		& PlayerStateFlags::IS_SEEKER
+	)) {
+		#ifdef _HNS_DEBUG
+			_DEBUG_LOG
+			<< "Player "
+			<< player_id
+			<< " catching hider "
+			<< caught_hider_id
+			<< " is found to not be a seeker; dropping"
+			<< std::endl;
+		#endif // _HNS_DEBUG
+
+		return;
+	}
+
+
+	// Kill caught hider
+	player_states[caught_hider_id].player_state_flags &= ~PlayerStateFlags::ALIVE;
+	player_states[caught_hider_id].position = current_map->hider_spawn;
+	{
+	ControlSetPlayerStatePacketData cspsp_data{};
+	cspsp_data.state = player_states[caught_hider_id];
+	ENetPacket* set_state_packet = enet_packet_create(
+		&cspsp_data,
+		sizeof(ControlSetPlayerStatePacketData),
+		ENET_PACKET_FLAG_RELIABLE
+	);
+	SendPacket(player_id_to_peer[caught_hider_id], set_state_packet);
+
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG
+		<< "Sending packet CONTROL_SET_PLAYER_STATE to "
+		<< caught_hider_id
+		<< " with data:"
+		<< "\n- packet type: " << std::to_string(cspsp_data.packet_type)
+		<< "\n- pos X (seeker spawn X): " << cspsp_data.state.position.x
+		<< "\n- pos Y (seeker spawn Y): " << cspsp_data.state.position.y
+		<< "\n- pos Z (seeker spawn Z): " << cspsp_data.state.position.z
+		<< "\n- yaw: " << cspsp_data.state.yaw
+		<< "\n- pitch: " << cspsp_data.state.pitch
+		<< "\n- flags:"
+		<< "\n^ - ALIVE: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::ALIVE) > 0)
+		<< "\n^ - IS_SEEKER: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::IS_SEEKER) > 0)
+		<< "\n^ - JUMPED: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+		<< "\n^ - WALLJUMP: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+		<< "\n^ - SLIDING: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+		<< "\n^ - FLASHLIGHT: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+		<< "\n- hook_point X: " << cspsp_data.state.hook_point.x
+		<< "\n- hook_point Y: " << cspsp_data.state.hook_point.y
+		<< "\n- hook_point Z: " << cspsp_data.state.hook_point.z
+		<< std::endl;
+	#endif // _HNS_DEBUG
+	}
+
+
+	// If alive hiders still left in round: return
+	int alive_hiders_left = 0;
+	for (auto const& [_, player_state] : player_states) {
+		if (player_state.player_state_flags & PlayerStateFlags::IS_SEEKER) continue;
+		if (player_state.player_state_flags & PlayerStateFlags::ALIVE) alive_hiders_left++;
+	}
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG << "alive_hiders_left == " << alive_hiders_left << std::endl;
+	#endif // _HNS_DEBUG
+	if (alive_hiders_left != 0) return;
+
+
+	RoundTransitionCooldown();
+
+
+	// Set/calculate players stats
+
+	players_stats[player_id].seek_time = std::chrono::duration<float>(
+		loop_time - current_seeker_timer
+	).count();
+
+	current_seeker_timer = loop_time;
+
+	serverside_player_data[player_id].was_seeker = true;
+
+	players_stats[caught_hider_id].last_alive_rounds++;
+
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG
+		<< "Set/calculated post-round player stats:"
+		<< "\n- seeker " << player_id << " seek time: "
+			<<  players_stats[player_id].seek_time
+		<< "\n- hider " << caught_hider_id << " last alive rounds: "
+			<< std::to_string(players_stats[caught_hider_id].last_alive_rounds)
+		<< std::endl;
+	#endif // _HNS_DEBUG
+
+
+	// End game if everyone has been a seeker
+	int done_seekers_count = 0;
+	for (auto const& [_, ss_player_data] : serverside_player_data) {
+		if (ss_player_data.was_seeker) done_seekers_count++;
+	}
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG
+		<< "done_seekers_count == " << done_seekers_count
+		<< std::endl;
+	#endif // _HNS_DEBUG
+	if (done_seekers_count == peer_to_player_id.size()) {
+		#ifdef _HNS_DEBUG
+			_DEBUG_LOG
+			<< "Everyone was a seeker; ending game..."
+			<< std::endl;
+		#endif // _HNS_DEBUG
+
+		EndGame();
+		return;
+	}
+
+
+	// Advance round (set players states -> respawn)
+
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG << "Advancing to next round..." << std::endl;
+	#endif // _HNS_DEBUG
+
+	serverside_player_data[player_id].was_seeker = true;
+
+	PlayerID next_seeker_id = -1;
+	for (auto const& [player_id, ss_player_data] : serverside_player_data) {
+		if (ss_player_data.was_seeker == false) {
+			next_seeker_id = player_id;
+			break;
+		}
+	}
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG << "Next seeker ID: " << next_seeker_id << std::endl;
+	#endif // _HNS_DEBUG
+	{
+	player_states[next_seeker_id].player_state_flags |= PlayerStateFlags::IS_SEEKER;
+	player_states[next_seeker_id].player_state_flags |= PlayerStateFlags::ALIVE;
+	player_states[next_seeker_id].position = current_map->seeker_spawn;
+	ControlSetPlayerStatePacketData cspsp_data{};
+	cspsp_data.state = player_states[next_seeker_id];
+	ENetPacket* set_state_packet = enet_packet_create(
+		&cspsp_data,
+		sizeof(ControlSetPlayerStatePacketData),
+		ENET_PACKET_FLAG_RELIABLE
+	);
+	SendPacket(player_id_to_peer[next_seeker_id], set_state_packet);
+
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG
+		<< "Sending packet CONTROL_SET_PLAYER_STATE to "
+		<< next_seeker_id
+		<< " with data:"
+		<< "\n- packet type: " << std::to_string(cspsp_data.packet_type)
+		<< "\n- pos X (seeker spawn X): " << cspsp_data.state.position.x
+		<< "\n- pos Y (seeker spawn Y): " << cspsp_data.state.position.y
+		<< "\n- pos Z (seeker spawn Z): " << cspsp_data.state.position.z
+		<< "\n- yaw: " << cspsp_data.state.yaw
+		<< "\n- pitch: " << cspsp_data.state.pitch
+		<< "\n- flags:"
+		<< "\n^ - ALIVE: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::ALIVE) > 0)
+		<< "\n^ - IS_SEEKER: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::IS_SEEKER) > 0)
+		<< "\n^ - JUMPED: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+		<< "\n^ - WALLJUMP: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+		<< "\n^ - SLIDING: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+		<< "\n^ - FLASHLIGHT: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+		<< "\n- hook_point X: " << cspsp_data.state.hook_point.x
+		<< "\n- hook_point Y: " << cspsp_data.state.hook_point.y
+		<< "\n- hook_point Z: " << cspsp_data.state.hook_point.z
+		<< std::endl;
+	#endif // _HNS_DEBUG
+	}
+	current_seeker_id = next_seeker_id;
+
+	for (auto& [_player_id, player_state] : player_states) {
+		if (_player_id == next_seeker_id) continue;
+
+		player_state.player_state_flags &= ~PlayerStateFlags::IS_SEEKER;
+		player_state.player_state_flags |= PlayerStateFlags::ALIVE;
+		player_state.position = current_map->hider_spawn;
+		ControlSetPlayerStatePacketData cspsp_data{};
+		cspsp_data.state = player_state;
+		ENetPacket* set_state_packet = enet_packet_create(
+			&cspsp_data,
+			sizeof(ControlSetPlayerStatePacketData),
+			ENET_PACKET_FLAG_RELIABLE
+		);
+		SendPacket(player_id_to_peer[_player_id], set_state_packet);
+
+		#ifdef _HNS_DEBUG
+			_DEBUG_LOG
+			<< "Sending packet CONTROL_SET_PLAYER_STATE to "
+			<< _player_id
+			<< " with data:"
+			<< "\n- packet type: " << std::to_string(cspsp_data.packet_type)
+			<< "\n- pos X (seeker spawn X): " << cspsp_data.state.position.x
+			<< "\n- pos Y (seeker spawn Y): " << cspsp_data.state.position.y
+			<< "\n- pos Z (seeker spawn Z): " << cspsp_data.state.position.z
+			<< "\n- yaw: " << cspsp_data.state.yaw
+			<< "\n- pitch: " << cspsp_data.state.pitch
+			<< "\n- flags:"
+			<< "\n^ - ALIVE: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::ALIVE) > 0)
+			<< "\n^ - IS_SEEKER: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::IS_SEEKER) > 0)
+			<< "\n^ - JUMPED: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+			<< "\n^ - WALLJUMP: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+			<< "\n^ - SLIDING: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+			<< "\n^ - FLASHLIGHT: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+			<< "\n- hook_point X: " << cspsp_data.state.hook_point.x
+			<< "\n- hook_point Y: " << cspsp_data.state.hook_point.y
+			<< "\n- hook_point Z: " << cspsp_data.state.hook_point.z
+			<< std::endl;
+		#endif // _HNS_DEBUG
+	}
+}
+
+
+static inline void HandleHiderCaughtPacket(
+	ENetPeer* peer,
+	ENetPacket* packet
+) {
+	TickSectionScope section(SECTION_HIDER_CAUGHT);
+
+	if (packet->dataLength < sizeof(PlayerHiderCaughtPacketData)) {
+		#ifdef _HNS_DEBUG
+			_DEBUG_LOG
+			<< "Received packet PLAYER_HIDER_CAUGHT size " << packet->dataLength
+			<< " is less than size of PlayerHiderCaughtPacketData " << sizeof(PlayerHiderCaughtPacketData)
+			<< std::endl;
+		#endif // _HNS_DEBUG
+
+		return;
+	}
+	if (peer_to_player_id.find(peer) == peer_to_player_id.end()) return;
+
+
+	const PlayerID player_id = peer_to_player_id[peer];
+
+	PlayerID caught_hider_id = *((PlayerID*)(
+		packet->data + offsetof(PlayerHiderCaughtPacketData, caught_hider_id)
+	));
+
+
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG
+		<< "Received packet PLAYER_HIDER_CAUGHT from Player "
+		<< player_id
+		<< ", with caught hider ID "
+		<< caught_hider_id
+		<< std::endl;
+	#endif // _HNS_DEBUG
+
+	CatchHider(player_id, caught_hider_id);
+}
+
+
+static inline void SendSnapshotEncoding(ENetPeer* peer, const PlayerID player_id) {
+	ControlSnapshotEncodingPacketData cse_data{};
+	cse_data.encoding = serverside_player_data[player_id].snapshot_encoding;
+	cse_data.bounds_min = current_map->bounds_min;
+	cse_data.bounds_max = current_map->bounds_max;
+	ENetPacket* snapshot_encoding_packet = enet_packet_create(
+		&cse_data,
+		sizeof(ControlSnapshotEncodingPacketData),
+		ENET_PACKET_FLAG_RELIABLE
+	);
+	SendPacket(peer, snapshot_encoding_packet);
+
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG
+		<< "Sending packet CONTROL_SNAPSHOT_ENCODING to player "
+		<< player_id
+		<< " with encoding "
+		<< std::to_string(cse_data.encoding)
+		<< std::endl;
+	#endif // _HNS_DEBUG
+}
+
+static inline void SendMapData(ENetPeer* peer, const PlayerID player_id) {
+	const std::string& map_data = current_map->data;
+	std::vector<char> map_data_packet_data(sizeof(PacketType) + map_data.size());
+	map_data_packet_data[0] = PacketType::CONTROL_MAP_DATA;
+	memcpy(map_data_packet_data.data() + 1, map_data.c_str(), map_data.size());
+	ENetPacket* map_data_packet = enet_packet_create(
+		map_data_packet_data.data(),
+		sizeof(PacketType) + map_data.size(),
+		ENET_PACKET_FLAG_RELIABLE
+	);
+	SendPacket(peer, map_data_packet);
+
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG
+		<< "Sending packet CONTROL_MAP_DATA to player "
+		<< player_id
+		<< std::endl;
+	#endif // _HNS_DEBUG
+
+	// The quantized range follows the map
+	if (serverside_player_data[player_id].snapshot_encoding == SNAPSHOT_ENCODING_QUANTIZED) {
+		SendSnapshotEncoding(peer, player_id);
+	}
+}
+
+
+static inline void HandlePlayerSyncPacket(
+	ENetPeer* peer,
+	ENetPacket* packet
+) {
+	TickSectionScope section(SECTION_PLAYER_SYNC);
+
+        if (packet->dataLength < sizeof(PlayerSyncPacketData)) {
+		#ifdef _HNS_DEBUG
+			_DEBUG_LOG
+			<< "Received packet PLAYER_SYNC data size " << packet->dataLength
+			<< " is less than size of PlayerSyncPacketData " << sizeof(PlayerSyncPacketData)
+			<< std::endl;
+		#endif // _HNS_DEBUG
+
+		return;
+	}
+
+	if (peer_to_player_id.find(peer) == peer_to_player_id.end()) {
+                const PlayerID player_id = NewPlayerGUID();
+
+                peer_to_player_id[peer] = player_id;
+                player_id_to_peer[player_id] = peer;
+
+                serverside_player_data[player_id] = ServerPlayerData{};
+                players_stats[player_id] = PlayerStats{};
+
+                std::cout
+		<< "Player "
+		<< player_id
+		<< " connected"
+		<< std::endl;
+
+                SendMapData(peer, player_id);
+        }
+
+        const PlayerID player_id = peer_to_player_id[peer];
+
+	const PlayerState previous_player_state = player_states[player_id];
+
+	// TEMPORARY SERVER AUTHORITY FIX
+	uint8_t previous_player_state_flags = player_states[player_id].player_state_flags;
+        player_states[player_id] = *((PlayerState*)(
+		packet->data + offsetof(PlayerSyncPacketData, player_state)
+	));
+	player_states[player_id].player_state_flags = (
+		(
+			player_states[player_id].player_state_flags &
+			~SERVER_AUTHORITY_PLAYER_STATE_FLAGS
+		) | (
+			previous_player_state_flags &
+			SERVER_AUTHORITY_PLAYER_STATE_FLAGS
+		)
+	);
+
+	// //PLAYER_SYNC
+	// #ifdef _HNS_DEBUG
+	// 	_DEBUG_LOG
+	// 	<< "Received packet PLAYER_SYNC from player "
+	// 	<< player_id
+	// 	<< " with data:"
+	// 	<< "\n- pos X: " << player_states[player_id].position.x
+	// 	<< "\n- pos Y: " << player_states[player_id].position.y
+	// 	<< "\n- pos Z: " << player_states[player_id].position.z
+	// 	<< "\n- yaw: " << player_states[player_id].yaw
+	// 	<< "\n- pitch: " << player_states[player_id].pitch
+	// 	<< "\n- flags:"
+	// 	<< "\n^ - ALIVE: " << ((player_states[player_id].player_state_flags & PlayerStateFlags::ALIVE) > 0)
+	// 	<< "\n^ - IS_SEEKER: " << ((player_states[player_id].player_state_flags & PlayerStateFlags::IS_SEEKER) > 0)
+	// 	<< "\n^ - JUMPED: " << ((player_states[player_id].player_state_flags & PlayerStateFlags::JUMPED) > 0)
+	// 	<< "\n^ - WALLJUMP: " << ((player_states[player_id].player_state_flags & PlayerStateFlags::JUMPED) > 0)
+	// 	<< "\n^ - SLIDING: " << ((player_states[player_id].player_state_flags & PlayerStateFlags::JUMPED) > 0)
+	// 	<< "\n^ - FLASHLIGHT: " << ((player_states[player_id].player_state_flags & PlayerStateFlags::JUMPED) > 0)
+	// 	<< "\n- hook_point X: " << player_states[player_id].hook_point.x
+	// 	<< "\n- hook_point Y: " << player_states[player_id].hook_point.y
+	// 	<< "\n- hook_point Z: " << player_states[player_id].hook_point.z
+	// 	<< std::endl;
+	// #endif // _HNS_DEBUG
+
+	handled_player_syncs++;
+
+	// Idle players keep sending the same state; it was already simulated and
+	// relayed, so the player isn't marked dirty and the tick skips it
+	if (memcmp(&previous_player_state, &player_states[player_id], sizeof(PlayerState)) == 0) {
+		unchanged_player_syncs++;
+		return;
+	}
+
+	ServerPlayerData& ss_player_data = serverside_player_data[player_id];
+	ss_player_data.state_dirty = true;
+	if (latency_stats) ss_player_data.state_handled_time = std::chrono::steady_clock::now();
+}
+
+
+static inline void HandlePlayerSetNamePacket(
+	ENetPeer* peer,
+	ENetPacket* packet
+) {
+	TickSectionScope section(SECTION_OTHER_PACKETS);
+
+	if (peer_to_player_id.find(peer) == peer_to_player_id.end()) return;
+        if (packet->dataLength < sizeof(PlayerSetNamePacketData)) {
+		#ifdef _HNS_DEBUG
+			_DEBUG_LOG
+			<< "Received packet PLAYER_SET_NAME size " << packet->dataLength
+			<< " is less than size of PlayerSetNamePacketData " << sizeof(PlayerSetNamePacketData)
+			<< std::endl;
+		#endif // _HNS_DEBUG
+
+		return;
+	}
+
+        memcpy(
+                players_stats[peer_to_player_id[peer]].name,
+                packet->data + offsetof(PlayerSetNamePacketData, name),
+                MAX_NAME_LENGTH
+        );
+
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG
+		<< "Received packet PLAYER_SET_NAME with data: "
+		<< players_stats[peer_to_player_id[peer]].name
+		<< std::endl;
+	#endif // _HNS_DEBUG
+}
+
+
+static inline void StartGame() {
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG
+		<< "Starting game..."
+		<< std::endl;
+	#endif // _HNS_DEBUG
+
+	current_seeker_id = peer_to_player_id.begin()->second;
+
+	#ifdef _HNS_DEBUG
 		_DEBUG_LOG
-		<< "Sending packet CONTROL_SET_PLAYER_STATE to "
-		<< next_seeker_id
+		<< "First chosen seeker id: "
+		<< current_seeker_id
+		<< std::endl;
+	#endif // _HNS_DEBUG
+
+	{
+        player_states[current_seeker_id].player_state_flags |= PlayerStateFlags::IS_SEEKER;
+        player_states[current_seeker_id].player_state_flags |= PlayerStateFlags::ALIVE;
+        player_states[current_seeker_id].position = current_map->seeker_spawn;
+        ControlSetPlayerStatePacketData cspsp_data{};
+        cspsp_data.state = player_states[current_seeker_id];
+        ENetPacket* set_state_packet = enet_packet_create(
+                &cspsp_data,
+                sizeof(ControlSetPlayerStatePacketData),
+                ENET_PACKET_FLAG_RELIABLE
+        );
+        SendPacket(player_id_to_peer[current_seeker_id], set_state_packet);
+
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG
+		<< "Sending packet CONTROL_SET_PLAYER_STATE to seeker player "
+		<< current_seeker_id
 		<< " with data:"
 		<< "\n- packet type: " << std::to_string(cspsp_data.packet_type)
 		<< "\n- pos X (seeker spawn X): " << cspsp_data.state.position.x
@@ -452,517 +2415,1546 @@ static inline void HandleHiderCaughtPacket(
 		<< std::endl;
 	#endif // _HNS_DEBUG
 	}
-	current_seeker_id = next_seeker_id;
 
-	for (auto& [_player_id, player_state] : player_states) {
-		if (_player_id == next_seeker_id) continue;
+	for (auto& [_player_id, player_state] : player_states) {
+                if (_player_id == current_seeker_id) continue;
+
+		player_state.player_state_flags &= ~PlayerStateFlags::IS_SEEKER;
+                player_state.player_state_flags |= PlayerStateFlags::ALIVE;
+                player_state.position = current_map->hider_spawn;
+                ControlSetPlayerStatePacketData cspsp_data{};
+                cspsp_data.state = player_state;
+                ENetPacket* set_state_packet = enet_packet_create(
+                        &cspsp_data,
+                        sizeof(ControlSetPlayerStatePacketData),
+                        ENET_PACKET_FLAG_RELIABLE
+                );
+                SendPacket(player_id_to_peer[_player_id], set_state_packet);
+
+		#ifdef _HNS_DEBUG
+			_DEBUG_LOG
+			<< "Sending packet CONTROL_SET_PLAYER_STATE to player "
+			<< _player_id
+			<< " with data:"
+			<< "\n- packet type: " << std::to_string(cspsp_data.packet_type)
+			<< "\n- pos X (seeker spawn X): " << cspsp_data.state.position.x
+			<< "\n- pos Y (seeker spawn Y): " << cspsp_data.state.position.y
+			<< "\n- pos Z (seeker spawn Z): " << cspsp_data.state.position.z
+			<< "\n- yaw: " << cspsp_data.state.yaw
+			<< "\n- pitch: " << cspsp_data.state.pitch
+			<< "\n- flags:"
+			<< "\n^ - ALIVE: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::ALIVE) > 0)
+			<< "\n^ - IS_SEEKER: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::IS_SEEKER) > 0)
+			<< "\n^ - JUMPED: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+			<< "\n^ - WALLJUMP: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+			<< "\n^ - SLIDING: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+			<< "\n^ - FLASHLIGHT: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+			<< "\n- hook_point X: " << cspsp_data.state.hook_point.x
+			<< "\n- hook_point Y: " << cspsp_data.state.hook_point.y
+			<< "\n- hook_point Z: " << cspsp_data.state.hook_point.z
+			<< std::endl;
+		#endif // _HNS_DEBUG
+        }
+
+	current_seeker_timer = loop_time;
+	game_started = true;
+
+	ENetPacket* game_start_packet = enet_packet_create(
+                std::array<char, 1>{PacketType::CONTROL_GAME_START}.data(),
+		sizeof(PacketType),
+		ENET_PACKET_FLAG_RELIABLE
+	);
+	BroadcastPacket(game_start_packet);
+
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG
+		<< "Broadcasting packet CONTROL_GAME_START..."
+		<< std::endl;
+	#endif // _HNS_DEBUG
+}
+
+
+static inline void HandlePlayerReadyPacket(ENetPeer* peer) {
+	TickSectionScope section(SECTION_PLAYER_READY);
+
+	if (game_started) return;
+	if (peer_to_player_id.find(peer) == peer_to_player_id.end()) return;
+	if (serverside_player_data[peer_to_player_id[peer]].ready) return;
+
+        const PlayerID player_id = peer_to_player_id[peer];
+
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG
+		<< "Received packet PLAYER_READY from player "
+		<< player_id
+		<< std::endl;
+	#endif // _HNS_DEBUG
+
+        serverside_player_data[player_id].ready = true;
+
+        int ready_players = 0;
+	for (auto const& [_, ss_player_data] : serverside_player_data) {
+		if (ss_player_data.ready) ready_players++;
+	}
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG
+		<< "ready_players == "
+		<< ready_players
+		<< std::endl;
+	#endif // _HNS_DEBUG
+	if (ready_players != peer_to_player_id.size()) return;
+
+	// Everyone is ready; start game
+	StartGame();
+}
+
+
+#pragma region SNAPSHOTS
+// Each tick that changed any player's state records every player's state as a
+// new snapshot. A client is sent the latest one as a delta against the latest
+// one it acknowledged: only the players and fields that differ, or every field
+// of every player when it hasn't acknowledged one still kept. Until it
+// acknowledges something newer, every snapshot it's sent is a delta against
+// that same one, so a lost snapshot is made up for by the next one
+
+static_assert((SNAPSHOT_HISTORY & (SNAPSHOT_HISTORY - 1)) == 0, "Sequence numbers wrap around the history");
+static_assert(SNAPSHOT_HISTORY <= std::numeric_limits<uint8_t>::max(), "Baseline ages are sent as a uint8_t");
+
+#pragma pack(push)
+#pragma pack()
+
+typedef struct {
+	uint16_t sequence = 0;
+	bool recorded = false;
+	std::vector<std::pair<PlayerID, PlayerState>> players; // Sorted by PlayerID
+} WorldSnapshot;
+
+#pragma pack(pop)
+
+thread_local std::array<WorldSnapshot, SNAPSHOT_HISTORY> world_snapshots;
+thread_local uint16_t latest_snapshot_sequence = 0; // Or the next one when none was recorded yet
+thread_local bool snapshot_recorded = false;
+
+thread_local std::vector<std::pair<PlayerID, PlayerState>> current_world; // Reused by RecordSnapshot
+thread_local std::vector<uint8_t> snapshot_buffer; // Reused by CreateSnapshotPacket
+thread_local std::vector<ENetPeer*> relay_peers; // Reused by BroadcastTick, for each relayed PLAYER_SYNC
+// Reused by BroadcastTick; by encoding, then baseline age
+thread_local std::array<std::array<std::vector<ENetPeer*>, SNAPSHOT_HISTORY>, SNAPSHOT_ENCODING_COUNT> shared_snapshot_peers;
+
+static inline const WorldSnapshot* FindSnapshot(const uint16_t sequence) {
+	const WorldSnapshot& snapshot = world_snapshots[sequence % SNAPSHOT_HISTORY];
+	return (snapshot.recorded && snapshot.sequence == sequence) ? &snapshot : nullptr;
+}
+
+static inline const PlayerState* FindSnapshotState(const WorldSnapshot& snapshot, const PlayerID player_id) {
+	const auto player = std::lower_bound(
+		snapshot.players.begin(),
+		snapshot.players.end(),
+		player_id,
+		[](const std::pair<PlayerID, PlayerState>& player, const PlayerID id) { return player.first < id; }
+	);
+	return (player != snapshot.players.end() && player->first == player_id) ? &player->second : nullptr;
+}
+
+static inline uint8_t ChangedSnapshotFields(const PlayerState* baseline_state, const PlayerState& player_state) {
+	if (baseline_state == nullptr) return SNAPSHOT_ALL_FIELDS;
+
+	uint8_t fields = 0;
+	if (memcmp(&baseline_state->position, &player_state.position, sizeof(Vec3)) != 0) fields |= SNAPSHOT_POSITION;
+	if (memcmp(&baseline_state->yaw, &player_state.yaw, sizeof(float)) != 0) fields |= SNAPSHOT_YAW;
+	if (memcmp(&baseline_state->pitch, &player_state.pitch, sizeof(float)) != 0) fields |= SNAPSHOT_PITCH;
+	if (baseline_state->player_state_flags != player_state.player_state_flags) fields |= SNAPSHOT_FLAGS;
+	if (memcmp(&baseline_state->hook_point, &player_state.hook_point, sizeof(Vec3)) != 0) fields |= SNAPSHOT_HOOK_POINT;
+	return fields;
+}
+
+// Records every player's state as a new snapshot if any changed since the
+// latest one; returns whether it did
+static inline bool RecordSnapshot() {
+	current_world.clear();
+	for (auto const& [player_id, player_state] : player_states) current_world.emplace_back(player_id, player_state);
+	std::sort(
+		current_world.begin(),
+		current_world.end(),
+		[](const std::pair<PlayerID, PlayerState>& a, const std::pair<PlayerID, PlayerState>& b) { return a.first < b.first; }
+	);
+
+	if (snapshot_recorded) {
+		const WorldSnapshot& latest = world_snapshots[latest_snapshot_sequence % SNAPSHOT_HISTORY];
+		bool changed = latest.players.size() != current_world.size();
+		for (size_t i = 0; !changed && i < current_world.size(); i++) {
+			changed =
+				latest.players[i].first != current_world[i].first ||
+				memcmp(&latest.players[i].second, &current_world[i].second, sizeof(PlayerState)) != 0;
+		}
+		if (!changed) return false;
+
+		latest_snapshot_sequence++;
+	}
+	snapshot_recorded = true;
+
+	WorldSnapshot& snapshot = world_snapshots[latest_snapshot_sequence % SNAPSHOT_HISTORY];
+	snapshot.sequence = latest_snapshot_sequence;
+	snapshot.recorded = true;
+	snapshot.players.swap(current_world);
+	return true;
+}
+
+static inline uint16_t QuantizeCoordinate(const float value, const float min, const float max) {
+	const float fraction = (max > min) ? (value - min) / (max - min) : 0.0f;
+	// fmax/fmin also turn NaN into the lower bound
+	return (uint16_t)std::lround(std::fmin(std::fmax(fraction, 0.0f), 1.0f) * std::numeric_limits<uint16_t>::max());
+}
+
+static inline uint16_t QuantizeAngle(const float radians) {
+	if (!std::isfinite(radians)) return 0;
+
+	// -32768..32768 for -pi..pi; the cast wraps it into 16 bits
+	return (uint16_t)std::lround(std::remainder(radians, 2.0 * std::numbers::pi) * (65536.0 / (2.0 * std::numbers::pi)));
+}
+
+static inline uint8_t* WriteSnapshotPosition(uint8_t* write_position, const Vec3& position, const uint8_t encoding) {
+	if (encoding == SNAPSHOT_ENCODING_FLOAT) {
+		memcpy(write_position, &position, sizeof(Vec3));
+		return write_position + sizeof(Vec3);
+	}
+
+	const uint16_t quantized[3] = {
+		QuantizeCoordinate(position.x, current_map->bounds_min.x, current_map->bounds_max.x),
+		QuantizeCoordinate(position.y, current_map->bounds_min.y, current_map->bounds_max.y),
+		QuantizeCoordinate(position.z, current_map->bounds_min.z, current_map->bounds_max.z)
+	};
+	memcpy(write_position, quantized, sizeof(quantized));
+	return write_position + sizeof(quantized);
+}
+
+static inline uint8_t* WriteSnapshotAngle(uint8_t* write_position, const float angle, const uint8_t encoding) {
+	if (encoding == SNAPSHOT_ENCODING_FLOAT) {
+		memcpy(write_position, &angle, sizeof(float));
+		return write_position + sizeof(float);
+	}
+
+	const uint16_t quantized = QuantizeAngle(angle);
+	memcpy(write_position, &quantized, sizeof(uint16_t));
+	return write_position + sizeof(uint16_t);
+}
+
+// The latest snapshot as a delta against baseline (against none when nullptr),
+// without except_id's state; nullptr when nothing differs
+static inline ENetPacket* CreateSnapshotPacket(
+	const WorldSnapshot* baseline,
+	const PlayerID except_id,
+	const uint8_t encoding
+) {
+	const WorldSnapshot& latest = world_snapshots[latest_snapshot_sequence % SNAPSHOT_HISTORY];
+
+	PlayerSnapshotPacketData ps_data{};
+	if (encoding == SNAPSHOT_ENCODING_QUANTIZED) ps_data.packet_type = PacketType::PLAYER_SNAPSHOT_QUANTIZED;
+	ps_data.sequence = latest_snapshot_sequence;
+	if (baseline != nullptr) ps_data.baseline_age = (uint16_t)(latest_snapshot_sequence - baseline->sequence);
+
+	snapshot_buffer.resize(
+		sizeof(PlayerSnapshotPacketData) +
+		latest.players.size() * (sizeof(PlayerSnapshotEntry) + sizeof(PlayerState))
+	);
+	uint8_t* write_position = snapshot_buffer.data() + sizeof(PlayerSnapshotPacketData);
+	for (auto const& [player_id, player_state] : latest.players) {
+		if (player_id == except_id) continue;
+
+		const uint8_t fields = ChangedSnapshotFields(
+			(baseline == nullptr) ? nullptr : FindSnapshotState(*baseline, player_id),
+			player_state
+		);
+		if (fields == 0) continue;
+
+		const PlayerSnapshotEntry entry{player_id, fields};
+		memcpy(write_position, &entry, sizeof(PlayerSnapshotEntry));
+		write_position += sizeof(PlayerSnapshotEntry);
+		if (fields & SNAPSHOT_POSITION) write_position = WriteSnapshotPosition(write_position, player_state.position, encoding);
+		if (fields & SNAPSHOT_YAW) write_position = WriteSnapshotAngle(write_position, player_state.yaw, encoding);
+		if (fields & SNAPSHOT_PITCH) write_position = WriteSnapshotAngle(write_position, player_state.pitch, encoding);
+		if (fields & SNAPSHOT_FLAGS) *(write_position++) = player_state.player_state_flags;
+		if (fields & SNAPSHOT_HOOK_POINT) write_position = WriteSnapshotPosition(write_position, player_state.hook_point, encoding);
+		ps_data.player_count++;
+	}
+	if (ps_data.player_count == 0) return nullptr;
+
+	memcpy(snapshot_buffer.data(), &ps_data, sizeof(PlayerSnapshotPacketData));
+	// Past the MTU it's fragmented, but still delivered whole or not at all
+	return enet_packet_create(
+		snapshot_buffer.data(),
+		write_position - snapshot_buffer.data(),
+		ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT
+	);
+}
+
+static inline void CountSnapshotBytes(const ENetPacket* snapshot_packet, const size_t recipients) {
+	const PlayerSnapshotPacketData* ps_data = (const PlayerSnapshotPacketData*)snapshot_packet->data;
+	sent_snapshot_bytes += snapshot_packet->dataLength * recipients;
+	full_snapshot_bytes += (
+		sizeof(PlayerSnapshotPacketData) +
+		ps_data->player_count * (sizeof(PlayerSnapshotEntry) + sizeof(PlayerState))
+	) * recipients;
+}
+
+static inline void HandlePlayerSnapshotAckPacket(
+	ENetPeer* peer,
+	ENetPacket* packet
+) {
+	TickSectionScope section(SECTION_OTHER_PACKETS);
+
+	if (packet->dataLength < sizeof(PlayerSnapshotAckPacketData)) {
+		#ifdef _HNS_DEBUG
+			_DEBUG_LOG
+			<< "Received packet PLAYER_SNAPSHOT_ACK data size " << packet->dataLength
+			<< " is less than size of PlayerSnapshotAckPacketData " << sizeof(PlayerSnapshotAckPacketData)
+			<< std::endl;
+		#endif // _HNS_DEBUG
+
+		return;
+	}
+
+	const auto player = peer_to_player_id.find(peer);
+	if (player == peer_to_player_id.end()) return;
+	ServerPlayerData& ss_player_data = serverside_player_data[player->second];
+
+	uint16_t sequence;
+	memcpy(&sequence, packet->data + offsetof(PlayerSnapshotAckPacketData, sequence), sizeof(uint16_t));
+
+	// Only still kept snapshots are worth anything as baselines, and
+	// acknowledgements can arrive out of order; ones from before a hot upgrade
+	// never match a kept snapshot, as the sequence carries on across it
+	if (FindSnapshot(sequence) == nullptr) return;
+	if (
+		ss_player_data.snapshot_acked &&
+		FindSnapshot(ss_player_data.acked_snapshot_sequence) != nullptr &&
+		(int16_t)(sequence - ss_player_data.acked_snapshot_sequence) <= 0
+	) return;
+
+	ss_player_data.snapshot_acked = true;
+	ss_player_data.acked_snapshot_sequence = sequence;
+}
+
+static inline void HandlePlayerSetSnapshotEncodingPacket(
+	ENetPeer* peer,
+	ENetPacket* packet
+) {
+	TickSectionScope section(SECTION_OTHER_PACKETS);
+
+	if (packet->dataLength < sizeof(PlayerSetSnapshotEncodingPacketData)) {
+		#ifdef _HNS_DEBUG
+			_DEBUG_LOG
+			<< "Received packet PLAYER_SET_SNAPSHOT_ENCODING data size " << packet->dataLength
+			<< " is less than size of PlayerSetSnapshotEncodingPacketData " << sizeof(PlayerSetSnapshotEncodingPacketData)
+			<< std::endl;
+		#endif // _HNS_DEBUG
+
+		return;
+	}
+
+	const auto player = peer_to_player_id.find(peer);
+	if (player == peer_to_player_id.end()) return;
+
+	const uint8_t encoding = *(packet->data + offsetof(PlayerSetSnapshotEncodingPacketData, encoding));
+	// Unknown encodings are refused by confirming the current one
+	if (encoding < SNAPSHOT_ENCODING_COUNT) {
+		serverside_player_data[player->second].snapshot_encoding = encoding;
+		serverside_player_data[player->second].snapshots = true;
+	}
+	SendSnapshotEncoding(peer, player->second);
+}
+
+static inline void BroadcastTick() {
+	TickSectionScope section(SECTION_RELAY);
+
+	for (auto& [player_id, ss_player_data] : serverside_player_data) {
+		if (!ss_player_data.state_dirty) continue;
+		ss_player_data.state_dirty = false;
+
+		if (latency_stats) RecordLatency(
+			relay_delay_histogram,
+			std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - ss_player_data.state_handled_time
+			).count()
+		);
+
+		// Clients that never set a snapshot encoding get the PLAYER_SYNC as is
+		relay_peers.clear();
+		for (auto const& [player_peer, _player_id] : peer_to_player_id) {
+			if (_player_id == player_id || serverside_player_data[_player_id].snapshots) continue;
+			relay_peers.push_back(player_peer);
+		}
+		if (relay_peers.empty()) continue;
+
+		PlayerSyncPacketData psp_data{};
+		psp_data.player_id = player_id;
+		psp_data.player_state = player_states[player_id];
+		SendPacketToPeers(enet_packet_create(&psp_data, sizeof(PlayerSyncPacketData), 0), relay_peers);
+	}
+
+	const bool recorded = RecordSnapshot();
+	if (!snapshot_recorded) return;
+
+	// Peers whose own state is the same in the latest snapshot and their
+	// baseline get a snapshot shared by everyone with that baseline; the
+	// others get their own, without their state
+	for (auto& encoding_peers : shared_snapshot_peers) {
+		for (auto& peers : encoding_peers) peers.clear();
+	}
+	for (auto const& [player_peer, player_id] : peer_to_player_id) {
+		ServerPlayerData& ss_player_data = serverside_player_data[player_id];
+		if (!ss_player_data.snapshots) continue;
+		const WorldSnapshot* baseline = ss_player_data.snapshot_acked
+			? FindSnapshot(ss_player_data.acked_snapshot_sequence)
+			: nullptr;
+		if (baseline != nullptr && baseline->sequence == latest_snapshot_sequence) continue;
+		if (
+			!recorded &&
+			ss_player_data.snapshot_sent &&
+			ss_player_data.sent_snapshot_sequence == latest_snapshot_sequence &&
+			loop_time - ss_player_data.snapshot_sent_time < std::chrono::milliseconds(SNAPSHOT_RESEND_INTERVAL_MS)
+		) continue;
+
+		ss_player_data.snapshot_sent = true;
+		ss_player_data.sent_snapshot_sequence = latest_snapshot_sequence;
+		ss_player_data.snapshot_sent_time = loop_time;
+
+		const WorldSnapshot& latest = world_snapshots[latest_snapshot_sequence % SNAPSHOT_HISTORY];
+		if (
+			baseline != nullptr &&
+			ChangedSnapshotFields(FindSnapshotState(*baseline, player_id), *FindSnapshotState(latest, player_id)) == 0
+		) {
+			shared_snapshot_peers[ss_player_data.snapshot_encoding][(uint16_t)(latest_snapshot_sequence - baseline->sequence)].push_back(player_peer);
+			continue;
+		}
+
+		ENetPacket* snapshot_packet = CreateSnapshotPacket(baseline, player_id, ss_player_data.snapshot_encoding);
+		if (snapshot_packet == nullptr) continue;
+		CountSnapshotBytes(snapshot_packet, 1);
+		SendPacket(player_peer, snapshot_packet);
+	}
+
+	for (uint8_t encoding = 0; encoding < SNAPSHOT_ENCODING_COUNT; encoding++) {
+		for (size_t baseline_age = 1; baseline_age < SNAPSHOT_HISTORY; baseline_age++) {
+			std::vector<ENetPeer*>& peers = shared_snapshot_peers[encoding][baseline_age];
+			if (peers.empty()) continue;
+
+			ENetPacket* snapshot_packet = CreateSnapshotPacket(
+				FindSnapshot(latest_snapshot_sequence - baseline_age),
+				NO_PLAYER_ID,
+				encoding
+			);
+			if (snapshot_packet == nullptr) continue;
+			CountSnapshotBytes(snapshot_packet, peers.size());
+			SendPacketToPeers(snapshot_packet, peers);
+		}
+	}
+}
+
+#pragma endregion SNAPSHOTS
+
+
+static inline void HandleReceive(
+	ENetPeer* peer,
+	ENetPacket* packet
+) {
+	// Peers of a finished match linger until their disconnect completes; the
+	// net thread owns the peer, so then it's the game thread's own view
+	if (
+		(net_channel == nullptr)
+			? peer->state != ENET_PEER_STATE_CONNECTED
+			: peer_connect_ids.find(peer) == peer_connect_ids.end()
+	) {
+		enet_packet_destroy(packet);
+		return;
+	}
+
+        if (packet->dataLength < sizeof(PacketType)) {
+		#ifdef _HNS_DEBUG
+			_DEBUG_LOG
+			<< "Received packet data length " << packet->dataLength
+			<< " is less than size of PacketType: " << sizeof(PacketType)
+			<< std::endl;
+		#endif // _HNS_DEBUG
+
+		enet_packet_destroy(packet);
+		return;
+	}
+
+        // The packet is only valid until its handler returns; the Tasks game flow
+        // starts from handlers (EndGame, RoundTransitionCooldown) don't keep it
+        switch (*((PacketType*)(packet->data + 0))) {
+                default: break;
+
+		case PacketType::PLAYER_HIDER_CAUGHT:
+			HandleHiderCaughtPacket(peer, packet);
+			break;
+
+		case PacketType::PLAYER_SYNC:
+			HandlePlayerSyncPacket(peer, packet);
+			break;
+
+		case PacketType::PLAYER_SET_NAME:
+			HandlePlayerSetNamePacket(peer, packet);
+			break;
+
+		case PacketType::PLAYER_READY:
+			HandlePlayerReadyPacket(peer);
+			break;
+
+		case PacketType::PLAYER_SNAPSHOT_ACK:
+			HandlePlayerSnapshotAckPacket(peer, packet);
+			break;
+
+		case PacketType::PLAYER_SET_SNAPSHOT_ENCODING:
+			HandlePlayerSetSnapshotEncodingPacket(peer, packet);
+			break;
+        }
+
+        enet_packet_destroy(packet);
+}
+
+
+static inline void SimulateTick() {
+	TickSectionScope section(SECTION_SIMULATE);
+
+	std::vector<PlayerID> synced_player_ids;
+	synced_player_ids.reserve(serverside_player_data.size());
+	for (auto const& [player_id, ss_player_data] : serverside_player_data) {
+		if (ss_player_data.state_dirty) synced_player_ids.push_back(player_id);
+	}
+
+	for (const PlayerID player_id : synced_player_ids) {
+		if (match_over) break;
+
+		if (
+			player_states[player_id].position.y < 0.0 &&
+			!round_transitioning
+		) {
+			#ifdef _HNS_DEBUG
+				_DEBUG_LOG
+				<< "Player "
+				<< player_id
+				<< "'s Y "
+				<< player_states[player_id].position.y
+				<< " is below 0.0"
+				<< std::endl;
+			#endif // _HNS_DEBUG
+
+			if (
+				player_id != current_seeker_id &&
+				!(player_states[player_id].player_state_flags & PlayerStateFlags::IS_SEEKER) &&
+				player_states[player_id].player_state_flags & PlayerStateFlags::ALIVE
+			) {
+				#ifdef _HNS_DEBUG
+					_DEBUG_LOG
+					<< "Player below Y 0.0 is found to be a hider; caught by seeker"
+					<< std::endl;
+				#endif // _HNS_DEBUG
+
+				CatchHider(current_seeker_id, player_id);
+			}
+			else if (
+				player_id == current_seeker_id ||
+				player_states[player_id].player_state_flags & PlayerStateFlags::IS_SEEKER //&&
+				//player_states[player_id].player_state_flags & PlayerStateFlags::ALIVE
+			) {
+				#ifdef _HNS_DEBUG
+					_DEBUG_LOG
+					<< "Player below Y 0.0 is found to be a seeker"
+					<< std::endl;
+				#endif // _HNS_DEBUG
+
+				player_states[player_id].position = current_map->seeker_spawn;
+				ControlSetPlayerStatePacketData cspsp_data{};
+				cspsp_data.state = player_states[player_id];
+				ENetPacket* set_state_packet = enet_packet_create(
+					&cspsp_data,
+					sizeof(ControlSetPlayerStatePacketData),
+					ENET_PACKET_FLAG_RELIABLE
+				);
+				SendPacket(player_id_to_peer[player_id], set_state_packet);
+
+				#ifdef _HNS_DEBUG
+					_DEBUG_LOG
+					<< "Sending packet CONTROL_SET_PLAYER_STATE to "
+					<< player_id
+					<< " with data:"
+					<< "\n- packet type: " << std::to_string(cspsp_data.packet_type)
+					<< "\n- pos X (seeker spawn X): " << cspsp_data.state.position.x
+					<< "\n- pos Y (seeker spawn Y): " << cspsp_data.state.position.y
+					<< "\n- pos Z (seeker spawn Z): " << cspsp_data.state.position.z
+					<< "\n- yaw: " << cspsp_data.state.yaw
+					<< "\n- pitch: " << cspsp_data.state.pitch
+					<< "\n- flags:"
+					<< "\n^ - ALIVE: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::ALIVE) > 0)
+					<< "\n^ - IS_SEEKER: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::IS_SEEKER) > 0)
+					<< "\n^ - JUMPED: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+					<< "\n^ - WALLJUMP: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+					<< "\n^ - SLIDING: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+					<< "\n^ - FLASHLIGHT: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+					<< "\n- hook_point X: " << cspsp_data.state.hook_point.x
+					<< "\n- hook_point Y: " << cspsp_data.state.hook_point.y
+					<< "\n- hook_point Z: " << cspsp_data.state.hook_point.z
+					<< std::endl;
+				#endif // _HNS_DEBUG
+			}
+			else {
+				#ifdef _HNS_DEBUG
+					_DEBUG_LOG
+					<< "Player below Y 0.0 is found to be a spectator"
+					<< std::endl;
+				#endif // _HNS_DEBUG
 
-		player_state.player_state_flags &= ~PlayerStateFlags::IS_SEEKER;
-		player_state.player_state_flags |= PlayerStateFlags::ALIVE;
-		player_state.position = hider_spawn;
-		ControlSetPlayerStatePacketData cspsp_data{};
-		cspsp_data.state = player_state;
-		ENetPacket* set_state_packet = enet_packet_create(
-			&cspsp_data,
-			sizeof(ControlSetPlayerStatePacketData),
-			ENET_PACKET_FLAG_RELIABLE
-		);
-		enet_peer_send(player_id_to_peer[_player_id], 0, set_state_packet);
+				player_states[player_id].position = current_map->hider_spawn;
+				ControlSetPlayerStatePacketData cspsp_data{};
+				cspsp_data.state = player_states[player_id];
+				ENetPacket* set_state_packet = enet_packet_create(
+					&cspsp_data,
+					sizeof(ControlSetPlayerStatePacketData),
+					ENET_PACKET_FLAG_RELIABLE
+				);
+				SendPacket(player_id_to_peer[player_id], set_state_packet);
 
-		#ifdef _HNS_DEBUG
-			_DEBUG_LOG
-			<< "Sending packet CONTROL_SET_PLAYER_STATE to "
-			<< _player_id
-			<< " with data:"
-			<< "\n- packet type: " << std::to_string(cspsp_data.packet_type)
-			<< "\n- pos X (seeker spawn X): " << cspsp_data.state.position.x
-			<< "\n- pos Y (seeker spawn Y): " << cspsp_data.state.position.y
-			<< "\n- pos Z (seeker spawn Z): " << cspsp_data.state.position.z
-			<< "\n- yaw: " << cspsp_data.state.yaw
-			<< "\n- pitch: " << cspsp_data.state.pitch
-			<< "\n- flags:"
-			<< "\n^ - ALIVE: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::ALIVE) > 0)
-			<< "\n^ - IS_SEEKER: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::IS_SEEKER) > 0)
-			<< "\n^ - JUMPED: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-			<< "\n^ - WALLJUMP: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-			<< "\n^ - SLIDING: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-			<< "\n^ - FLASHLIGHT: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-			<< "\n- hook_point X: " << cspsp_data.state.hook_point.x
-			<< "\n- hook_point Y: " << cspsp_data.state.hook_point.y
-			<< "\n- hook_point Z: " << cspsp_data.state.hook_point.z
-			<< std::endl;
-		#endif // _HNS_DEBUG
+				#ifdef _HNS_DEBUG
+					_DEBUG_LOG
+					<< "Sending packet CONTROL_SET_PLAYER_STATE to "
+					<< player_id
+					<< " with data:"
+					<< "\n- packet type: " << std::to_string(cspsp_data.packet_type)
+					<< "\n- pos X (seeker spawn X): " << cspsp_data.state.position.x
+					<< "\n- pos Y (seeker spawn Y): " << cspsp_data.state.position.y
+					<< "\n- pos Z (seeker spawn Z): " << cspsp_data.state.position.z
+					<< "\n- yaw: " << cspsp_data.state.yaw
+					<< "\n- pitch: " << cspsp_data.state.pitch
+					<< "\n- flags:"
+					<< "\n^ - ALIVE: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::ALIVE) > 0)
+					<< "\n^ - IS_SEEKER: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::IS_SEEKER) > 0)
+					<< "\n^ - JUMPED: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+					<< "\n^ - WALLJUMP: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+					<< "\n^ - SLIDING: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+					<< "\n^ - FLASHLIGHT: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
+					<< "\n- hook_point X: " << cspsp_data.state.hook_point.x
+					<< "\n- hook_point Y: " << cspsp_data.state.hook_point.y
+					<< "\n- hook_point Z: " << cspsp_data.state.hook_point.z
+					<< std::endl;
+				#endif // _HNS_DEBUG
+			}
+		}
 	}
 }
 
 
-static inline void HandleReceive(
-	ENetPeer* peer,
-	ENetPacket* packet
-) {
-        if (packet->dataLength < sizeof(PacketType)) {
-		#ifdef _HNS_DEBUG
-			_DEBUG_LOG
-			<< "Received packet data length " << packet->dataLength
-			<< " is less than size of PacketType: " << sizeof(PacketType)
-			<< std::endl;
-		#endif // _HNS_DEBUG
+#pragma region FAIR_DRAIN
+// A peer sending faster than we handle would otherwise have its whole backlog
+// handled ahead of everyone else's packets and the tick. Past its quota for
+// the iteration, a peer's PLAYER_SYNCs only overwrite each other (the latest is
+// applied once the receive phase is done) and its other packets wait, in order,
+// for the next iterations, which take them one per peer per round
 
-		enet_packet_destroy(packet);
+uint32_t peer_event_quota = DEFAULT_PEER_EVENT_QUOTA; // 0: unlimited
+
+#pragma pack(push)
+#pragma pack()
+
+typedef struct {
+	ENetPeer* peer; // The events' peer, whose packets are held here
+	uint32_t handled_count; // This iteration
+	ENetPacket* coalesced_sync; // Latest over-quota PLAYER_SYNC
+	std::deque<ENetPacket*> deferred; // Other over-quota packets
+} PeerDrainState;
+
+#pragma pack(pop)
+
+thread_local std::array<PeerDrainState, MAX_PLAYERS> peer_drain_states{};
+thread_local std::vector<size_t> coalesced_peer_slots;
+thread_local uint64_t superseded_syncs_count = 0;
+thread_local uint64_t deferred_packets_count = 0;
+
+// Only from the peer's address, which the game thread may use as a key: the
+// peer itself is the net thread's with --net-thread
+static inline size_t PeerSlot(ENetPeer* peer) {
+	return peer - server->peers;
+}
+
+static inline void StartFairDrain() {
+	for (bool deferred_left = deferred_receives_count > 0; deferred_left;) {
+		deferred_left = false;
+		for (size_t slot = 0; slot < MAX_PLAYERS; slot++) {
+			PeerDrainState& state = peer_drain_states[slot];
+			if (state.deferred.empty() || state.handled_count >= peer_event_quota) continue;
+
+			ENetPacket* packet = state.deferred.front();
+			state.deferred.pop_front();
+			deferred_receives_count--;
+			state.handled_count++;
+			HandleReceive(state.peer, packet);
+			if (!state.deferred.empty() && state.handled_count < peer_event_quota) deferred_left = true;
+		}
+	}
+}
+
+static inline void ReceiveFairly(ENetPeer* peer, ENetPacket* packet) {
+	PeerDrainState& state = peer_drain_states[PeerSlot(peer)];
+	if (peer_event_quota == 0 || state.handled_count < peer_event_quota) {
+		state.handled_count++;
+		HandleReceive(peer, packet);
 		return;
 	}
 
-        switch (*((PacketType*)(packet->data + 0))) {
+	state.peer = peer;
+	if (
+		packet->dataLength >= sizeof(PacketType) &&
+		*((PacketType*)(packet->data + 0)) == PacketType::PLAYER_SYNC
+	) {
+		if (state.coalesced_sync != nullptr) {
+			enet_packet_destroy(state.coalesced_sync);
+			superseded_syncs_count++;
+		} else coalesced_peer_slots.push_back(PeerSlot(peer));
+		state.coalesced_sync = packet;
+		return;
+	}
+
+	state.deferred.push_back(packet);
+	deferred_receives_count++;
+	deferred_packets_count++;
+}
+
+static inline void FinishFairDrain() {
+	for (const size_t slot : coalesced_peer_slots) {
+		PeerDrainState& state = peer_drain_states[slot];
+		if (state.coalesced_sync == nullptr) continue; // Its peer disconnected since
+
+		HandleReceive(state.peer, state.coalesced_sync);
+		state.coalesced_sync = nullptr;
+	}
+	coalesced_peer_slots.clear();
+
+	for (PeerDrainState& state : peer_drain_states) state.handled_count = 0;
+}
+
+static inline void DropPeerDrainState(ENetPeer* peer) {
+	PeerDrainState& state = peer_drain_states[PeerSlot(peer)];
+	if (state.coalesced_sync != nullptr) {
+		enet_packet_destroy(state.coalesced_sync);
+		state.coalesced_sync = nullptr;
+	}
+	for (ENetPacket* packet : state.deferred) enet_packet_destroy(packet);
+	deferred_receives_count -= state.deferred.size();
+	state.deferred.clear();
+}
+#pragma endregion FAIR_DRAIN
+
+
+// address is event.peer's, as the net thread saw it when there is one
+static inline void HandleEvent(ENetEvent& event, const ENetAddress& address) {
+        switch (event.type) {
                 default: break;
 
-		case PacketType::PLAYER_HIDER_CAUGHT:
+                case ENET_EVENT_TYPE_CONNECT:
                 {
-			HandleHiderCaughtPacket(peer, packet);
+			#ifdef _HNS_DEBUG
+				char _DEBUG_ip[64] = {0};
+				enet_address_get_host_ip(
+					&address,
+					_DEBUG_ip,
+					sizeof(_DEBUG_ip)
+				);
+				_DEBUG_LOG
+				<< "Received ENET_EVENT_TYPE_CONNECT from "
+				<< _DEBUG_ip
+				<< std::endl;
+			#endif // _HNS_DEBUG
+
+                        if (game_started || draining) {
+				RejectPeer(event.peer);
+				return;
+			}
                 }
                 break;
 
-                case PacketType::PLAYER_SYNC:
+                case ENET_EVENT_TYPE_RECEIVE:
                 {
-                        if (packet->dataLength < sizeof(PlayerSyncPacketData)) {
-				#ifdef _HNS_DEBUG
-					_DEBUG_LOG
-					<< "Received packet PLAYER_SYNC data size " << packet->dataLength
-					<< " is less than size of PlayerSyncPacketData " << sizeof(PlayerSyncPacketData)
-					<< std::endl;
-				#endif // _HNS_DEBUG
+			// #ifdef _HNS_DEBUG
+			// 	char _DEBUG_ip[64] = {0};
+			// 	enet_address_get_host_ip(
+			// 		&address,
+			// 		_DEBUG_ip,
+			// 		sizeof(_DEBUG_ip)
+			// 	);
+			// 	_DEBUG_LOG
+			// 	<< "Received ENET_EVENT_TYPE_RECEIVE from "
+			// 	<< _DEBUG_ip
+			// 	<< std::endl;
+			// #endif // _HNS_DEBUG
 
-				break;
+			// Arrival timestamps are CLOCK_REALTIME
+			if (latency_stats && event.packet->receivedTimestamp != 0) RecordLatency(
+				queue_delay_histogram,
+				(
+					std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::system_clock::now().time_since_epoch()
+					).count() - (int64_t)event.packet->receivedTimestamp
+				) / 1000
+			);
+
+                        ReceiveFairly(event.peer, event.packet);
+                }
+                break;
+
+                case ENET_EVENT_TYPE_DISCONNECT:
+		#ifdef _HNS_DEBUG
+			{
+			char _DEBUG_ip[64] = {0};
+			enet_address_get_host_ip(
+				&address,
+				_DEBUG_ip,
+				sizeof(_DEBUG_ip)
+			);
+			_DEBUG_LOG
+			<< "Received ENET_EVENT_TYPE_DISCONNECT from "
+			<< _DEBUG_ip
+			<< std::endl;
 			}
+		#endif // _HNS_DEBUG
+                case ENET_EVENT_TYPE_DISCONNECT_TIMEOUT:
+                {
+			DropPeerDrainState(event.peer);
+
+			if (peer_to_player_id.find(event.peer) == peer_to_player_id.end()) return;
+
+                        const PlayerID player_id = peer_to_player_id[event.peer];
 
-			if (peer_to_player_id.find(peer) == peer_to_player_id.end()) {
-                                const PlayerID player_id = NewPlayerGUID();
+                        if (game_started) {
+				// Players leave once they got CONTROL_GAME_END
+				if (!game_ending) EndMatch(
+					"Player "
+					+ std::to_string(player_id)
+					+ " disconnected during started game"
+				);
+				return;
+                        }
 
-                                peer_to_player_id[peer] = player_id;
-                                player_id_to_peer[player_id] = peer;
+                        std::cout
+                        << "Player "
+                        << player_id
+                        << " disconnected"
+                        << std::endl;
 
-                                serverside_player_data[player_id] = ServerPlayerData{};
-                                players_stats[player_id] = PlayerStats{};
+                        player_states.erase(player_id);
+                        serverside_player_data.erase(player_id);
+                        players_stats.erase(player_id);
 
-                                std::cout
-				<< "Player "
-				<< player_id
-				<< " connected"
+                        player_id_to_peer.erase(player_id);
+                        peer_to_player_id.erase(event.peer);
+
+                        PlayerDisconnectedPacketData pdp_data{};
+			pdp_data.disconnected_player_id = player_id;
+			ENetPacket* player_disconnected_packet = enet_packet_create(
+				&pdp_data,
+				sizeof(PlayerDisconnectedPacketData),
+				ENET_PACKET_FLAG_RELIABLE
+			);
+			BroadcastPacket(player_disconnected_packet);
+
+			#ifdef _HNS_DEBUG
+				_DEBUG_LOG
+				<< "Broadcasting packet PLAYER_DISCONNECTED with data:\n"
+				<< "- Packet type: " << std::to_string(pdp_data.packet_type) << "\n"
+				<< "- Disconnected Player ID: " << pdp_data.disconnected_player_id
 				<< std::endl;
+			#endif // _HNS_DEBUG
+                }
+                break;
+        }
+}
+
+
+static inline void ReceiveNetEvents() {
+	NetEvent net_event;
+	while (RingPop(net_channel->events, net_event)) {
+		ENetEvent& event = net_event.event;
+		if (event.type == ENET_EVENT_TYPE_CONNECT) peer_connect_ids[event.peer] = net_event.connect_id;
+
+		HandleEvent(event, net_event.address);
+
+		if (
+			event.type == ENET_EVENT_TYPE_DISCONNECT ||
+			event.type == ENET_EVENT_TYPE_DISCONNECT_TIMEOUT
+		) peer_connect_ids.erase(event.peer);
+	}
+}
+
+
+#pragma region DRAIN
+
+#pragma pack(push)
+#pragma pack()
+
+// Taking the server out of rotation (console "drain"): every shard refuses new
+// connections and closes its lobby, started games play out, and once the last
+// of them has ended every shard leaves its loop for main to exit
+
+std::atomic<size_t> drained_shards_count{0};
+std::atomic<bool> all_shards_drained{false};
+thread_local bool shard_drained = false;
+thread_local std::chrono::time_point<std::chrono::steady_clock> drain_shutdown_deadline;
+
+static inline void ReportDrainProgress() {
+	if (shard_drained) return;
+
+	std::cout
+	<< "Shard " << shard_index << ": draining, game still running with "
+	<< peer_to_player_id.size() << " players ("
+	<< drained_shards_count.load() << "/" << shard_count << " shards drained)"
+	<< std::endl;
+	ScheduleTimer(DRAIN_REPORT_INTERVAL_MS, ReportDrainProgress);
+}
+
+static inline void StartDraining() {
+	if (draining) return;
+	draining = true;
+
+	if (!game_started) return;
+	std::cout
+	<< "Shard " << shard_index << ": draining, waiting for the game with "
+	<< peer_to_player_id.size() << " players to end"
+	<< std::endl;
+	ScheduleTimer(DRAIN_REPORT_INTERVAL_MS, ReportDrainProgress);
+}
+
+// Once per loop iteration while draining
+static inline void UpdateDrain() {
+	if (shard_drained || game_started) return;
+
+	// Players still in the lobby haven't started a match to finish
+	if (!peer_to_player_id.empty()) {
+		std::cout << "Shard " << shard_index << ": closing lobby with " << peer_to_player_id.size() << " players" << std::endl;
+		ResetMatch();
+	}
+
+	shard_drained = true;
+	const size_t drained_count = ++drained_shards_count;
+	std::cout << "Shard " << shard_index << ": drained (" << drained_count << "/" << shard_count << " shards)" << std::endl;
+	if (drained_count < shard_count) return;
+
+	std::cout << "All matches ended, shutting down..." << std::endl;
+	all_shards_drained.store(true);
+}
+
+// Connections still open, or still sending what was queued before their
+// disconnect
+static inline size_t ConnectedPeerCount() {
+	return (net_channel == nullptr)
+		? server->connectedPeers
+		: net_channel->connected_peers.load(std::memory_order_relaxed);
+}
+
+// Once per loop iteration, after the flush phase; true once every shard has
+// drained and this one's lobby disconnects have gone out or timed out
+static inline bool ShardShutDown() {
+	if (!all_shards_drained.load(std::memory_order_relaxed)) return false;
+
+	if (drain_shutdown_deadline == decltype(drain_shutdown_deadline){}) {
+		drain_shutdown_deadline = loop_time + std::chrono::milliseconds(DRAIN_SHUTDOWN_TIMEOUT_MS);
+	}
+	return ConnectedPeerCount() == 0 || loop_time >= drain_shutdown_deadline;
+}
+
+#pragma pack(pop)
+
+#pragma endregion DRAIN
+
+#pragma region ADMIN_COMMANDS
+
+#pragma pack(push)
+#pragma pack()
+
+// Code outside a shard's loop (the --console thread, a future admin socket or
+// matchmaker) only affects its match by queueing one of these; the loop runs
+// them once per iteration, so they are picked up within a tick without any
+// match state being shared
+
+enum AdminCommandType : uint8_t {
+	ADMIN_KICK,
+	ADMIN_FORCE_START,
+	ADMIN_CHANGE_MAP, // Right away in the lobby, otherwise from the next match
+	ADMIN_DUMP_STATE,
+	ADMIN_DRAIN
+};
+
+typedef struct {
+	AdminCommandType type;
+	PlayerID player_id = 0; // ADMIN_KICK
+	std::shared_ptr<const MapInfo> map; // ADMIN_CHANGE_MAP
+} AdminCommand;
+
+std::vector<MPSCRing<AdminCommand, ADMIN_QUEUE_SIZE>*> admin_queues; // Per shard
+
+// Safe from any thread; false if the shard's queue is full
+static inline bool QueueAdminCommand(const size_t shard, const AdminCommand& command) {
+	return RingPush(*admin_queues[shard], command);
+}
+
+static inline void DumpMatchState() {
+	std::cout
+	<< "Shard " << shard_index << ": "
+	<< (match_over ? "match over" : (game_started ? "game started" : "lobby"))
+	<< ", " << peer_to_player_id.size() << " players, " << tick_tiers[tick_tier] << " Hz"
+	<< (draining ? (shard_drained ? ", drained" : ", draining") : "");
+	if (game_started) std::cout << ", seeker " << current_seeker_id;
+	std::cout
+	<< "\n  " << superseded_syncs_count << " over-quota PLAYER_SYNCs superseded, "
+	<< deferred_packets_count << " packets deferred";
+	for (auto const& [player_id, ss_player_data] : serverside_player_data) {
+		const PlayerState& player_state = player_states[player_id];
+		const char* name = players_stats[player_id].name;
+		std::cout
+		<< "\n  player " << player_id
+		<< " \"" << std::string(name, strnlen(name, MAX_NAME_LENGTH)) << "\""
+		<< (ss_player_data.ready ? " ready" : "")
+		<< ((player_state.player_state_flags & PlayerStateFlags::IS_SEEKER) ? " seeker" : "")
+		<< ((player_state.player_state_flags & PlayerStateFlags::ALIVE) ? " alive" : "")
+		<< " at (" << player_state.position.x
+		<< ", " << player_state.position.y
+		<< ", " << player_state.position.z << ")";
+	}
+	std::cout << std::endl;
+}
+
+static inline void RunAdminCommand(const AdminCommand& command) {
+	TickSectionScope section(SECTION_ADMIN);
+
+	switch (command.type) {
+		default: break;
+
+		case ADMIN_KICK:
+		{
+			auto player_peer = player_id_to_peer.find(command.player_id);
+			if (player_peer == player_id_to_peer.end()) {
+				std::cout << "Shard " << shard_index << ": no player " << command.player_id << std::endl;
+				break;
+			}
+
+			std::cout << "Shard " << shard_index << ": kicking player " << command.player_id << std::endl;
+			DisconnectPeerLater(player_peer->second);
+		}
+		break;
+
+		case ADMIN_FORCE_START:
+		{
+			if (game_started || match_over || peer_to_player_id.empty()) {
+				std::cout << "Shard " << shard_index << ": nothing to start" << std::endl;
+				break;
+			}
+
+			std::cout
+			<< "Shard " << shard_index << ": force-starting game with "
+			<< peer_to_player_id.size() << " players"
+			<< std::endl;
+			StartGame();
+		}
+		break;
+
+		case ADMIN_CHANGE_MAP:
+		{
+			if (game_started) {
+				// A single-shard server exits with its match
+				if (shard_count == 1) {
+					std::cout << "Game in progress; map not changed" << std::endl;
+					break;
+				}
+
+				next_match_map = command.map;
+				std::cout << "Shard " << shard_index << ": map changes from the next match" << std::endl;
+				break;
+			}
+
+			current_map = command.map;
+			for (auto const& [peer, player_id] : peer_to_player_id) SendMapData(peer, player_id);
+			std::cout << "Shard " << shard_index << ": map changed" << std::endl;
+		}
+		break;
+
+		case ADMIN_DUMP_STATE:
+			DumpMatchState();
+			break;
+
+		case ADMIN_DRAIN:
+			StartDraining();
+			break;
+	}
+}
+
+static inline void RunAdminCommands() {
+	AdminCommand command;
+	while (RingPop(*admin_queues[shard_index], command)) RunAdminCommand(command);
+}
+
+#pragma pack(pop)
+
+#pragma endregion ADMIN_COMMANDS
+
+#pragma region HOT_UPGRADE
+
+#pragma pack(push)
+#pragma pack()
+
+// A new build started with --take-over connects to the running server's
+// --upgrade-socket. The running server keeps serving until no connection has
+// anything in flight and no coroutine is pending, then sends its bound UDP
+// socket (SCM_RIGHTS) and the ENet and match state of every connection, and
+// exits without disconnecting anyone. Datagrams arriving meanwhile wait in the
+// socket for the new process. Single shard, socket I/O only
+
+typedef struct {
+	uint32_t version; // UPGRADE_STATE_VERSION
+	uint32_t peer_state_size; // Catches builds that lay the state out differently
+	uint8_t accepted; // Otherwise connections didn't settle in time and nothing follows
+	uint8_t game_started;
+	PlayerID next_player_id;
+	PlayerID current_seeker_id;
+	int64_t seeker_elapsed_ms;
+	int64_t next_tick_delay_us; // Keeps clients' tick cadence across the handover
+	uint16_t next_snapshot_sequence; // So acknowledgements in flight don't match the new process's snapshots
+	uint16_t peer_count;
+} UpgradeStateHeader;
+
+typedef struct {
+	ENetPeerSnapshot connection;
+	uint8_t is_player; // Sent PLAYER_SYNC; the fields below are only set then
+	PlayerID player_id;
+	PlayerState player_state;
+	uint8_t ready;
+	uint8_t was_seeker;
+	PlayerStats player_stats;
+	uint8_t snapshot_encoding;
+	uint8_t snapshots;
+} UpgradePeerState;
 
-                                std::vector<char> map_data_packet_data(sizeof(PacketType) + map_data.size());
-                                map_data_packet_data[0] = PacketType::CONTROL_MAP_DATA;
-                                memcpy(map_data_packet_data.data() + 1, map_data.c_str(), map_data.size());
-                                ENetPacket* map_data_packet = enet_packet_create(
-					map_data_packet_data.data(),
-					sizeof(PacketType) + map_data.size(),
-					ENET_PACKET_FLAG_RELIABLE
-				);
-				enet_peer_send(peer, 0, map_data_packet);
+typedef struct {
+	UpgradeStateHeader header;
+	std::vector<UpgradePeerState> peers;
+} TakenOverState;
+
+#pragma pack(pop)
+
+std::string upgrade_socket_path; // Empty when hot upgrades are off
+std::unique_ptr<TakenOverState> taken_over_state; // Set by main, applied by shard 0
+
+#ifdef __linux__
+thread_local int upgrade_listen_fd = -1;
+thread_local int upgrade_client_fd = -1; // New process waiting for the handover
+thread_local std::chrono::time_point<std::chrono::steady_clock> upgrade_deadline;
+
+static inline sockaddr_un UpgradeSocketAddress(const std::string& path) {
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) throw std::runtime_error("Upgrade socket path too long");
+	memcpy(address.sun_path, path.c_str(), path.size() + 1);
+	return address;
+}
 
-				#ifdef _HNS_DEBUG
-					_DEBUG_LOG
-					<< "Sending packet CONTROL_MAP_DATA to player "
-					<< player_id
-					<< std::endl;
-				#endif // _HNS_DEBUG
-                        }
+static inline bool SendAll(const int fd, const void* data, size_t length) {
+	for (const char* next = (const char*)data; length > 0;) {
+		const ssize_t sent = send(fd, next, length, MSG_NOSIGNAL);
+		if (sent <= 0) return false;
+		next += sent;
+		length -= sent;
+	}
+	return true;
+}
 
-                        const PlayerID player_id = peer_to_player_id[peer];
+static inline bool ReceiveAll(const int fd, void* data, size_t length) {
+	for (char* next = (char*)data; length > 0;) {
+		const ssize_t received = recv(fd, next, length, 0);
+		if (received <= 0) return false;
+		next += received;
+		length -= received;
+	}
+	return true;
+}
 
-			// TEMPORARY SERVER AUTHORITY FIX
-			uint8_t previous_player_state_flags = player_states[player_id].player_state_flags;
-                        player_states[player_id] = *((PlayerState*)(
-				packet->data + offsetof(PlayerSyncPacketData, player_state)
-			));
-			player_states[player_id].player_state_flags = (
-				(
-					player_states[player_id].player_state_flags &
-					~SERVER_AUTHORITY_PLAYER_STATE_FLAGS
-				) | (
-					previous_player_state_flags &
-					SERVER_AUTHORITY_PLAYER_STATE_FLAGS
-				)
-			);
+static inline void OnUpgradeConnection(const uint32_t) {
+	const int client_fd = accept4(upgrade_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+	if (client_fd < 0) return;
+	// The handover gives away the port and every connection: only to our own user
+	ucred credentials = {};
+	socklen_t credentials_size = sizeof(credentials);
+	if (
+		getsockopt(client_fd, SOL_SOCKET, SO_PEERCRED, &credentials, &credentials_size) < 0 ||
+		credentials.uid != geteuid()
+	) {
+		std::cout << "Upgrade refused: requested by another user (uid " << credentials.uid << ")" << std::endl;
+		close(client_fd);
+		return;
+	}
+	// One handover at a time
+	if (upgrade_client_fd >= 0) {
+		close(client_fd);
+		return;
+	}
 
-			// //PLAYER_SYNC
-			// #ifdef _HNS_DEBUG
-			// 	_DEBUG_LOG
-			// 	<< "Received packet PLAYER_SYNC from player "
-			// 	<< player_id
-			// 	<< " with data:"
-			// 	<< "\n- pos X: " << player_states[player_id].position.x
-			// 	<< "\n- pos Y: " << player_states[player_id].position.y
-			// 	<< "\n- pos Z: " << player_states[player_id].position.z
-			// 	<< "\n- yaw: " << player_states[player_id].yaw
-			// 	<< "\n- pitch: " << player_states[player_id].pitch
-			// 	<< "\n- flags:"
-			// 	<< "\n^ - ALIVE: " << ((player_states[player_id].player_state_flags & PlayerStateFlags::ALIVE) > 0)
-			// 	<< "\n^ - IS_SEEKER: " << ((player_states[player_id].player_state_flags & PlayerStateFlags::IS_SEEKER) > 0)
-			// 	<< "\n^ - JUMPED: " << ((player_states[player_id].player_state_flags & PlayerStateFlags::JUMPED) > 0)
-			// 	<< "\n^ - WALLJUMP: " << ((player_states[player_id].player_state_flags & PlayerStateFlags::JUMPED) > 0)
-			// 	<< "\n^ - SLIDING: " << ((player_states[player_id].player_state_flags & PlayerStateFlags::JUMPED) > 0)
-			// 	<< "\n^ - FLASHLIGHT: " << ((player_states[player_id].player_state_flags & PlayerStateFlags::JUMPED) > 0)
-			// 	<< "\n- hook_point X: " << player_states[player_id].hook_point.x
-			// 	<< "\n- hook_point Y: " << player_states[player_id].hook_point.y
-			// 	<< "\n- hook_point Z: " << player_states[player_id].hook_point.z
-			// 	<< std::endl;
-			// #endif // _HNS_DEBUG
+	upgrade_client_fd = client_fd;
+	upgrade_deadline = loop_time + std::chrono::milliseconds(UPGRADE_SETTLE_TIMEOUT_MS);
+	std::cout << "Upgrade requested, waiting for connections to settle" << std::endl;
+}
 
-			if (
-				player_states[player_id].position.y < 0.0 &&
-				std::chrono::duration<float>(
-					std::chrono::steady_clock::now() - round_transition_cooldown_timer
-				).count() > ROUND_TRANSITION_COOLDOWN
-			) {
-				#ifdef _HNS_DEBUG
-					_DEBUG_LOG
-					<< "Player "
-					<< player_id
-					<< "'s Y "
-					<< player_states[player_id].position.y
-					<< " is below 0.0"
-					<< std::endl;
-				#endif // _HNS_DEBUG
+static inline void ListenForUpgrades() {
+	const sockaddr_un address = UpgradeSocketAddress(upgrade_socket_path);
+	// Left behind by the server we took over from, or one that crashed
+	unlink(upgrade_socket_path.c_str());
 
-				if (
-					player_id != current_seeker_id &&
-					!(player_states[player_id].player_state_flags & PlayerStateFlags::IS_SEEKER) &&
-					player_states[player_id].player_state_flags & PlayerStateFlags::ALIVE
-				) {
-					#ifdef _HNS_DEBUG
-						_DEBUG_LOG
-						<< "Player below Y 0.0 is found to be a hider\n"
-						<< "^ sending PLAYER_HIDER_CAUGHT packet to self as seeker..."
-						<< std::endl;
-					#endif // _HNS_DEBUG
-
-					PlayerHiderCaughtPacketData phcp_data{};
-					phcp_data.caught_hider_id = player_id;
-					ENetPacket* hider_caught_packet = enet_packet_create(
-						&phcp_data,
-						sizeof(PlayerHiderCaughtPacketData),
-						ENET_PACKET_FLAG_RELIABLE
-					);
-					HandleHiderCaughtPacket(
-						player_id_to_peer[current_seeker_id],
-						hider_caught_packet
-					);
-					enet_packet_destroy(hider_caught_packet);
-				}
-				else if (
-					player_id == current_seeker_id ||
-					player_states[player_id].player_state_flags & PlayerStateFlags::IS_SEEKER //&&
-					//player_states[player_id].player_state_flags & PlayerStateFlags::ALIVE
-				) {
-					#ifdef _HNS_DEBUG
-						_DEBUG_LOG
-						<< "Player below Y 0.0 is found to be a seeker"
-						<< std::endl;
-					#endif // _HNS_DEBUG
-
-					player_states[player_id].position = seeker_spawn;
-					ControlSetPlayerStatePacketData cspsp_data{};
-					cspsp_data.state = player_states[player_id];
-					ENetPacket* set_state_packet = enet_packet_create(
-						&cspsp_data,
-						sizeof(ControlSetPlayerStatePacketData),
-						ENET_PACKET_FLAG_RELIABLE
-					);
-					enet_peer_send(player_id_to_peer[player_id], 0, set_state_packet);
-
-					#ifdef _HNS_DEBUG
-						_DEBUG_LOG
-						<< "Sending packet CONTROL_SET_PLAYER_STATE to "
-						<< player_id
-						<< " with data:"
-						<< "\n- packet type: " << std::to_string(cspsp_data.packet_type)
-						<< "\n- pos X (seeker spawn X): " << cspsp_data.state.position.x
-						<< "\n- pos Y (seeker spawn Y): " << cspsp_data.state.position.y
-						<< "\n- pos Z (seeker spawn Z): " << cspsp_data.state.position.z
-						<< "\n- yaw: " << cspsp_data.state.yaw
-						<< "\n- pitch: " << cspsp_data.state.pitch
-						<< "\n- flags:"
-						<< "\n^ - ALIVE: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::ALIVE) > 0)
-						<< "\n^ - IS_SEEKER: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::IS_SEEKER) > 0)
-						<< "\n^ - JUMPED: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-						<< "\n^ - WALLJUMP: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-						<< "\n^ - SLIDING: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-						<< "\n^ - FLASHLIGHT: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-						<< "\n- hook_point X: " << cspsp_data.state.hook_point.x
-						<< "\n- hook_point Y: " << cspsp_data.state.hook_point.y
-						<< "\n- hook_point Z: " << cspsp_data.state.hook_point.z
-						<< std::endl;
-					#endif // _HNS_DEBUG
-				}
-				else {
-					#ifdef _HNS_DEBUG
-						_DEBUG_LOG
-						<< "Player below Y 0.0 is found to be a spectator"
-						<< std::endl;
-					#endif // _HNS_DEBUG
-	
-					player_states[player_id].position = hider_spawn;
-					ControlSetPlayerStatePacketData cspsp_data{};
-					cspsp_data.state = player_states[player_id];
-					ENetPacket* set_state_packet = enet_packet_create(
-						&cspsp_data,
-						sizeof(ControlSetPlayerStatePacketData),
-						ENET_PACKET_FLAG_RELIABLE
-					);
-					enet_peer_send(player_id_to_peer[player_id], 0, set_state_packet);
-
-					#ifdef _HNS_DEBUG
-						_DEBUG_LOG
-						<< "Sending packet CONTROL_SET_PLAYER_STATE to "
-						<< player_id
-						<< " with data:"
-						<< "\n- packet type: " << std::to_string(cspsp_data.packet_type)
-						<< "\n- pos X (seeker spawn X): " << cspsp_data.state.position.x
-						<< "\n- pos Y (seeker spawn Y): " << cspsp_data.state.position.y
-						<< "\n- pos Z (seeker spawn Z): " << cspsp_data.state.position.z
-						<< "\n- yaw: " << cspsp_data.state.yaw
-						<< "\n- pitch: " << cspsp_data.state.pitch
-						<< "\n- flags:"
-						<< "\n^ - ALIVE: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::ALIVE) > 0)
-						<< "\n^ - IS_SEEKER: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::IS_SEEKER) > 0)
-						<< "\n^ - JUMPED: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-						<< "\n^ - WALLJUMP: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-						<< "\n^ - SLIDING: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-						<< "\n^ - FLASHLIGHT: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-						<< "\n- hook_point X: " << cspsp_data.state.hook_point.x
-						<< "\n- hook_point Y: " << cspsp_data.state.hook_point.y
-						<< "\n- hook_point Z: " << cspsp_data.state.hook_point.z
-						<< std::endl;
-					#endif // _HNS_DEBUG
-				}
-			}
+	upgrade_listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (
+		upgrade_listen_fd < 0 ||
+		bind(upgrade_listen_fd, (const sockaddr*)&address, sizeof(address)) < 0 ||
+		// Connecting takes write access; nobody can before listen()
+		chmod(upgrade_socket_path.c_str(), S_IRUSR | S_IWUSR) < 0 ||
+		listen(upgrade_listen_fd, 1) < 0 ||
+		!RegisterFd(upgrade_listen_fd, EPOLLIN, OnUpgradeConnection)
+	) throw std::runtime_error("Failed to listen on upgrade socket " + upgrade_socket_path);
+}
 
-                        ((PlayerSyncPacketData*)packet->data)->player_id = player_id;
-			((PlayerSyncPacketData*)packet->data)->player_state = player_states[player_id];
-                        // Retransmit sync packet to all other peers except the one who sent it
-                        for (auto const& [player_peer, _] : peer_to_player_id) {
-                                if (player_peer == peer) continue;
-                                enet_peer_send(
-                                        player_peer,
-                                        0,
-                                        enet_packet_create(
-                                                packet->data,
-                                                packet->dataLength,
-                                                0
-                                        )
-                                );
-                        }
+// Sends the socket along with the header
+static inline bool SendUpgradeState(const UpgradeStateHeader& header, const std::vector<UpgradePeerState>& peer_states) {
+	iovec header_buffer = {(void*)&header, sizeof(header)};
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+	msghdr message = {};
+	message.msg_iov = &header_buffer;
+	message.msg_iovlen = 1;
+	if (header.accepted) {
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+		cmsghdr* rights = CMSG_FIRSTHDR(&message);
+		rights->cmsg_level = SOL_SOCKET;
+		rights->cmsg_type = SCM_RIGHTS;
+		rights->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(rights), &server->socket, sizeof(int));
+	}
 
-			// #ifdef _HNS_DEBUG
-			// 	_DEBUG_LOG
-			// 	<< "Retransmitting the (possibly server-modified) sync packet"
-			// 	<< " to all other peers except the one who sent it..."
-			// 	<< std::endl;
-			// #endif // _HNS_DEBUG
-                }
-                break;
+	const ssize_t sent = sendmsg(upgrade_client_fd, &message, MSG_NOSIGNAL);
+	if (sent <= 0) return false;
+	return SendAll(upgrade_client_fd, (const char*)&header + sent, sizeof(header) - sent)
+		&& SendAll(upgrade_client_fd, peer_states.data(), peer_states.size() * sizeof(UpgradePeerState));
+}
 
-                case PacketType::PLAYER_SET_NAME:
-                {
-			if (peer_to_player_id.find(peer) == peer_to_player_id.end()) break;
-                        if (packet->dataLength < sizeof(PlayerSetNamePacketData)) {
-				#ifdef _HNS_DEBUG
-					_DEBUG_LOG
-					<< "Received packet PLAYER_SET_NAME size " << packet->dataLength
-					<< " is less than size of PlayerSetNamePacketData " << sizeof(PlayerSetNamePacketData)
-					<< std::endl;
-				#endif // _HNS_DEBUG
+// Hand over phase; must run right after a flush, with nothing serviced since
+static inline void TryHandOver() {
+	bool settled = (
+		!round_transitioning &&
+		!game_ending &&
+		next_tick_tasks.empty() &&
+		delivery_waits.empty() &&
+		deferred_receives_count == 0
+	);
 
-				break;
-			}
+	std::vector<UpgradePeerState> peer_states;
+	for (size_t slot = 0; settled && slot < server->peerCount; slot++) {
+		ENetPeer* peer = &server->peers[slot];
+		if (peer->state == ENET_PEER_STATE_DISCONNECTED) continue;
 
-                        memcpy(
-                                players_stats[peer_to_player_id[peer]].name,
-                                packet->data + offsetof(PlayerSetNamePacketData, name),
-                                MAX_NAME_LENGTH
-                        );
+		UpgradePeerState peer_state{};
+		if (enet_peer_snapshot(peer, &peer_state.connection) != 0) {
+			settled = false;
+			break;
+		}
 
-			#ifdef _HNS_DEBUG
-				_DEBUG_LOG
-				<< "Received packet PLAYER_SET_NAME with data: "
-				<< players_stats[peer_to_player_id[peer]].name
-				<< std::endl;
-			#endif // _HNS_DEBUG
-                }
-                break;
+		const auto player = peer_to_player_id.find(peer);
+		if (player != peer_to_player_id.end()) {
+			const PlayerID player_id = player->second;
+			peer_state.is_player = 1;
+			peer_state.player_id = player_id;
+			peer_state.player_state = player_states[player_id];
+			peer_state.ready = serverside_player_data[player_id].ready;
+			peer_state.was_seeker = serverside_player_data[player_id].was_seeker;
+			peer_state.player_stats = players_stats[player_id];
+			peer_state.snapshot_encoding = serverside_player_data[player_id].snapshot_encoding;
+			peer_state.snapshots = serverside_player_data[player_id].snapshots;
+		}
+		peer_states.push_back(peer_state);
+	}
+	if (!settled && loop_time < upgrade_deadline) return;
+
+	UpgradeStateHeader header{};
+	header.version = UPGRADE_STATE_VERSION;
+	header.peer_state_size = sizeof(UpgradePeerState);
+	header.accepted = settled;
+	if (settled) {
+		header.game_started = game_started;
+		header.next_player_id = _player_GUID;
+		header.current_seeker_id = current_seeker_id;
+		header.seeker_elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+			loop_time - current_seeker_timer
+		).count();
+		header.next_tick_delay_us = std::chrono::duration_cast<std::chrono::microseconds>(
+			next_tick_time - loop_time
+		).count();
+		header.next_snapshot_sequence = latest_snapshot_sequence + 1;
+		header.peer_count = peer_states.size();
+	} else peer_states.clear();
+
+	const bool sent = SendUpgradeState(header, peer_states);
+	close(upgrade_client_fd);
+	upgrade_client_fd = -1;
+
+	if (!settled) {
+		std::cout << "Upgrade refused: connections didn't settle within " << UPGRADE_SETTLE_TIMEOUT_MS << "ms" << std::endl;
+		return;
+	}
+	if (!sent) {
+		std::cout << "Upgrade failed: new process went away, carrying on" << std::endl;
+		return;
+	}
 
-                case PacketType::PLAYER_READY:
-                {
-			if (game_started) break;
-			if (peer_to_player_id.find(peer) == peer_to_player_id.end()) break;
-			if (serverside_player_data[peer_to_player_id[peer]].ready) break;
+	std::cout << "Handed over " << peer_states.size() << " connections, exiting" << std::endl;
+	exit(0);
+}
 
-                        const PlayerID player_id = peer_to_player_id[peer];
+// Returns the inherited socket; throws if the running server refused
+static ENetSocket TakeOver(const std::string& path) {
+	const sockaddr_un address = UpgradeSocketAddress(path);
+	const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0 || connect(fd, (const sockaddr*)&address, sizeof(address)) < 0) {
+		throw std::runtime_error("Failed to connect to upgrade socket " + path);
+	}
 
-			#ifdef _HNS_DEBUG
-				_DEBUG_LOG
-				<< "Received packet PLAYER_READY from player "
-				<< player_id
-				<< std::endl;
-			#endif // _HNS_DEBUG
+	taken_over_state = std::make_unique<TakenOverState>();
+	UpgradeStateHeader& header = taken_over_state->header;
+	iovec header_buffer = {&header, sizeof(header)};
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+	msghdr message = {};
+	message.msg_iov = &header_buffer;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+	const ssize_t received = recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+
+	ENetSocket inherited_socket = ENET_SOCKET_NULL;
+	const cmsghdr* rights = (received > 0) ? CMSG_FIRSTHDR(&message) : nullptr;
+	if (rights != nullptr && rights->cmsg_level == SOL_SOCKET && rights->cmsg_type == SCM_RIGHTS) {
+		memcpy(&inherited_socket, CMSG_DATA(rights), sizeof(int));
+	}
 
-                        serverside_player_data[player_id].ready = true;
+	if (received <= 0 || !ReceiveAll(fd, (char*)&header + received, sizeof(header) - received)) {
+		throw std::runtime_error("Running server closed the upgrade socket");
+	}
+	if (header.version != UPGRADE_STATE_VERSION || header.peer_state_size != sizeof(UpgradePeerState)) {
+		throw std::runtime_error("Running server's state is incompatible with this build");
+	}
+	if (!header.accepted) throw std::runtime_error("Running server refused the upgrade, its connections didn't settle");
+	if (inherited_socket == ENET_SOCKET_NULL) throw std::runtime_error("Running server sent no socket");
 
-                        int ready_players = 0;
-			for (auto const& [_, ss_player_data] : serverside_player_data) {
-				if (ss_player_data.ready) ready_players++;
-			}
-			#ifdef _HNS_DEBUG
-				_DEBUG_LOG
-				<< "ready_players == "
-				<< ready_players
-				<< std::endl;
-			#endif // _HNS_DEBUG
-			if (ready_players != peer_to_player_id.size()) break;
+	taken_over_state->peers.resize(header.peer_count);
+	if (!ReceiveAll(fd, taken_over_state->peers.data(), header.peer_count * sizeof(UpgradePeerState))) {
+		throw std::runtime_error("Running server closed the upgrade socket");
+	}
+	close(fd);
+	return inherited_socket;
+}
 
-                        // Everyone is ready; start game
+static inline void RestoreTakenOverState() {
+	const UpgradeStateHeader& header = taken_over_state->header;
+	game_started = header.game_started;
+	_player_GUID = header.next_player_id;
+	current_seeker_id = header.current_seeker_id;
+	current_seeker_timer = loop_time - std::chrono::milliseconds(header.seeker_elapsed_ms);
+	next_tick_time = loop_time + std::chrono::microseconds(std::max<int64_t>(header.next_tick_delay_us, 0));
+	latest_snapshot_sequence = header.next_snapshot_sequence;
+
+	size_t player_count = 0;
+	for (const UpgradePeerState& peer_state : taken_over_state->peers) {
+		if (!peer_state.is_player) continue;
+
+		ENetPeer* peer = &server->peers[peer_state.connection.incomingPeerID];
+		const PlayerID player_id = peer_state.player_id;
+		peer_to_player_id[peer] = player_id;
+		player_id_to_peer[player_id] = peer;
+		player_states[player_id] = peer_state.player_state;
+		ServerPlayerData ss_player_data{};
+		ss_player_data.ready = peer_state.ready;
+		ss_player_data.was_seeker = peer_state.was_seeker;
+		ss_player_data.snapshot_encoding = peer_state.snapshot_encoding;
+		ss_player_data.snapshots = peer_state.snapshots;
+		serverside_player_data[player_id] = ss_player_data;
+		players_stats[player_id] = peer_state.player_stats;
+		player_count++;
+	}
 
-			#ifdef _HNS_DEBUG
-				_DEBUG_LOG
-				<< "Everyone is ready; starting game..."
-				<< std::endl;
-			#endif // _HNS_DEBUG
+	std::cout
+	<< "Took over " << taken_over_state->peers.size() << " connections ("
+	<< player_count << " players" << (game_started ? ", game started" : "") << ")"
+	<< std::endl;
+	taken_over_state.reset();
+}
+#endif // __linux__
 
-			current_seeker_id = peer_to_player_id.begin()->second;
+#pragma endregion HOT_UPGRADE
 
-			#ifdef _HNS_DEBUG
-				_DEBUG_LOG
-				<< "First chosen seeker id: "
-				<< current_seeker_id
-				<< std::endl;
-			#endif // _HNS_DEBUG
 
-			{
-                        player_states[current_seeker_id].player_state_flags |= PlayerStateFlags::IS_SEEKER;
-                        player_states[current_seeker_id].player_state_flags |= PlayerStateFlags::ALIVE;
-                        player_states[current_seeker_id].position = seeker_spawn;
-                        ControlSetPlayerStatePacketData cspsp_data{};
-                        cspsp_data.state = player_states[current_seeker_id];
-                        ENetPacket* set_state_packet = enet_packet_create(
-                                &cspsp_data,
-                                sizeof(ControlSetPlayerStatePacketData),
-                                ENET_PACKET_FLAG_RELIABLE
-                        );
-                        enet_peer_send(player_id_to_peer[current_seeker_id], 0, set_state_packet);
+static inline void ServeShard(const size_t index) {
+	shard_index = index;
+	server = shard_hosts[index];
+	if (use_net_thread) net_channel = net_channels[index];
+	ConfigureThreadScheduling(
+		use_net_thread ? index * 2 : index,
+		"shard " + std::to_string(index) + " game thread"
+	);
 
-			#ifdef _HNS_DEBUG
-				_DEBUG_LOG
-				<< "Sending packet CONTROL_SET_PLAYER_STATE to seeker player "
-				<< current_seeker_id
-				<< " with data:"
-				<< "\n- packet type: " << std::to_string(cspsp_data.packet_type)
-				<< "\n- pos X (seeker spawn X): " << cspsp_data.state.position.x
-				<< "\n- pos Y (seeker spawn Y): " << cspsp_data.state.position.y
-				<< "\n- pos Z (seeker spawn Z): " << cspsp_data.state.position.z
-				<< "\n- yaw: " << cspsp_data.state.yaw
-				<< "\n- pitch: " << cspsp_data.state.pitch
-				<< "\n- flags:"
-				<< "\n^ - ALIVE: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::ALIVE) > 0)
-				<< "\n^ - IS_SEEKER: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::IS_SEEKER) > 0)
-				<< "\n^ - JUMPED: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-				<< "\n^ - WALLJUMP: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-				<< "\n^ - SLIDING: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-				<< "\n^ - FLASHLIGHT: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-				<< "\n- hook_point X: " << cspsp_data.state.hook_point.x
-				<< "\n- hook_point Y: " << cspsp_data.state.hook_point.y
-				<< "\n- hook_point Z: " << cspsp_data.state.hook_point.z
-				<< std::endl;
-			#endif // _HNS_DEBUG
+        ENetEvent event;
+	current_map = startup_map;
+	#ifdef __linux__
+	InitEventLoop(use_net_thread ? net_channel->game_wake_fd : enet_host_get_wait_socket(server));
+	if (!upgrade_socket_path.empty()) ListenForUpgrades();
+	#endif
+	InitTimerWheel();
+	if (latency_stats) ScheduleTimer(LATENCY_REPORT_INTERVAL_MS, ReportLatencyStats);
+	if (tick_budget.count() > 0) ScheduleTimer(TICK_BUDGET_REPORT_INTERVAL_MS, ReportTickBudget);
+	if (flush_stats) ScheduleTimer(FLUSH_STATS_INTERVAL_MS, ReportFlushStats);
+	SetTickTier(0);
+	loop_time = server_start_time;
+	tier_window_start = std::chrono::steady_clock::now();
+	next_tick_time = server_start_time + tick_interval;
+	#ifdef __linux__
+	if (taken_over_state != nullptr) RestoreTakenOverState();
+	#endif
+        for (;;) {
+		EndIterationWatch();
+		if (tick_tiers.size() > 1) UpdateTickTier();
+
+		if (net_channel != nullptr) {
+			// Receive phase
+			if (busy_poll) {
+				std::this_thread::yield();
+				PollFds();
+			} else WaitForNetEvents(NextServiceTimeout());
+			loop_time = std::chrono::steady_clock::now();
+			if (tick_budget.count() > 0) StartIterationWatch();
+			StartFairDrain();
+			ReceiveNetEvents();
+			FinishFairDrain();
+		} else {
+			// Receive phase
+
+			// _HNS_POLL_LOOP: legacy fixed 1ms sleep + zero-timeout polling;
+			// otherwise block until a packet arrives or work is due, in the
+			// epoll set on Linux, in ENet's socket wait elsewhere
+			#if defined(_HNS_POLL_LOOP)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			PollFds();
+			int service_result = enet_host_service(server, &event, 0);
+			#elif defined(__linux__)
+			if (busy_poll) {
+				std::this_thread::yield();
+				PollFds();
+			} else WaitForEvents(NextServiceTimeout());
+			int service_result = enet_host_service(server, &event, 0);
+			#else
+			if (busy_poll) std::this_thread::yield();
+			int service_result = enet_host_service(server, &event, busy_poll ? 0 : NextServiceTimeout());
+			#endif // _HNS_POLL_LOOP
+
+			loop_time = std::chrono::steady_clock::now();
+			if (tick_budget.count() > 0) StartIterationWatch();
+			StartFairDrain();
+
+			// Only dispatch what that service call already received; servicing
+			// again would send whatever the handlers queued so far
+			for (
+				;
+				service_result > 0;
+				service_result = enet_host_check_events(server, &event)
+			) {
+				HandleEvent(event, event.peer->address);
 			}
+			FinishFairDrain();
+		}
 
-			for (auto& [_player_id, player_state] : player_states) {
-                                if (_player_id == current_seeker_id) continue;
-
-				player_state.player_state_flags &= ~PlayerStateFlags::IS_SEEKER;
-                                player_state.player_state_flags |= PlayerStateFlags::ALIVE;
-                                player_state.position = hider_spawn;
-                                ControlSetPlayerStatePacketData cspsp_data{};
-                                cspsp_data.state = player_state;
-                                ENetPacket* set_state_packet = enet_packet_create(
-                                        &cspsp_data,
-                                        sizeof(ControlSetPlayerStatePacketData),
-                                        ENET_PACKET_FLAG_RELIABLE
-                                );
-                                enet_peer_send(player_id_to_peer[_player_id], 0, set_state_packet);
-
-				#ifdef _HNS_DEBUG
-					_DEBUG_LOG
-					<< "Sending packet CONTROL_SET_PLAYER_STATE to player "
-					<< _player_id
-					<< " with data:"
-					<< "\n- packet type: " << std::to_string(cspsp_data.packet_type)
-					<< "\n- pos X (seeker spawn X): " << cspsp_data.state.position.x
-					<< "\n- pos Y (seeker spawn Y): " << cspsp_data.state.position.y
-					<< "\n- pos Z (seeker spawn Z): " << cspsp_data.state.position.z
-					<< "\n- yaw: " << cspsp_data.state.yaw
-					<< "\n- pitch: " << cspsp_data.state.pitch
-					<< "\n- flags:"
-					<< "\n^ - ALIVE: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::ALIVE) > 0)
-					<< "\n^ - IS_SEEKER: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::IS_SEEKER) > 0)
-					<< "\n^ - JUMPED: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-					<< "\n^ - WALLJUMP: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-					<< "\n^ - SLIDING: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-					<< "\n^ - FLASHLIGHT: " << ((cspsp_data.state.player_state_flags & PlayerStateFlags::JUMPED) > 0)
-					<< "\n- hook_point X: " << cspsp_data.state.hook_point.x
-					<< "\n- hook_point Y: " << cspsp_data.state.hook_point.y
-					<< "\n- hook_point Z: " << cspsp_data.state.hook_point.z
-					<< std::endl;
-				#endif // _HNS_DEBUG
-                        }
+		RunAdminCommands();
+		{
+		TickSectionScope section(SECTION_FD_CALLBACKS);
+		RunFdCallbacks();
+		}
+		ResumeDeliveredTasks();
+		if (match_over) ResetMatch();
+		if (draining) UpdateDrain();
+
+		// Timers phase
+		{
+		TickSectionScope section(SECTION_TIMERS);
+		AdvanceTimers(LoopTimeMs());
+		}
+		if (match_over) ResetMatch();
+
+		// A tick with nobody to relay to or simulate does nothing, so an empty
+		// shard skips them and only wakes for packets and timers; ticks start
+		// again from the iteration the first player joins in
+		const bool was_ticks_idle = ticks_idle;
+		ticks_idle = peer_to_player_id.empty() && next_tick_tasks.empty();
+		if (was_ticks_idle && !ticks_idle) next_tick_time = loop_time;
+
+		if (!ticks_idle && loop_time >= next_tick_time) {
+			// Simulate phase
+			ResumeNextTickTasks();
+			SimulateTick();
+			#ifdef _HNS_SLOW_TICK_MS
+			// Benchmarks only: a tick as slow as a heavy match's
+			std::this_thread::sleep_for(std::chrono::milliseconds(_HNS_SLOW_TICK_MS));
+			#endif // _HNS_SLOW_TICK_MS
+			if (match_over) ResetMatch();
+
+			// Broadcast phase
+			BroadcastTick();
+
+			next_tick_time += tick_interval;
+			tier_ticks++;
+			ticks_count++;
+			// Don't try to catch up on ticks missed while stalled
+			if (next_tick_time < loop_time) {
+				next_tick_time = loop_time + tick_interval;
+				tier_late_ticks++;
+			}
+		}
 
-			current_seeker_timer = std::chrono::steady_clock::now();
-			game_started = true;
+		// Flush phase: everything this iteration queued (handler replies,
+		// relays, ACKs) goes out in one burst, packed into as few datagrams
+		// per peer as fit
+		FlushPackets();
 
-			ENetPacket* game_start_packet = enet_packet_create(
-                                std::array<char, 1>{PacketType::CONTROL_GAME_START}.data(),
-				sizeof(PacketType),
-				ENET_PACKET_FLAG_RELIABLE
-			);
-			enet_host_broadcast(server, 0, game_start_packet);
+		#ifdef __linux__
+		if (upgrade_client_fd >= 0) TryHandOver();
+		#endif
 
-			#ifdef _HNS_DEBUG
-				_DEBUG_LOG
-				<< "Broadcasting packet CONTROL_GAME_START..."
-				<< std::endl;
-			#endif // _HNS_DEBUG
-                }
-                break;
+		if (ShardShutDown()) break;
         }
 
-        enet_packet_destroy(packet);
+	// Sends whatever the last flush left queued
+	if (net_channel != nullptr) StopNetThread(net_channel);
+	else enet_host_flush(server);
 }
 
-
-int main(int argc, char* argv[]) {
+static void ServeShardThread(const size_t index) {
 try {
-        if (argc < 2) {
-		std::cout << "USAGE: <PATH/TO/MAP.json> [PORT]" << std::endl;
-		return 0;
-	}
-
-	std::string map_path = argv[1];
-	int port = (argc >= 3) ? std::stoi(argv[2]) : DEFAULT_PORT;
+	ServeShard(index);
+} catch (const std::exception& e) {
+	std::cout << "ERROR: " << e.what() << std::endl;
+	exit(1);
+}
+}
 
-	#ifdef _HNS_DEBUG
-		std::cout << "RUNNING DEBUG BUILD; PERFORMANCE WILL BE LOWER" << std::endl;
-		std::cout.rdbuf(_DEBUG_LOG.rdbuf());
-		std::time_t start_time = std::time(nullptr);
-		_DEBUG_LOG << std::asctime(std::localtime(&start_time)) << std::endl;
-	#endif // _HNS_DEBUG
 
-	#ifdef _HNS_DEBUG
-		_DEBUG_LOG << "map_path: " << map_path << std::endl;
-		_DEBUG_LOG << "port: " << port << std::endl;
-	#endif // _HNS_DEBUG
+// Throws on unreadable or invalid maps
+static inline bool IsJsonVec3(const nlohmann::json& value) {
+	return value.is_array() && value.size() == 3 &&
+		value[0].is_number() && value[1].is_number() && value[2].is_number();
+}
 
-        // Map loading, parsing, validation, & compression
+static std::shared_ptr<const MapInfo> LoadMap(const std::string& map_path) {
+	MapInfo map{};
+	std::string& map_data = map.data;
 
 	std::ifstream map_file_stream(map_path);
+	if (!map_file_stream) throw std::runtime_error("Failed to open map " + map_path);
 	map_file_stream.seekg(0, std::ios::end);
 	map_data.reserve(map_file_stream.tellg());
 	map_file_stream.seekg(0, std::ios::beg);
@@ -983,6 +3975,7 @@ try {
 	std::string map_errors("");
 	bool hider_spawn_found = false;
 	bool seeker_spawn_found = false;
+	bool bounds_found = false;
 	nlohmann::json _map_data = nlohmann::json::parse(map_data);
 	if (!_map_data.is_array()) throw std::runtime_error(
 		std::string("Map ") + map_path + " root is not JSON array"
@@ -1022,19 +4015,41 @@ try {
 			continue;
 		}
 
+		// However it's rotated, an object stays within its scale's length of its position
+		if (IsJsonVec3((*map_obj)["pos"]) && IsJsonVec3((*map_obj)["scale"])) {
+			Vec3 position{
+				(*map_obj)["pos"][0].get<float>(),
+				(*map_obj)["pos"][1].get<float>(),
+				(*map_obj)["pos"][2].get<float>()
+			};
+			const float extent = std::sqrt(
+				(*map_obj)["scale"][0].get<float>() * (*map_obj)["scale"][0].get<float>() +
+				(*map_obj)["scale"][1].get<float>() * (*map_obj)["scale"][1].get<float>() +
+				(*map_obj)["scale"][2].get<float>() * (*map_obj)["scale"][2].get<float>()
+			);
+			if (!bounds_found) map.bounds_min = map.bounds_max = position;
+			bounds_found = true;
+			map.bounds_min.x = std::min(map.bounds_min.x, position.x - extent);
+			map.bounds_min.y = std::min(map.bounds_min.y, position.y - extent);
+			map.bounds_min.z = std::min(map.bounds_min.z, position.z - extent);
+			map.bounds_max.x = std::max(map.bounds_max.x, position.x + extent);
+			map.bounds_max.y = std::max(map.bounds_max.y, position.y + extent);
+			map.bounds_max.z = std::max(map.bounds_max.z, position.z + extent);
+		}
+
 		if ((*map_obj)["type"].get<std::string>().rfind("Spawn_Hider", 0) == 0) {
 			hider_spawn_found = true;
 
-			hider_spawn.x = (*map_obj)["pos"][0].get<float>();
-			hider_spawn.y = (*map_obj)["pos"][1].get<float>();
-			hider_spawn.z = (*map_obj)["pos"][2].get<float>();
+			map.hider_spawn.x = (*map_obj)["pos"][0].get<float>();
+			map.hider_spawn.y = (*map_obj)["pos"][1].get<float>();
+			map.hider_spawn.z = (*map_obj)["pos"][2].get<float>();
 		}
 		else if ((*map_obj)["type"].get<std::string>().rfind("Spawn_Seeker", 0) == 0) {
 			seeker_spawn_found = true;
 
-			seeker_spawn.x = (*map_obj)["pos"][0].get<float>();
-			seeker_spawn.y = (*map_obj)["pos"][1].get<float>();
-			seeker_spawn.z = (*map_obj)["pos"][2].get<float>();
+			map.seeker_spawn.x = (*map_obj)["pos"][0].get<float>();
+			map.seeker_spawn.y = (*map_obj)["pos"][1].get<float>();
+			map.seeker_spawn.z = (*map_obj)["pos"][2].get<float>();
 		}
 	}
 	if (!hider_spawn_found) {
@@ -1049,6 +4064,21 @@ try {
 		std::string("Map ") + map_path + " has errors:\n"
 		+ map_errors
 	);
+	// No object had a usable position and scale: the spawns are all there is
+	if (!bounds_found) {
+		map.bounds_min.x = std::min(map.hider_spawn.x, map.seeker_spawn.x);
+		map.bounds_min.y = std::min(map.hider_spawn.y, map.seeker_spawn.y);
+		map.bounds_min.z = std::min(map.hider_spawn.z, map.seeker_spawn.z);
+		map.bounds_max.x = std::max(map.hider_spawn.x, map.seeker_spawn.x);
+		map.bounds_max.y = std::max(map.hider_spawn.y, map.seeker_spawn.y);
+		map.bounds_max.z = std::max(map.hider_spawn.z, map.seeker_spawn.z);
+	}
+	map.bounds_min.x -= QUANTIZED_BOUNDS_MARGIN;
+	map.bounds_min.y -= QUANTIZED_BOUNDS_MARGIN;
+	map.bounds_min.z -= QUANTIZED_BOUNDS_MARGIN;
+	map.bounds_max.x += QUANTIZED_BOUNDS_MARGIN;
+	map.bounds_max.y += QUANTIZED_BOUNDS_MARGIN;
+	map.bounds_max.z += QUANTIZED_BOUNDS_MARGIN;
 
 	map_data.erase(std::remove_if(map_data.begin(), map_data.end(), []
 	(unsigned char c){
@@ -1063,6 +4093,203 @@ try {
 	_DEBUG_LOG << "compressed map_data: \n'''\n" << map_data << "\n'''\n" << std::endl;
 #endif // _HNS_DEBUG
 
+	return std::make_shared<const MapInfo>(std::move(map));
+}
+
+
+// --console: admin commands from stdin, one per line
+static void ConsoleThreadMain() {
+	std::string line;
+	while (std::getline(std::cin, line)) {
+		std::istringstream words(line);
+		std::string command_name;
+		if (!(words >> command_name)) continue;
+
+		AdminCommand command{};
+		size_t shard = 0;
+		std::vector<size_t> shards;
+		if (command_name == "kick" && (words >> command.player_id)) {
+			command.type = ADMIN_KICK;
+			words >> shard;
+			shards.push_back(shard);
+		}
+		else if (command_name == "start") {
+			command.type = ADMIN_FORCE_START;
+			words >> shard;
+			shards.push_back(shard);
+		}
+		else if (command_name == "dump") {
+			command.type = ADMIN_DUMP_STATE;
+			if (words >> shard) shards.push_back(shard);
+			else for (size_t i = 0; i < shard_count; i++) shards.push_back(i);
+		}
+		else if (command_name == "drain") {
+			command.type = ADMIN_DRAIN;
+			for (size_t i = 0; i < shard_count; i++) shards.push_back(i);
+		}
+		else if (command_name == "map") {
+			std::string map_path;
+			std::getline(words >> std::ws, map_path);
+			try {
+				command.map = LoadMap(map_path);
+			} catch (const std::exception& e) {
+				std::cout << "ERROR: " << e.what() << std::endl;
+				continue;
+			}
+			command.type = ADMIN_CHANGE_MAP;
+			for (size_t i = 0; i < shard_count; i++) shards.push_back(i);
+		}
+		else {
+			std::cout
+			<< "COMMANDS:\n"
+			<< "  kick PLAYER [SHARD]  Disconnect a player\n"
+			<< "  start [SHARD]  Start the game without waiting for everyone to be ready\n"
+			<< "  map PATH  Switch every shard to another map (lobbies now, started games from their next match)\n"
+			<< "  dump [SHARD]  Print match state\n"
+			<< "  drain  Refuse new players and close lobbies, then exit once every started game has ended"
+			<< std::endl;
+			continue;
+		}
+
+		for (const size_t target_shard : shards) {
+			if (target_shard >= shard_count) std::cout << "No shard " << target_shard << std::endl;
+			else if (!QueueAdminCommand(target_shard, command)) std::cout << "Shard " << target_shard << " command queue full" << std::endl;
+		}
+	}
+}
+
+
+// Tests and benchmarks include this file for its internals and bring their own
+#ifndef _HNS_NO_MAIN
+int main(int argc, char* argv[]) {
+try {
+	std::vector<std::string> positional_args;
+	bool use_io_uring = false;
+	std::string xdp_interface;
+	uint32_t xdp_queue = 0;
+	bool console = false;
+	bool take_over = false;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "--io-uring") use_io_uring = true;
+		else if (arg == "--shards" && i + 1 < argc) shard_count = std::stoul(argv[++i]);
+		else if (arg == "--net-thread") use_net_thread = true;
+		else if (arg == "--busy-poll") busy_poll = true;
+		else if (arg == "--pin-cpus" && i + 1 < argc) {
+			const std::string cpu_list = argv[++i];
+			for (size_t start = 0; start <= cpu_list.size();) {
+				size_t end = cpu_list.find(',', start);
+				if (end == std::string::npos) end = cpu_list.size();
+				pinned_cpus.push_back(std::stoi(cpu_list.substr(start, end - start)));
+				start = end + 1;
+			}
+		}
+		else if (arg == "--sched-fifo") use_sched_fifo = true;
+		else if (arg == "--latency-stats") latency_stats = true;
+		else if (arg == "--xdp" && i + 1 < argc) {
+			xdp_interface = argv[++i];
+			const size_t queue_separator = xdp_interface.find(':');
+			if (queue_separator != std::string::npos) {
+				xdp_queue = std::stoul(xdp_interface.substr(queue_separator + 1));
+				xdp_interface.resize(queue_separator);
+			}
+		}
+		else if (arg == "--console") console = true;
+		else if (arg == "--flush-stats") flush_stats = true;
+		else if (arg == "--upgrade-socket" && i + 1 < argc) upgrade_socket_path = argv[++i];
+		else if (arg == "--take-over" && i + 1 < argc) {
+			take_over = true;
+			upgrade_socket_path = argv[++i];
+		}
+		else if (arg == "--peer-quota" && i + 1 < argc) peer_event_quota = std::stoul(argv[++i]);
+		else if (arg == "--tick-budget" && i + 1 < argc) tick_budget = std::chrono::microseconds(std::stoul(argv[++i]));
+		else if (arg == "--tick-tiers" && i + 1 < argc) {
+			const std::string tier_list = argv[++i];
+			for (size_t start = 0; start <= tier_list.size();) {
+				size_t end = tier_list.find(',', start);
+				if (end == std::string::npos) end = tier_list.size();
+				tick_tiers.push_back(std::stoi(tier_list.substr(start, end - start)));
+				start = end + 1;
+			}
+		}
+		else if (arg.rfind("--", 0) == 0) throw std::runtime_error("Unknown option " + arg);
+		else positional_args.push_back(arg);
+	}
+
+        if (positional_args.empty()) {
+		std::cout
+		<< "USAGE: <PATH/TO/MAP.json> [PORT] [TICK_RATE] [OPTIONS]\n"
+		<< "OPTIONS:\n"
+		<< "  --io-uring  Use the io_uring transport (falls back to sockets if unavailable)\n"
+		<< "  --shards N  Serve N independent matches from N threads sharing PORT (SO_REUSEPORT)\n"
+		<< "  --net-thread  Service ENet on a dedicated thread per shard, apart from game logic\n"
+		<< "  --busy-poll  Spin on the sockets instead of sleeping between packets (SO_BUSY_POLL where supported)\n"
+		<< "  --pin-cpus A,B,...  Pin game (and net) threads to these CPUs, in shard order\n"
+		<< "  --sched-fifo  Request SCHED_FIFO real-time scheduling for game and net threads\n"
+		<< "  --latency-stats  Print socket queueing and handler-to-relay latency histograms every "
+		<< LATENCY_REPORT_INTERVAL_MS / 1000 << "s\n"
+		<< "  --xdp IFACE[:QUEUE]  Receive/send unreliable IPv4 traffic through AF_XDP on IFACE (generic mode)\n"
+		<< "  --console  Read admin commands (kick, start, map, dump, drain) from stdin\n"
+		<< "  --tick-tiers R1,R2,...  Lower tick rates each shard steps down to (and back up from) when overloaded\n"
+		<< "  --tick-budget USEC  Time every loop iteration against USEC, trace overruns and report every "
+		<< TICK_BUDGET_REPORT_INTERVAL_MS / 1000 << "s\n"
+		<< "  --flush-stats  Print datagrams per peer, header bytes saved by send coalescing and syscalls per tick every "
+		<< FLUSH_STATS_INTERVAL_MS / 1000 << "s\n"
+		<< "  --peer-quota N  Packets handled per peer per loop iteration before the rest are coalesced or deferred (default "
+		<< DEFAULT_PEER_EVENT_QUOTA << ", 0 for no limit)\n"
+		<< "  --upgrade-socket PATH  Let a new build take over the port, connections and match through this UNIX socket\n"
+		<< "  --take-over PATH  Take over from the server listening on upgrade socket PATH (PORT is ignored), then listen on it"
+		<< std::endl;
+		return 0;
+	}
+
+	std::string map_path = positional_args[0];
+	int port = (positional_args.size() >= 2) ? std::stoi(positional_args[1]) : DEFAULT_PORT;
+	tick_rate = (positional_args.size() >= 3) ? std::stoi(positional_args[2]) : DEFAULT_TICK_RATE;
+	if (tick_rate <= 0) throw std::runtime_error("Tick rate must be positive");
+	if (shard_count == 0) throw std::runtime_error("Shard count must be positive");
+	// One XDP program per interface, so one host
+	if (!xdp_interface.empty() && (shard_count > 1 || use_io_uring)) throw std::runtime_error("--xdp cannot be combined with --shards or --io-uring");
+	#ifndef __linux__
+	if (!pinned_cpus.empty() || use_sched_fifo) throw std::runtime_error("--pin-cpus and --sched-fifo are only supported on Linux");
+	#endif
+	tick_tiers.insert(tick_tiers.begin(), tick_rate);
+	std::sort(tick_tiers.begin() + 1, tick_tiers.end(), std::greater<int>());
+	for (size_t i = 1; i < tick_tiers.size(); i++) {
+		if (tick_tiers[i] <= 0 || tick_tiers[i] >= tick_tiers[i - 1]) throw std::runtime_error("Tick tiers must be positive, distinct and below TICK_RATE");
+	}
+	if (!upgrade_socket_path.empty()) {
+		#ifndef __linux__
+		throw std::runtime_error("--upgrade-socket and --take-over are only supported on Linux");
+		#endif
+		// Only one plain socket's worth of state is handed over
+		if (shard_count > 1 || use_net_thread || use_io_uring || !xdp_interface.empty()) throw std::runtime_error(
+			"--upgrade-socket and --take-over cannot be combined with --shards, --net-thread, --io-uring or --xdp"
+		);
+	}
+	// The loop never idles, so its load can't be measured
+	if (tick_tiers.size() > 1 && busy_poll) throw std::runtime_error("--tick-tiers cannot be combined with --busy-poll");
+
+	#ifdef _HNS_DEBUG
+		std::cout << "RUNNING DEBUG BUILD; PERFORMANCE WILL BE LOWER" << std::endl;
+		// _DEBUG_LOG is shared and unsynchronized
+		if (shard_count > 1) throw std::runtime_error("Debug builds only support a single shard");
+		if (console) throw std::runtime_error("Debug builds don't support --console");
+		std::cout.rdbuf(_DEBUG_LOG.rdbuf());
+		std::time_t start_time = std::time(nullptr);
+		_DEBUG_LOG << std::asctime(std::localtime(&start_time)) << std::endl;
+	#endif // _HNS_DEBUG
+
+	#ifdef _HNS_DEBUG
+		_DEBUG_LOG << "map_path: " << map_path << std::endl;
+		_DEBUG_LOG << "port: " << port << std::endl;
+		_DEBUG_LOG << "tick_rate: " << tick_rate << std::endl;
+		_DEBUG_LOG << "shard_count: " << shard_count << std::endl;
+	#endif // _HNS_DEBUG
+
+        // Map loading, parsing, validation, & compression
+	startup_map = LoadMap(map_path);
+
         // Networking
 
 	if (enet_initialize() != 0) throw std::runtime_error("Failed to initialize ENet");
@@ -1071,11 +4298,71 @@ try {
 	ENetAddress address = {0};
 	address.host = ENET_HOST_ANY;
 	address.port = port;
-	server = enet_host_create(&address, MAX_PLAYERS, 1, 0, 0);
-	if (server == nullptr) throw std::runtime_error("Failed to create ENet server");
-	atexit([]{enet_host_destroy(server);});
+	bool io_uring_unavailable = false;
+	bool busy_poll_socket_failed = false;
+	bool timestamps_unavailable = false;
+	bool xdp_unavailable = false;
+	for (size_t i = 0; i < shard_count; i++) {
+		ENetHost* host;
+		#ifdef __linux__
+		if (take_over) {
+			host = enet_host_create_from_socket(TakeOver(upgrade_socket_path), MAX_PLAYERS, 1, 0, 0);
+			if (host == nullptr) throw std::runtime_error("Failed to create ENet server");
+			for (const UpgradePeerState& peer_state : taken_over_state->peers) {
+				if (enet_host_restore_peer(host, &peer_state.connection) == nullptr) throw std::runtime_error("Failed to restore a connection");
+			}
+			port = host->address.port;
+		} else
+		#endif
+		host = (shard_count > 1)
+			? enet_host_create_reuseport(&address, MAX_PLAYERS, 1, 0, 0)
+			: enet_host_create(&address, MAX_PLAYERS, 1, 0, 0);
+		if (host == nullptr) throw std::runtime_error("Failed to create ENet server");
+		shard_hosts.push_back(host);
+
+		if (use_io_uring && enet_host_use_io_uring(host) != 0) io_uring_unavailable = true;
+		if (!xdp_interface.empty() && enet_host_use_xdp(host, xdp_interface.c_str(), xdp_queue) != 0) xdp_unavailable = true;
+		if (busy_poll && enet_socket_set_option(host->socket, ENET_SOCKOPT_BUSY_POLL, BUSY_POLL_USEC) != 0) busy_poll_socket_failed = true;
+		if (latency_stats && enet_socket_set_option(host->socket, ENET_SOCKOPT_TIMESTAMPNS, 1) != 0) timestamps_unavailable = true;
+	}
+	atexit([]{
+		for (size_t i = 0; i < shard_hosts.size(); i++) {
+			// A host its net thread is still servicing is left to the OS
+			if (i < net_channels.size() && net_channels[i]->thread.joinable()) continue;
+			enet_host_destroy(shard_hosts[i]);
+		}
+	});
+
+	if (use_io_uring) {
+		if (!io_uring_unavailable) std::cout << "Using io_uring transport" << std::endl;
+		else std::cout << "io_uring unavailable, falling back to socket I/O" << std::endl;
+	}
+
+	if (busy_poll) {
+		std::cout << "Busy-poll mode";
+		if (busy_poll_socket_failed) std::cout << " (SO_BUSY_POLL unavailable, spinning in user space only)";
+		std::cout << std::endl;
+	}
+
+	if (!xdp_interface.empty()) {
+		if (!xdp_unavailable) std::cout << "Using AF_XDP on " << xdp_interface << " queue " << xdp_queue << std::endl;
+		else std::cout << "AF_XDP unavailable on " << xdp_interface << ", using socket I/O" << std::endl;
+	}
+
+	for (size_t i = 0; i < shard_count; i++) admin_queues.push_back(new MPSCRing<AdminCommand, ADMIN_QUEUE_SIZE>());
+	if (console) std::cout << "Reading admin commands from stdin" << std::endl;
+
+	if (timestamps_unavailable) std::cout << "Kernel receive timestamps unavailable, socket queueing latency will not be recorded" << std::endl;
 
-	std::cout << "Server started on port " << port << std::endl;
+	if (tick_tiers.size() > 1) {
+		std::cout << "Adaptive tick rate:";
+		for (const int tier : tick_tiers) std::cout << " " << tier;
+		std::cout << " Hz" << std::endl;
+	}
+
+	std::cout << "Server started on port " << port << " at " << tick_rate << " Hz";
+	if (shard_count > 1) std::cout << " with " << shard_count << " shards";
+	std::cout << std::endl;
 
 	#ifdef _WIN32
 	timeBeginPeriod(1);
@@ -1086,127 +4373,25 @@ try {
 	_DEBUG_LOG << "\nSERVER STARTED\n" << std::endl;
 #endif // _HNS_DEBUG
 
-        ENetEvent event;
-        for (;;) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-
-                while (enet_host_service(server, &event, 0) > 0) {
-                        switch (event.type) {
-                                default: break;
-
-                                case ENET_EVENT_TYPE_CONNECT:
-                                {
-					#ifdef _HNS_DEBUG
-						char _DEBUG_ip[64] = {0};
-						enet_address_get_host_ip(
-							&event.peer->address,
-							_DEBUG_ip,
-							sizeof(_DEBUG_ip)
-						);
-						_DEBUG_LOG
-						<< "Received ENET_EVENT_TYPE_CONNECT from "
-						<< _DEBUG_ip
-						<< std::endl;
-					#endif // _HNS_DEBUG
-
-                                        if (game_started) {
-						enet_peer_disconnect(event.peer, 0);
-						enet_host_flush(server);
-						enet_peer_reset(event.peer);
-						continue;
-					}
-                                }
-                                break;
-
-                                case ENET_EVENT_TYPE_RECEIVE:
-                                {
-					// #ifdef _HNS_DEBUG
-					// 	char _DEBUG_ip[64] = {0};
-					// 	enet_address_get_host_ip(
-					// 		&event.peer->address,
-					// 		_DEBUG_ip,
-					// 		sizeof(_DEBUG_ip)
-					// 	);
-					// 	_DEBUG_LOG
-					// 	<< "Received ENET_EVENT_TYPE_RECEIVE from "
-					// 	<< _DEBUG_ip
-					// 	<< std::endl;
-					// #endif // _HNS_DEBUG
-
-                                        HandleReceive(event.peer, event.packet);
-                                }
-                                break;
-
-                                case ENET_EVENT_TYPE_DISCONNECT:
-				#ifdef _HNS_DEBUG
-					{
-					char _DEBUG_ip[64] = {0};
-					enet_address_get_host_ip(
-						&event.peer->address,
-						_DEBUG_ip,
-						sizeof(_DEBUG_ip)
-					);
-					_DEBUG_LOG
-					<< "Received ENET_EVENT_TYPE_DISCONNECT from "
-					<< _DEBUG_ip
-					<< std::endl;
-					}
-				#endif // _HNS_DEBUG
-                                case ENET_EVENT_TYPE_DISCONNECT_TIMEOUT:
-                                {
-					if (peer_to_player_id.find(event.peer) == peer_to_player_id.end()) continue;
-
-                                        const PlayerID player_id = peer_to_player_id[event.peer];
-
-                                        if (game_started) {
-                                                std::cout
-                                                << "Player "
-                                                << player_id
-                                                << " disconnected during started game"
-                                                << ", shutting down..."
-                                                << std::endl;
-
-                                                exit(0);
-                                        }
-
-                                        std::cout
-                                        << "Player "
-                                        << player_id
-                                        << " disconnected"
-                                        << std::endl;
-
-                                        player_states.erase(player_id);
-                                        serverside_player_data.erase(player_id);
-                                        players_stats.erase(player_id);
-
-                                        player_id_to_peer.erase(player_id);
-                                        peer_to_player_id.erase(event.peer);
-
-                                        PlayerDisconnectedPacketData pdp_data{};
-					pdp_data.disconnected_player_id = player_id;
-					ENetPacket* player_disconnected_packet = enet_packet_create(
-						&pdp_data,
-						sizeof(PlayerDisconnectedPacketData),
-						ENET_PACKET_FLAG_RELIABLE
-					);
-					enet_host_broadcast(server, 0, player_disconnected_packet);
-
-					#ifdef _HNS_DEBUG
-						_DEBUG_LOG
-						<< "Broadcasting packet PLAYER_DISCONNECTED with data:\n"
-						<< "- Packet type: " << std::to_string(pdp_data.packet_type) << "\n"
-						<< "- Disconnected Player ID: " << pdp_data.disconnected_player_id
-						<< std::endl;
-					#endif // _HNS_DEBUG
-                                }
-                                break;
-                        }
-                }
-        }
+	server_start_time = std::chrono::steady_clock::now();
+
+	if (use_net_thread) {
+		for (size_t i = 0; i < shard_count; i++) net_channels.push_back(StartNetThread(i));
+	}
+
+	if (console) std::thread(ConsoleThreadMain).detach();
+
+	// Shard 0 runs on the main thread; shards only return once all of them
+	// have drained, and the hosts are destroyed at exit once none is in use
+	std::vector<std::thread> shard_threads;
+	for (size_t i = 1; i < shard_count; i++) shard_threads.emplace_back(ServeShardThread, i);
+	ServeShardThread(0);
+	for (std::thread& shard_thread : shard_threads) shard_thread.join();
 
         return 0;
 } catch (const std::exception& e) {
 	std::cout << "ERROR: " << e.what() << std::endl;
 	exit(1);
 }
-}
\ No newline at end of file
+}
+#endif // _HNS_NO_MAIN
\ No newline at end of file